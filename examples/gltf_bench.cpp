@@ -0,0 +1,58 @@
+#include <string>
+#include <iostream>
+
+#include "hilma/types/Mesh.h"
+#include "hilma/ops/generate.h"
+#include "hilma/ops/transform.h"
+#include "hilma/io/gltf.h"
+
+#include "hilma/parallel.h"
+#include "hilma/timer.h"
+#include "hilma/text.h"
+
+using namespace hilma;
+
+int main(int argc, char **argv) {
+
+    // Scene of many textured primitives, saved with quantized attributes
+    // so the loader goes through the normalized integer paths
+    Mesh scene;
+    const int side = 16;
+    for (int i = 0; i < side * side; i++) {
+        Mesh sphere = hilma::sphere(0.4f, 48);
+        translate(sphere, float(i % side), 0.0f, float(i / side));
+
+        Image texture(256, 256, 3);
+        for (int y = 0; y < 256; y++)
+            for (int x = 0; x < 256; x++)
+                texture.setColor(texture.getIndex(x, y), glm::vec3(x / 255.0f, y / 255.0f, (i % 7) / 6.0f));
+        texture.name = "texture_" + toString(i);
+
+        Material material("material_" + toString(i));
+        material.set("diffuse", texture);
+
+        scene.addMaterial(material);
+        scene.append(sphere);
+    }
+
+    std::string filename = "bench.glb";
+    saveGlb(filename, scene, true);
+
+    Timer timer;
+    double times[2];
+    size_t threads[2] = { 1, getThreadsTotal() };
+    for (int i = 0; i < 2; i++) {
+        Mesh mesh;
+        timer.start();
+        loadGltf(filename, mesh, threads[i]);
+        timer.stop();
+        times[i] = timer.get();
+
+        std::cout << threads[i] << " thread(s): " << times[i] << "ms ";
+        std::cout << "(" << mesh.getVerticesTotal() << " vertices, " << mesh.getFaceIndicesTotal() / 3 << " triangles)" << std::endl;
+    }
+
+    std::cout << "Speedup: " << times[0] / times[1] << "x" << std::endl;
+
+    return 0;
+}
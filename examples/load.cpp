@@ -54,14 +54,14 @@ int main(int argc, char **argv) {
 
     // hilma::Timer timer;
     // timer.start();
-    // std::vector<hilma::Image> sdf = hilma::toSdf(mesh, 5.0f, true);
+    // hilma::Volume sdf = hilma::toSdf(mesh, 5.0f, true);
     // timer.stop();
 
     // const float seconds = timer.get() / 1000.f;
     // std::cout << " Processing time : " << seconds << " secs" << std::endl;
 
-    // for (size_t i = 0; i < sdf.size(); i++)
-    //     hilma::savePng("sdf_" + hilma::toString(i, 4, '0') + ".png", sdf[i]);
+    // for (int i = 0; i < sdf.getDepth(); i++)
+    //     hilma::savePng("sdf_" + hilma::toString(i, 4, '0') + ".png", sdf.getSlice(i));
 
     return 1;
 }
\ No newline at end of file
@@ -26,33 +26,43 @@
     #include "hilma/types/Ray.h"
     #include "hilma/types/Line.h"
     #include "hilma/types/Image.h"
+    #include "hilma/types/Texture.h"
     #include "hilma/types/Material.h"
+    #include "hilma/types/TextureCache.h"
     #include "hilma/types/Triangle.h"
     #include "hilma/types/Plane.h"
     #include "hilma/types/Mesh.h"
+    #include "hilma/types/Volume.h"
     #include "hilma/types/Polyline.h"
     #include "hilma/types/Polygon.h"
     #include "hilma/types/Camera.h"
     #include "hilma/accel/BoundingBox.h"
     #include "hilma/accel/BoundingSphere.h"
     #include "hilma/accel/BVH.h"
+    #include "hilma/accel/MeshBVH.h"
     #include "hilma/accel/KdTree.h"
+    #include "hilma/accel/PointKDTree.h"
+    #include "hilma/accel/PolygonGrid.h"
     #include "hilma/ops/compute.h"
     #include "hilma/ops/generate.h"
     #include "hilma/ops/intersection.h"
     #include "hilma/ops/convert_image.h"
+    #include "hilma/ops/pipeline.h"
     #include "hilma/ops/convert_path.h"
     #include "hilma/ops/transform.h"
     #include "hilma/ops/raytrace.h"
-    #include "hilma/ops/earcut.h"
+    #include "hilma/ops/boolean.h"
     #include "hilma/io/jpg.h"
     #include "hilma/io/png.h"
     #include "hilma/io/hdr.h"
     #include "hilma/io/ply.h"
     #include "hilma/io/stl.h"
+    #include "hilma/io/raw.h"
+    #include "hilma/io/terrain.h"
     #include "hilma/io/obj.h"
     #include "hilma/io/gltf.h"
     #include "hilma/io/auto.h"
+    #include "hilma/io/async.h"
 %}
 
 %include "glm.i"
@@ -94,6 +104,7 @@ namespace std {
     %template(Vector2DVector)   vector<glm::vec2>;
 
     %template(PolylinesVector)  vector<hilma::Polyline>;
+    %template(PolygonsVector)   vector<hilma::Polygon>;
 
     %template(FacesVector)      vector<glm::ivec3>;
     %template(EdgesVector)      vector<glm::ivec2>;
@@ -110,32 +121,43 @@ namespace std {
 %include "include/hilma/types/Ray.h"
 %include "include/hilma/types/Line.h"
 %include "include/hilma/types/Image.h"
+%include "include/hilma/types/Texture.h"
 %include "include/hilma/types/Material.h"
+%include "include/hilma/types/TextureCache.h"
 %include "include/hilma/types/Triangle.h"
 %include "include/hilma/types/Plane.h"
 %include "include/hilma/types/Mesh.h"
+%include "include/hilma/types/Volume.h"
 %include "include/hilma/types/Polyline.h"
 %include "include/hilma/types/Polygon.h"
 %include "include/hilma/types/Camera.h"
 %include "include/hilma/accel/BoundingBox.h"
 %include "include/hilma/accel/BoundingSphere.h"
 %include "include/hilma/accel/BVH.h"
+%include "include/hilma/accel/MeshBVH.h"
 %include "include/hilma/accel/KdTree.h"
+%include "include/hilma/accel/PointKDTree.h"
+%include "include/hilma/accel/PolygonGrid.h"
 %include "include/hilma/ops/intersection.h"
 %include "include/hilma/ops/convert_image.h"
+%include "include/hilma/ops/pipeline.h"
 %include "include/hilma/ops/convert_path.h"
 %include "include/hilma/ops/compute.h"
 %include "include/hilma/ops/generate.h"
 %include "include/hilma/ops/raytrace.h"
 %include "include/hilma/ops/transform.h"
+%include "include/hilma/ops/boolean.h"
 %include "include/hilma/io/jpg.h"
 %include "include/hilma/io/png.h"
 %include "include/hilma/io/hdr.h"
 %include "include/hilma/io/ply.h"
 %include "include/hilma/io/stl.h"
+%include "include/hilma/io/raw.h"
+%include "include/hilma/io/terrain.h"
 %include "include/hilma/io/obj.h"
 %include "include/hilma/io/gltf.h"
 %include "include/hilma/io/auto.h"
+%include "include/hilma/io/async.h"
 
 // using namespace hilma;
 
@@ -16,6 +16,7 @@ public:
 
     virtual void load( const std::vector<Triangle>& _elements, int _splitAxis = -1 );
     virtual std::shared_ptr<BVH> hit(const Ray& _ray, float& _minDistance, float& _maxDistance);
+    // Leaf holding the triangle closest to _point (use MeshBVH for closest point queries)
     virtual std::shared_ptr<BVH> closest(const glm::vec3& _point);
 
     virtual void split(int _axis = -1);
@@ -58,7 +58,7 @@ public:
     void construct();
     void update();
     void traverseDepthFirst(TraversalPredicate pred, TraversalCallback cb, const TraversalPriorityLess& pless = nullptr) const;
-    void traverseBreadthFirst(const TraversalPredicate& pred, const TraversalCallback& cb, unsigned int start_node = 0, const TraversalPriorityLess& pless = nullptr, TraversalQueue& pending = TraversalQueue()) const;
+    void traverseBreadthFirst(const TraversalPredicate& pred, const TraversalCallback& cb, unsigned int start_node = 0, const TraversalPriorityLess& pless = nullptr) const;
 
 protected:
 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "hilma/accel/BoundingBox.h"
+#include "hilma/types/Triangle.h"
+#include "hilma/types/Mesh.h"
+
+namespace hilma {
+
+// Result of a closest point query on a mesh
+struct SurfacePoint {
+    static const size_t NONE = size_t(-1);
+
+    glm::vec3   position;
+    glm::vec3   barycentric;            // weights of the triangle vertices for position
+    size_t      triangle    = NONE;     // index of the triangle it lands on, NONE when nothing was found
+    float       distance    = FLT_MAX;  // negative inside the surface when asked for the sign
+};
+
+// Flat (array based) bounding volume hierarchy over triangle positions, made for
+// distance queries. Nodes also keep a dipole (area weighted center and normal) of
+// their triangles to evaluate fast winding numbers.
+class MeshBVH : public BoundingBox {
+public:
+    MeshBVH();
+    MeshBVH(const std::vector<Triangle>& _triangles);
+    MeshBVH(const Mesh& _mesh);
+
+    void    load(const std::vector<Triangle>& _triangles);
+    void    clear();
+
+    size_t  getTotalTriangles() const { return ids.size(); }
+
+    // Closest point on the surface not further than _maxDistance. _triangle is the index
+    // of the triangle it lands on. Returns false if there is nothing that close.
+    bool    closest(const glm::vec3& _point, glm::vec3& _closest, size_t& _triangle, float _maxDistance = FLT_MAX) const;
+
+    // Same, also with the barycentrics of the point. When _signed the distance is negative
+    // inside the surface (according to its winding number).
+    bool    closest(const glm::vec3& _point, SurfacePoint& _closest, float _maxDistance = FLT_MAX, bool _signed = false) const;
+
+    // A batch of points split across threads
+    std::vector<SurfacePoint> closest(const std::vector<glm::vec3>& _points, float _maxDistance = FLT_MAX, bool _signed = false, size_t _threads = 0) const;
+
+    // Generalized winding number of the surface around _point: ~1 inside, ~0 outside,
+    // still meaningful for meshes with holes or self intersections. Nodes further than
+    // _accuracy times their radius are approximated by their dipole.
+    float   getWindingNumber(const glm::vec3& _point, float _accuracy = 2.0f) const;
+
+private:
+    struct Node {
+        glm::vec3   min;
+        glm::vec3   max;
+        glm::vec3   center;     // area weighted centroid
+        glm::vec3   normal;     // sum of area weighted normals
+        float       radius;     // from center to the furthest vertex
+        uint32_t    first;      // first triangle on leafs, right child on inner nodes
+        uint32_t    count;      // triangles on leafs, 0 on inner nodes
+    };
+
+    uint32_t    build(uint32_t _begin, uint32_t _end, std::vector<glm::vec3>& _centroids);
+    float       getWindingNumber(uint32_t _node, const glm::vec3& _point, float _accuracy) const;
+
+    std::vector<Node>       nodes;
+    std::vector<glm::vec3>  points;     // three per triangle, in leaf order
+    std::vector<uint32_t>   ids;        // original index of each triangle, in leaf order
+};
+
+}
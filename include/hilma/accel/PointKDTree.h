@@ -0,0 +1,313 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <cstdint>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+#include "hilma/accel/BoundingBox.h"
+#include "hilma/types/Mesh.h"
+#include "hilma/parallel.h"
+
+namespace hilma {
+
+// Flat (array based) kd-tree over points for nearest neighbour, radius and box queries.
+// Queries walk the tree with a small stack, results are indices into the original points.
+class PointKDTree : public BoundingBox {
+public:
+    static const uint32_t NOT_FOUND = 0xFFFFFFFF;
+
+    PointKDTree() {}
+    PointKDTree(const std::vector<glm::vec3>& _points) { load(_points); }
+    PointKDTree(const Mesh& _mesh) { load(_mesh.getVertices()); }
+
+    void    load(const std::vector<glm::vec3>& _points);
+    void    clear();
+
+    size_t  getTotal() const { return ids.size(); }
+    const glm::vec3& getPoint(size_t _index) const { return points[_index]; }
+
+    // Index of the closest point not further than _maxDistance, NOT_FOUND if there is none
+    uint32_t closest(const glm::vec3& _point, float _maxDistance = FLT_MAX) const;
+
+    // Up to _k closest points, nearest first, into _indices and their squared distances into
+    // _distances2 (both hold _k values). Returns how many were found. Doesn't allocate.
+    size_t  nearest(const glm::vec3& _point, size_t _k, uint32_t* _indices, float* _distances2, float _maxDistance = FLT_MAX) const;
+    std::vector<uint32_t> nearest(const glm::vec3& _point, size_t _k, float _maxDistance = FLT_MAX) const;
+
+    // Adds the points within _radius (or inside _box) to _indices, in no particular order.
+    // Returns how many were added.
+    size_t  radius(const glm::vec3& _point, float _radius, std::vector<uint32_t>& _indices) const;
+    size_t  inside(const BoundingBox& _box, std::vector<uint32_t>& _indices) const;
+
+    // Batches split across threads. nearest() returns _k indices per point, padded with NOT_FOUND
+    std::vector<uint32_t> nearest(const std::vector<glm::vec3>& _points, size_t _k, float _maxDistance = FLT_MAX, size_t _threads = 0) const;
+    std::vector< std::vector<uint32_t> > radius(const std::vector<glm::vec3>& _points, float _radius, size_t _threads = 0) const;
+
+private:
+    struct Node {
+        glm::vec3   min;
+        glm::vec3   max;
+        uint32_t    first;      // first point on leafs, right child on inner nodes
+        uint32_t    count;      // points on leafs, 0 on inner nodes
+    };
+
+    static const uint32_t LEAF_SIZE = 8;
+    static const int STACK_SIZE = 64;
+
+    uint32_t    build(uint32_t _begin, uint32_t _end);
+
+    static float distance2ToBox(const glm::vec3& _p, const glm::vec3& _min, const glm::vec3& _max) {
+        glm::vec3 d = glm::max(glm::max(_min - _p, _p - _max), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    std::vector<Node>       nodes;
+    std::vector<glm::vec3>  points;     // in leaf order
+    std::vector<uint32_t>   ids;        // original index of each point, in leaf order
+};
+
+inline void PointKDTree::clear() {
+    nodes.clear();
+    points.clear();
+    ids.clear();
+    min = glm::vec3(std::numeric_limits<float>::max());
+    max = glm::vec3(std::numeric_limits<float>::min());
+}
+
+inline void PointKDTree::load(const std::vector<glm::vec3>& _points) {
+    clear();
+    if (_points.size() == 0)
+        return;
+
+    uint32_t total = _points.size();
+    points = _points;
+    ids.resize(total);
+    for (uint32_t i = 0; i < total; i++)
+        ids[i] = i;
+
+    nodes.reserve(total * 2 / LEAF_SIZE + 1);
+    build(0, total);
+
+    std::vector<glm::vec3> sorted(total);
+    for (uint32_t i = 0; i < total; i++)
+        sorted[i] = points[ids[i]];
+    points.swap(sorted);
+
+    min = nodes[0].min;
+    max = nodes[0].max;
+}
+
+inline uint32_t PointKDTree::build(uint32_t _begin, uint32_t _end) {
+    uint32_t index = nodes.size();
+    nodes.push_back(Node());
+
+    Node node;
+    node.min = glm::vec3(FLT_MAX);
+    node.max = glm::vec3(-FLT_MAX);
+    for (uint32_t i = _begin; i < _end; i++) {
+        node.min = glm::min(node.min, points[ids[i]]);
+        node.max = glm::max(node.max, points[ids[i]]);
+    }
+
+    if (_end - _begin <= LEAF_SIZE) {
+        node.first = _begin;
+        node.count = _end - _begin;
+        nodes[index] = node;
+        return index;
+    }
+
+    // split on the median of the longest axis
+    glm::vec3 extent = node.max - node.min;
+    int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+    uint32_t mid = (_begin + _end) / 2;
+    std::nth_element(ids.begin() + _begin, ids.begin() + mid, ids.begin() + _end,
+                    [this, axis](uint32_t a, uint32_t b) { return points[a][axis] < points[b][axis]; });
+
+    build(_begin, mid);
+    node.first = build(mid, _end);
+    node.count = 0;
+    nodes[index] = node;
+    return index;
+}
+
+inline uint32_t PointKDTree::closest(const glm::vec3& _point, float _maxDistance) const {
+    uint32_t index;
+    float distance2;
+    if (nearest(_point, 1, &index, &distance2, _maxDistance) == 0)
+        return NOT_FOUND;
+    return index;
+}
+
+inline size_t PointKDTree::nearest(const glm::vec3& _point, size_t _k, uint32_t* _indices, float* _distances2, float _maxDistance) const {
+    if (nodes.size() == 0 || _k == 0)
+        return 0;
+
+    // the results are kept sorted by insertion, for the small k of the usual queries
+    // that's cheaper than a heap and they come out in order
+    size_t found = 0;
+    float worst = (_maxDistance < FLT_MAX) ? _maxDistance * _maxDistance : FLT_MAX;
+
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[ stack[--top] ];
+        if (distance2ToBox(_point, node.min, node.max) > worst)
+            continue;
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                glm::vec3 d = points[i] - _point;
+                float d2 = glm::dot(d, d);
+                if (d2 > worst)
+                    continue;
+
+                size_t j = (found < _k) ? found++ : _k - 1;
+                for (; j > 0 && _distances2[j - 1] > d2; j--) {
+                    _distances2[j] = _distances2[j - 1];
+                    _indices[j] = _indices[j - 1];
+                }
+                _distances2[j] = d2;
+                _indices[j] = ids[i];
+
+                if (found == _k)
+                    worst = _distances2[_k - 1];
+            }
+            continue;
+        }
+
+        // push the furthest child first so the nearest one is visited (and tightens the bound) first
+        uint32_t left = &node - &nodes[0] + 1;
+        uint32_t right = node.first;
+        float dl = distance2ToBox(_point, nodes[left].min, nodes[left].max);
+        float dr = distance2ToBox(_point, nodes[right].min, nodes[right].max);
+        if (dl < dr) {
+            stack[top++] = right;
+            stack[top++] = left;
+        }
+        else {
+            stack[top++] = left;
+            stack[top++] = right;
+        }
+    }
+
+    return found;
+}
+
+inline std::vector<uint32_t> PointKDTree::nearest(const glm::vec3& _point, size_t _k, float _maxDistance) const {
+    std::vector<uint32_t> indices(_k);
+    std::vector<float> distances2(_k);
+    indices.resize( nearest(_point, _k, indices.data(), distances2.data(), _maxDistance) );
+    return indices;
+}
+
+inline size_t PointKDTree::radius(const glm::vec3& _point, float _radius, std::vector<uint32_t>& _indices) const {
+    if (nodes.size() == 0)
+        return 0;
+
+    size_t total = _indices.size();
+    float r2 = _radius * _radius;
+
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const Node& node = nodes[index];
+        if (distance2ToBox(_point, node.min, node.max) > r2)
+            continue;
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                glm::vec3 d = points[i] - _point;
+                if (glm::dot(d, d) <= r2)
+                    _indices.push_back(ids[i]);
+            }
+            continue;
+        }
+
+        stack[top++] = node.first;
+        stack[top++] = index + 1;
+    }
+
+    return _indices.size() - total;
+}
+
+inline size_t PointKDTree::inside(const BoundingBox& _box, std::vector<uint32_t>& _indices) const {
+    if (nodes.size() == 0)
+        return 0;
+
+    size_t total = _indices.size();
+
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const Node& node = nodes[index];
+        if (node.max.x < _box.min.x || node.max.y < _box.min.y || node.max.z < _box.min.z ||
+            node.min.x > _box.max.x || node.min.y > _box.max.y || node.min.z > _box.max.z)
+            continue;
+
+        // the whole node is inside, no need to test its points
+        if (_box.contains(node.min) && _box.contains(node.max)) {
+            uint32_t begin = node.first;
+            uint32_t end = node.first + node.count;
+            if (node.count == 0) {
+                // the points of an inner node are contiguous, from its leftmost to its rightmost leaf
+                const Node* l = &node;
+                while (l->count == 0)
+                    l = &nodes[l - &nodes[0] + 1];
+                const Node* r = &node;
+                while (r->count == 0)
+                    r = &nodes[r->first];
+                begin = l->first;
+                end = r->first + r->count;
+            }
+            for (uint32_t i = begin; i < end; i++)
+                _indices.push_back(ids[i]);
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++)
+                if (_box.contains(points[i]))
+                    _indices.push_back(ids[i]);
+            continue;
+        }
+
+        stack[top++] = node.first;
+        stack[top++] = index + 1;
+    }
+
+    return _indices.size() - total;
+}
+
+inline std::vector<uint32_t> PointKDTree::nearest(const std::vector<glm::vec3>& _points, size_t _k, float _maxDistance, size_t _threads) const {
+    std::vector<uint32_t> indices(_points.size() * _k, NOT_FOUND);
+    std::vector<float> distances2(_points.size() * _k);
+
+    parallelFor(_points.size(), [&](size_t _i, size_t /*_thread*/) {
+        nearest(_points[_i], _k, &indices[_i * _k], &distances2[_i * _k], _maxDistance);
+    }, _threads);
+
+    return indices;
+}
+
+inline std::vector< std::vector<uint32_t> > PointKDTree::radius(const std::vector<glm::vec3>& _points, float _radius, size_t _threads) const {
+    std::vector< std::vector<uint32_t> > indices(_points.size());
+
+    parallelFor(_points.size(), [&](size_t _i, size_t /*_thread*/) {
+        radius(_points[_i], _radius, indices[_i]);
+    }, _threads);
+
+    return indices;
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "hilma/accel/BoundingBox.h"
+#include "hilma/types/Polygon.h"
+
+namespace hilma {
+
+// Prepared polygon for point queries. The edges of every ring (all closed, holes by the
+// even-odd rule) are binned once in horizontal bands for inside tests and in a uniform
+// grid for closest point and distance queries.
+class PolygonGrid : public BoundingBox {
+public:
+    PolygonGrid();
+    PolygonGrid(const Polygon& _polygon);
+    PolygonGrid(const Polyline& _polyline);
+    PolygonGrid(const std::vector<glm::vec2>& _ring);
+    PolygonGrid(const std::vector< std::vector<glm::vec2> >& _rings);
+
+    void        load(const std::vector< std::vector<glm::vec2> >& _rings);
+    void        clear();
+
+    size_t      getEdgesTotal() const { return edges.size(); }
+
+    // Same answer as inside(const std::vector<glm::vec2>&, const glm::vec2&) on every ring
+    bool        inside(const glm::vec2& _point) const;
+
+    // Closest point on the edges. _edge is the index of the edge it lands on, counting
+    // the edges of each ring in order (edge i goes from vertex i to i + 1).
+    glm::vec2   getClosestPoint(const glm::vec2& _point, size_t* _edge = nullptr) const;
+
+    // Distance to the edges, negative inside when _signed
+    float       getDistance(const glm::vec2& _point, bool _signed = false) const;
+
+    // Batches split across threads
+    std::vector<uint8_t>    inside(const std::vector<glm::vec2>& _points, size_t _threads = 0) const;
+    std::vector<glm::vec2>  getClosestPoints(const std::vector<glm::vec2>& _points, size_t _threads = 0) const;
+    std::vector<float>      getDistances(const std::vector<glm::vec2>& _points, bool _signed = false, size_t _threads = 0) const;
+
+private:
+    struct Edge {
+        glm::vec2   a;
+        glm::vec2   b;
+    };
+
+    float       closest(const glm::vec2& _point, glm::vec2& _closest, size_t& _edge) const;
+
+    std::vector<Edge>       edges;
+
+    // edges crossing each band, sorted by their right most x
+    std::vector<uint32_t>   bandsOffsets;
+    std::vector<uint32_t>   bands;
+    int                     bandsTotal;
+    float                   bandsScale;
+
+    // edges touching each cell
+    std::vector<uint32_t>   cellsOffsets;
+    std::vector<uint32_t>   cells;
+    int                     cellsWidth;
+    int                     cellsHeight;
+    glm::vec2               cellsScale;
+};
+
+}
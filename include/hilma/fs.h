@@ -2,6 +2,9 @@
 
 #include <string>
 #include <sys/stat.h>
+#ifdef PLATFORM_WIN32
+#include <direct.h>
+#endif
 // #include <fstream>      // File
 
 namespace hilma {
@@ -11,6 +14,17 @@ inline bool urlExists(const std::string& _name) {
     return (stat (_name.c_str(), &buffer) == 0);
 }
 
+// Creates a folder (its parent has to exist), true if it's there after
+inline bool makeDir(const std::string& _path) {
+    if (urlExists(_path))
+        return true;
+#ifdef PLATFORM_WIN32
+    return _mkdir(_path.c_str()) == 0;
+#else
+    return mkdir(_path.c_str(), 0755) == 0;
+#endif
+}
+
 inline bool haveExt(const std::string& _file, const std::string& _ext){
     return _file.find( "." + _ext) != std::string::npos;
 }
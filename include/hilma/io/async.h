@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <functional>
+#include <condition_variable>
+
+#include "hilma/types/Image.h"
+
+namespace hilma {
+
+// Bounded pool of threads that decode and encode images in the background, so a batch can
+// overlap loading, processing and saving. Once _queueSize jobs are waiting, submitting a
+// new one blocks until a worker takes one, which keeps producers from piling up images in
+// memory. Each worker reuses its own 8-bit staging buffer to encode PNG/JPG.
+class ImageIO {
+public:
+    ImageIO(size_t _threads = 0, size_t _queueSize = 0);
+    virtual ~ImageIO();
+
+    std::future<Image>  load(const std::string& _filename, int _channels = 0);
+    // _done(image, loaded) runs on the worker thread
+    void                load(const std::string& _filename, std::function<void(Image&, bool)> _done, int _channels = 0);
+
+    // the image is taken by value, move it in to skip the copy
+    std::future<bool>   save(const std::string& _filename, Image _image);
+    void                save(const std::string& _filename, Image _image, std::function<void(bool)> _done);
+
+    // Blocks until every job submitted so far is done
+    void                wait();
+
+    size_t              getThreadsTotal() const { return workers.size(); }
+    size_t              getPendingTotal();
+
+private:
+    typedef std::function<void(size_t)> Job;
+
+    void                submit(Job _job);
+    bool                encode(const std::string& _filename, const Image& _image, size_t _thread);
+
+    std::vector<std::thread>                workers;
+    std::vector< std::vector<unsigned char> > staging;  // one per worker
+
+    std::deque<Job>                         jobs;
+    std::mutex                              mutex;
+    std::condition_variable                 haveJobs;
+    std::condition_variable                 haveRoom;
+    std::condition_variable                 idle;
+    size_t                                  queueSize;
+    size_t                                  running;
+    bool                                    stopping;
+};
+
+}
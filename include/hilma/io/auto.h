@@ -7,6 +7,9 @@
 
 namespace hilma {
 
+// 8 and 16-bit files are kept as IMAGE_UINT8 / IMAGE_UINT16 (HDR loads as IMAGE_FLOAT32). Those
+// types only hold 0.0-1.0 at their file precision: the operators and ImagePipeline promote them to
+// floats when needed, but setValue()/setColor() clamp. convert(IMAGE_FLOAT32) first to work in floats.
 bool            load(const std::string& _filename, Image& _image, int _channels = 0);
 unsigned char*  load(const std::string& _filename, int* _width, int* _height, int* _channels);
 
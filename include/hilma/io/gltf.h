@@ -6,7 +6,8 @@
 
 namespace hilma {
 
-bool loadGltf( const std::string& _filename, Mesh& _mesh );
+// Primitives and embedded images are decoded on _threads threads (0 for all the hardware ones)
+bool loadGltf( const std::string& _filename, Mesh& _mesh, size_t _threads = 0 );
 
 inline Mesh loadGltf( const std::string& _filename) {
     Mesh mesh;
@@ -16,4 +17,9 @@ inline Mesh loadGltf( const std::string& _filename) {
 
 bool saveGltf( const std::string& _filename, const Mesh& _mesh );
 
+// Binary glTF (.glb) streamed from the mesh storage into a single BIN chunk.
+//  _quantize   KHR_mesh_quantization: int16 positions, int8 normals/tangents, uint16 texcoords
+//  _compress   EXT_meshopt_compression: lossless vertex and index codec
+bool saveGlb( const std::string& _filename, const Mesh& _mesh, bool _quantize = false, bool _compress = false );
+
 }
@@ -24,5 +24,10 @@ inline unsigned char* loadPng(const std::string& _filename, int* _width, int* _h
 bool            savePng(const std::string& _filename, const Image& _image);
 bool            savePng(const std::string& _filename, const unsigned char* _pixels, int _width, int _height, int _channels);
 
+// zlib level (8 by default) and row filter (-1 tries all five on every row, 0 to 4 forces one)
+// of the PNG encoder. Lower levels and a forced filter encode a lot faster. It's global, set it
+// before saving.
+void            setPngCompression(int _level, int _filter = -1);
+
 // bool savePng16(const std::string& _filename, uint16_t* _pixels, int _width, int _height, int _channels);
 }
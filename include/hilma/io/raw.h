@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+#include "hilma/types/Volume.h"
+
+namespace hilma {
+
+// Dense float32 voxels, x first then y then z (width * height * depth floats), ready to
+// upload as a 3D texture
+bool    saveRaw( const std::string& _filename, const Volume& _volume );
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+#include "hilma/types/Image.h"
+
+namespace hilma {
+
+// Bakes a heightmap into a streamable quadtree of terrain tiles (see toTerrainQuadtree) on _folder:
+//      <level>_<x>_<y>.glb     mesh of the tile, with normals and texcoords over the tile
+//      <level>_<x>_<y>.png     normal map of the tile (with _normalmaps)
+//      tiles.json              manifest with the tile size, levels, and the bounds, error and
+//                              files of every tile
+bool    saveTerrain(const std::string& _folder, const Image& _heightmap, float _zScale,
+                    int _tileSize = 256, float _maxError = 0.001f, float _skirtHeight = 0.0f,
+                    bool _normalmaps = true, bool _quantize = false, size_t _threads = 0);
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include "hilma/types/Polygon.h"
+
+namespace hilma {
+
+// Boolean operations on the x,y plane. Results have their outer rings counter clockwise
+// and their holes clockwise, with every ring closed.
+
+enum FillRule {
+    FILL_EVEN_ODD = 0,  // inside where a ray crosses an odd number of edges
+    FILL_NON_ZERO       // inside where the winding number is not zero
+};
+
+enum BooleanOp {
+    BOOLEAN_UNION = 0,
+    BOOLEAN_INTERSECTION,
+    BOOLEAN_DIFFERENCE,     // _a minus _b
+    BOOLEAN_XOR
+};
+
+Polygon boolean(const Polygon& _a, const Polygon& _b, BooleanOp _op, FillRule _rule = FILL_EVEN_ODD);
+
+// Resolves the overlaps and self intersections of a polygon into clean rings
+Polygon merge(const Polygon& _polygon, FillRule _rule = FILL_EVEN_ODD);
+
+// Union of many polygons (ex. dissolving building footprints), done in groups across
+// threads and then merged by pairs. _rule applies to each polygon on its own.
+Polygon merge(const std::vector<Polygon>& _polygons, FillRule _rule = FILL_EVEN_ODD, size_t _threads = 0);
+
+// Area closer than _distance to the line (a buffer). Closed polylines get joins on every
+// vertex and no caps.
+Polygon offset(const Polyline& _polyline, float _distance, JoinType _join = JoinType::ROUND, CapType _cap = CapType::ROUND,
+                int _resolution = 20, float _miterLimit = 3.0f);
+
+// Grows the polygon by _distance, or shrinks it when negative
+Polygon offset(const Polygon& _polygon, float _distance, JoinType _join = JoinType::ROUND,
+                int _resolution = 20, float _miterLimit = 3.0f);
+
+}
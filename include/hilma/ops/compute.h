@@ -8,9 +8,29 @@ namespace hilma {
 // 2D
 void                    simplify(std::vector<glm::vec2>& _points, float _tolerance=0.3f);
 std::vector<glm::vec2>  getSimplify(const std::vector<glm::vec2>& _points, float _tolerance=0.3f);
-std::vector<glm::vec2>  getConvexHull(const std::vector<glm::vec2>& _points);
 float                   getArea(const std::vector<glm::vec2>& _points);
 
+// Counter clockwise from the point with the largest x (and y), repeating it at the end.
+// Points inside the polygon of their extremes are dropped first and large inputs are
+// hulled in chunks across threads.
+std::vector<glm::vec2>  getConvexHull(const std::vector<glm::vec2>& _points, size_t _threads = 0);
+
+struct PointsStats {
+    BoundingBox bbox;
+    glm::vec2   centroid;   // average of the points
+    float       area;       // signed area of the ring they make, positive when counter clockwise
+    size_t      count;
+};
+
+// Bounding box, centroid and area in a single pass
+PointsStats             getStats(const std::vector<glm::vec2>& _points, size_t _threads = 0);
+
+// 3D
+// Triangles of the convex hull (facing out) over the points that are on it. Empty when
+// all points are on a plane.
+Mesh                    getConvexHull(const std::vector<glm::vec3>& _points, size_t _threads = 0);
+Mesh                    getConvexHull(const Mesh& _mesh, size_t _threads = 0);
+
 // 2D & 3D
 BoundingBox             getBoundingBox(const Mesh& _mesh);
 BoundingBox             getBoundingBox(const std::vector<glm::vec2>& _points);
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <vector>
+#include <functional>
 
 #include "hilma/types/Mesh.h"
 #include "hilma/types/Image.h"
+#include "hilma/types/Volume.h"
 
 namespace hilma {
 
@@ -19,25 +21,91 @@ void                autolevel(Image& _image);
 void                threshold(Image& _image, float _threshold = 0.5f);
 
 unsigned char*      to8bit(const Image& _image);
-Image               toNormalmap(const Image& _heightmap, float _zScale = 100.0f);
+// into _pixels, which holds width * height * channels bytes
+void                to8bit(const Image& _image, unsigned char* _pixels);
+
+enum NormalmapKernel {
+    NORMALMAP_CENTRAL = 0,  // central differences
+    NORMALMAP_SOBEL         // 3x3 Sobel, smoother on noisy heightmaps
+};
+
+// Normal map (encoded as n * 0.5 + 0.5) at the same resolution of the heightmap, clamping at the edges
+Image               toNormalmap(const Image& _heightmap, float _zScale = 100.0f, NormalmapKernel _kernel = NORMALMAP_CENTRAL, size_t _threads = 0);
+// Just for a region of the heightmap. The pixels around the region are read too, so heightmaps
+// too big for memory can be done in tiles loaded with a one pixel apron (use the inside as the region)
+Image               toNormalmap(const Image& _heightmap, int _x, int _y, int _width, int _height,
+                                float _zScale = 100.0f, NormalmapKernel _kernel = NORMALMAP_CENTRAL, size_t _threads = 0);
 Image               toLuma(const Image& _image);
 Image               toHeightmap(const Image& _terrariumImage);
 Image               toHueRainbow(const Image& _graysale);
 
+// Adaptive mesh of a heightmap. Besides the texcoords it can emit normals from the heightmap
+// gradient, and walls along the borders: down to a flat base at -_baseHeight or skirts
+// hanging _skirtHeight under the edge (to hide cracks between tiles of different detail)
 Mesh                toTerrain(  const Image& _image,
                                 const float _zScale,
                                 const float _maxError = 0.001f, 
                                 const float _baseHeight = 0.0f,
                                 const int _maxTriangles = 0, 
-                                const int _maxPoints = 0 );
+                                const int _maxPoints = 0,
+                                const float _skirtHeight = 0.0f,
+                                const bool _normals = false );
+
+// Meshes the heightmap in _tileSize pixel tiles on parallel. The vertices along the borders are
+// shared by the neighboring tiles so the seams are watertight. Each of the _maxErrors (from
+// coarse to fine) is a level of detail that refines the previous one. Tiles go row by row,
+// with their levels next to each other: out[(ty * tilesX + tx) * levels + level]. Skirts and
+// normals work like on toTerrain, _tileTexcoords go from 0 to 1 over each tile.
+std::vector<Mesh>   toTerrainTiles( const Image& _image,
+                                    const float _zScale,
+                                    const int _tileSize,
+                                    const std::vector<float>& _maxErrors,
+                                    const float _skirtHeight = 0.0f,
+                                    const bool _normals = false,
+                                    const bool _tileTexcoords = false,
+                                    size_t _threads = 0 );
+
+struct TerrainTile {
+    int         level;
+    int         x;
+    int         y;
+    int         step;       // heightmap pixels between samples
+    float       error;      // max error allowed, in heightmap values
+    glm::ivec2  min;        // first and last pixels of the heightmap covered
+    glm::ivec2  max;
+    Mesh        mesh;       // with normals and texcoords over the tile
+    Image       heights;    // samples the mesh was made from (ex. for toNormalmap)
+};
+
+// Quadtree of terrain tiles _tileSize samples wide. Level 0 is a single tile over the whole
+// heightmap, each level splits every tile in four and halves the error down to _maxError on
+// the last one, which samples every pixel. Tiles of the same level share their border
+// vertices, _skirtHeight hides the cracks against other levels. Each tile goes to _callback
+// (from the worker threads) as soon as it's done, so only the tiles in flight take memory.
+// Returns the number of levels.
+int                 toTerrainQuadtree(  const Image& _image,
+                                        const float _zScale,
+                                        const int _tileSize,
+                                        const float _maxError,
+                                        const float _skirtHeight,
+                                        std::function<void(TerrainTile&)> _callback,
+                                        size_t _threads = 0 );
 
-Image               toSdf(const Image& _image, float _on = 1.0f);
-std::vector<Image>  toSdf(const Mesh& _mesh, float _scale, bool _absolute = false);
+// Distance to the closest _on pixel. _signed also measures inside the _on regions (as negative),
+// without _autolevel the result is in pixels
+Image               toSdf(const Image& _image, float _on = 1.0f, bool _signed = false, bool _autolevel = true, size_t _threads = 0);
+// Signed distance field of a mesh, _scale voxels per unit. Inside is negative (by winding
+// number) unless _absolute. Only the bricks within _narrowBand voxels of the surface are
+// allocated: distances inside the band are exact, the rest of those bricks is filled by fast
+// marching and every other brick holds the distance from its center. A _narrowBand of 0
+// allocates every brick with exact distances.
+Volume              toSdf(const Mesh& _mesh, float _scale, bool _absolute = false, float _narrowBand = 3.0f, size_t _threads = 0);
 
 Image               mergeChannels(const Image& _red, const Image& _green, const Image& _blue);
 Image               mergeChannels(const Image& _red, const Image& _green, const Image& _blue, const Image& _alpha);
 Image               addAlpha(const Image& _rgb, const Image& _alpha);
 Image               packInSprite(const std::vector<Image>& _images);
+Image               packInSprite(const Volume& _volume);
 std::vector<Image>  splitChannels(const Image& _image);
 
 Image               denoise(const Image& _color, const Image& _normal, const Image& _albedo, bool _hdr = true);
@@ -19,13 +19,7 @@ inline Mesh toSurface(const Polyline& _polyline) {
     return toSurface(_polyline.getVertices());
 }
 
-inline Mesh toSurface(const Polygon& _polygon, const BoundingBox& _bbox) {
-    std::vector< std::vector<glm::vec3> > polygon;
-    for (size_t i = 0; i < _polygon.size(); i++)
-        polygon.push_back( _polygon[i].getVertices() );
-    
-    return toSurface(polygon, _bbox);
-}
+Mesh toSurface(const Polygon& _polygon, const BoundingBox& _bbox);
 
 inline Mesh toSurface(const Polygon& _polygon) {
     return toSurface(_polygon, BoundingBox());
@@ -58,13 +52,46 @@ inline Mesh toSpline(const Polyline& _polyline, float _width, JoinType _join = J
     return toSpline(_polyline.getVertices(), _width, _join, _cap, _miterLimit);
 }
 
-Mesh toTube(const Polyline& _polyline, const float* _array1D, int _n,  int _resolution, bool _caps);
+// Tubes follow rotation minimizing (parallel transport) frames, so they don't twist on turns.
+// The radius of each vertex comes from _array1D, repeating when there are less than vertices.
+Mesh toTube(const Polyline& _polyline, const float* _array1D, int _n,  int _resolution, bool _caps, size_t _threads = 0);
 
-inline Mesh toTube(const Polyline& _polyline, const float _width, int _resolution, bool _caps = true) {
-    return toTube(_polyline, &_width, 1, _resolution, _caps);
+inline Mesh toTube(const Polyline& _polyline, const float _width, int _resolution, bool _caps = true, size_t _threads = 0) {
+    return toTube(_polyline, &_width, 1, _resolution, _caps, _threads);
 }
 
+// Batches of many shapes (ex. the buildings of a city tile) into one mesh. Every shape is
+// counted first so the mesh is sized once, then they are written in place across threads.
+// Heights and widths hold a value per shape, or a single one for all of them. _materials,
+// when not empty, holds the material of each shape (tagged on the runs of faces that share
+// one) and _ids, when given, gets the index of the shape each vertex comes from.
+Mesh toSurface(const std::vector<Polygon>& _polygons, const std::vector<float>& _heights = std::vector<float>(),
+                const std::vector<MaterialPtr>& _materials = std::vector<MaterialPtr>(), std::vector<uint32_t>* _ids = nullptr, size_t _threads = 0);
+
+Mesh toWall(const std::vector<Polygon>& _polygons, const std::vector<float>& _maxHeights, const std::vector<float>& _minHeights = std::vector<float>(),
+                const std::vector<MaterialPtr>& _materials = std::vector<MaterialPtr>(), std::vector<uint32_t>* _ids = nullptr, size_t _threads = 0);
+
+Mesh toSpline(const std::vector<Polyline>& _polylines, const std::vector<float>& _widths, JoinType _join = JoinType::MITER, CapType _cap = CapType::BUTT, float _miterLimit = 3.0,
+                const std::vector<MaterialPtr>& _materials = std::vector<MaterialPtr>(), std::vector<uint32_t>* _ids = nullptr, size_t _threads = 0);
+
+Mesh toTube(const std::vector<Polyline>& _polylines, const std::vector<float>& _widths, int _resolution, bool _caps = true,
+                const std::vector<MaterialPtr>& _materials = std::vector<MaterialPtr>(), std::vector<uint32_t>* _ids = nullptr, size_t _threads = 0);
+
+// Edges of the triangles, the ones they share only once
 std::vector<Line>   toLines(const std::vector<Triangle>& _triangles);
 std::vector<Line>   toLines(const BoundingBox& _bbox);
 
+// Unique edges of the triangles of a mesh as a mesh of LINES (over the vertices the edges use,
+// with their colors, normals and texcoords). Each edge comes once, however many faces share it.
+Mesh toEdges(const Mesh& _mesh);
+
+// Only the edges used by a single face, the open borders of the surface
+Mesh toBoundaryEdges(const Mesh& _mesh);
+
+// Only the edges where the faces meet at more than _angle (in radians), plus the borders
+Mesh toFeatureEdges(const Mesh& _mesh, float _angle);
+
+// Only the edges between a face looking to _viewPoint and one looking away, plus the borders
+Mesh toSilhouetteEdges(const Mesh& _mesh, const glm::vec3& _viewPoint);
+
 }
\ No newline at end of file
@@ -18,7 +18,7 @@ namespace hilma {
 
 // 2D
 //
-bool inside(const std::vector<glm::vec2> _points, const glm::vec2 _v);
+bool inside(const std::vector<glm::vec2>& _points, const glm::vec2& _v);
 
 bool intersection(  const glm::vec2 &_line1Start, const glm::vec2 &_line1End,
                     const glm::vec2 &_line2Start, const glm::vec2 &_line2End,
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "hilma/types/Image.h"
+
+namespace hilma {
+
+// Chain of pointwise operations recorded lazily and applied to an image in a single
+// pass: rows are split across threads and each small chunk of values goes through
+// every operation while it's still in cache. Ex:
+//
+//      ImagePipeline().invert().gamma(2.2f).autolevel().threshold(0.5f).apply(image);
+//
+// autolevel() needs the range of the values so far, so it's the only operation that
+// adds a pass (which also does the work of every operation before it).
+class ImagePipeline {
+public:
+
+    ImagePipeline&  add(float _value);
+    ImagePipeline&  subtract(float _value) { return add(-_value); }
+    ImagePipeline&  multiply(float _value);
+    ImagePipeline&  divide(float _value) { return multiply(1.0f / _value); }
+    ImagePipeline&  multiplyAdd(float _scale, float _offset);
+    ImagePipeline&  clamp(float _min, float _max);
+
+    ImagePipeline&  sqrt();
+    ImagePipeline&  invert();
+    ImagePipeline&  gamma(float _gamma);
+    ImagePipeline&  remap(float _in_min, float _in_max, float _out_min, float _out_max, bool _clamp);
+    ImagePipeline&  threshold(float _threshold = 0.5f);
+    ImagePipeline&  autolevel();
+
+    size_t          size() const { return ops.size(); }
+    void            clear() { ops.clear(); }
+
+    void            apply(Image& _image, size_t _threads = 0) const;
+    Image           apply(const Image& _image, size_t _threads = 0) const;
+
+private:
+    enum OpType {
+        OP_MULTIPLY_ADD = 0,
+        OP_CLAMP,
+        OP_SQRT,
+        OP_GAMMA,
+        OP_THRESHOLD,
+        OP_AUTOLEVEL
+    };
+
+    struct Op {
+        OpType  type;
+        float   a;
+        float   b;
+    };
+
+    ImagePipeline&  push(OpType _type, float _a = 0.0f, float _b = 0.0f);
+
+    // one pass over the image running _ops, and optionally measuring the range of the result
+    static void     pass(Image& _image, const std::vector<Op>& _ops, bool _range, float& _lo, float& _hi, size_t _threads);
+    static void     run(const std::vector<Op>& _ops, float* _values, size_t _n);
+    // range of the values after _op, given they were in [_lo, _hi]
+    static void     bound(const Op& _op, float& _lo, float& _hi);
+
+    std::vector<Op> ops;
+};
+
+}
@@ -41,21 +41,21 @@ void center(std::vector<glm::vec3>& _points);
 
 // Polyline
 //
-inline void scale(Polyline& _polyline, float _v) { scale(_polyline.points, _v); };
-inline void scaleX(Polyline& _polyline, float _x) { scaleX(_polyline.points, _x); };
-inline void scaleY(Polyline& _polyline, float _y) { scaleY(_polyline.points, _y); };
-inline void scaleZ(Polyline& _polyline, float _z) { scaleZ(_polyline.points, _z); };
-inline void scale(Polyline& _polyline, const glm::vec3& _v) { scale(_polyline.points, _v); };
-inline void scale(Polyline& _polyline, float _x, float _y, float _z = 1.0f) { scale(_polyline.points, _x, _y, _z); };
-
-inline void translateX(Polyline& _polyline, float _x) { translateX(_polyline.points, _x); };
-inline void translateY(Polyline& _polyline, float _y) { translateY(_polyline.points, _y); };
-inline void translateZ(Polyline& _polyline, float _z) { translateZ(_polyline.points, _z); };
-inline void translate(Polyline& _polyline, const glm::vec3& _v) { translate(_polyline.points, _v); };
-inline void translate(Polyline& _polyline, float _x, float _y, float _z = 0.0f) { translate(_polyline.points, _x, _y, _z);};
-
-inline void translateY(Polyline& _polyline, const Image& _grayscale) { translateY(_polyline.points, _grayscale); };
-inline void translateZ(Polyline& _polyline, const Image& _grayscale) { translateZ(_polyline.points, _grayscale); };
+inline void scale(Polyline& _polyline, float _v) { scale(_polyline.points, _v); _polyline.flagHasChanged(); };
+inline void scaleX(Polyline& _polyline, float _x) { scaleX(_polyline.points, _x); _polyline.flagHasChanged(); };
+inline void scaleY(Polyline& _polyline, float _y) { scaleY(_polyline.points, _y); _polyline.flagHasChanged(); };
+inline void scaleZ(Polyline& _polyline, float _z) { scaleZ(_polyline.points, _z); _polyline.flagHasChanged(); };
+inline void scale(Polyline& _polyline, const glm::vec3& _v) { scale(_polyline.points, _v); _polyline.flagHasChanged(); };
+inline void scale(Polyline& _polyline, float _x, float _y, float _z = 1.0f) { scale(_polyline.points, _x, _y, _z); _polyline.flagHasChanged(); };
+
+inline void translateX(Polyline& _polyline, float _x) { translateX(_polyline.points, _x); _polyline.flagHasChanged(); };
+inline void translateY(Polyline& _polyline, float _y) { translateY(_polyline.points, _y); _polyline.flagHasChanged(); };
+inline void translateZ(Polyline& _polyline, float _z) { translateZ(_polyline.points, _z); _polyline.flagHasChanged(); };
+inline void translate(Polyline& _polyline, const glm::vec3& _v) { translate(_polyline.points, _v); _polyline.flagHasChanged(); };
+inline void translate(Polyline& _polyline, float _x, float _y, float _z = 0.0f) { translate(_polyline.points, _x, _y, _z); _polyline.flagHasChanged(); };
+
+inline void translateY(Polyline& _polyline, const Image& _grayscale) { translateY(_polyline.points, _grayscale); _polyline.flagHasChanged(); };
+inline void translateZ(Polyline& _polyline, const Image& _grayscale) { translateZ(_polyline.points, _grayscale); _polyline.flagHasChanged(); };
 
 void rotateX(Polyline& _polyline, float _rad);
 void rotateY(Polyline& _polyline, float _rad);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+namespace hilma
+{
+
+// Number of worker threads to use, never less than one.
+inline size_t getThreadsTotal() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs _job(i, thread) for every i in [0, _total) on a pool of threads that pull
+// indices from a shared counter, so uneven jobs balance out. thread is the worker
+// index in [0, _threads), handy to pick per-thread scratch memory.
+template<typename F>
+void parallelFor(size_t _total, F _job, size_t _threads = 0) {
+    if (_threads == 0)
+        _threads = getThreadsTotal();
+    _threads = std::min(_threads, _total);
+
+    if (_threads <= 1) {
+        for (size_t i = 0; i < _total; i++)
+            _job(i, 0);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < _threads; t++)
+        threads.push_back( std::thread( [&_job, &next, _total, t]() {
+            for (size_t i = next++; i < _total; i = next++)
+                _job(i, t);
+        }) );
+
+    for (std::thread& t : threads)
+        t.join();
+}
+
+}
@@ -18,6 +18,9 @@ public:
 
     Ray getRay(float s, float t) const;
 
+    // Angle covered by a pixel on an image _height pixels tall, opens the ray cones
+    float getPixelSpread(int _height) const;
+
 private:
     glm::vec3   origin;
     glm::vec3   lower_left_corner;
@@ -3,39 +3,91 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <algorithm>
 
 #include "glm/glm.hpp"
 
 namespace hilma {
 
+// How each channel value is stored. Values are always read and written as floats
+// (normalized to 0.0-1.0 for the integer types) and converted on access.
+enum ImageType {
+    IMAGE_FLOAT32 = 0,
+    IMAGE_FLOAT16 = 1,
+    IMAGE_UINT16 = 2,
+    IMAGE_UINT8 = 3
+};
+
+// How pixels are ordered in memory. Tiled layouts keep 2D neighbours close, which helps
+// kernels and texture sampling on large images. They are padded to whole tiles.
+enum ImageLayout {
+    LAYOUT_LINEAR = 0,  // rows one after the other
+    LAYOUT_TILED = 1,   // 64x64 tiles, rows inside each tile
+    LAYOUT_MORTON = 2   // 64x64 tiles, Z-order (Morton) inside each tile
+};
+
+class Image;
+typedef std::shared_ptr<Image> ImagePtr;
+typedef std::shared_ptr<Image const> ImageConstPtr;
+
 class Image {
 public:
 
     Image();
     Image(const Image& _mother);
+    Image(Image&& _mother);
     Image(int _width, int _height, int _channels);
+    Image(int _width, int _height, int _channels, ImageType _type, ImageLayout _layout = LAYOUT_LINEAR);
     Image(const uint8_t* _array3D, int _height, int _width, int _channels);
-    
+
     virtual     ~Image();
 
+    Image&      operator= (const Image& _mother);
+    Image&      operator= (Image&& _mother);
+
     bool        allocate(size_t _width, size_t _height, size_t _channels);
-    bool        isAllocated() const { return data.size() != 0; }
+    bool        allocate(size_t _width, size_t _height, size_t _channels, ImageType _type, ImageLayout _layout = LAYOUT_LINEAR);
+    bool        isAllocated() const { return data.size() != 0 || bytes.size() != 0; }
+
+    // Re store the pixels with another type and/or layout
+    void        convert(ImageType _type, ImageLayout _layout = LAYOUT_LINEAR);
+
+    // Integer types only hold 0.0-1.0, if values in [_min, _max] don't fit they are
+    // converted to IMAGE_FLOAT32 (keeping the layout). The arithmetic operators and
+    // ImagePipeline call it before writing, so ops on loaded 8/16-bit images don't clamp.
+    void        promote(float _min, float _max);
 
     int         getWidth() const { return width;}
     int         getHeight() const { return height;};
     int         getChannels() const { return channels;};
+    ImageType   getType() const { return type; }
+    ImageLayout getLayout() const { return layout; }
 
+    // Raw access to the float storage, only valid for IMAGE_FLOAT32 images.
+    // Use getValue()/setValue() for the rest
     const float& at(int _index) const { return data[_index]; }
     const float& operator[] (int _index) const { return data[_index]; }
     float&      operator[] (int _index) { return data[_index]; }
-    
-    size_t      size() const { return data.size(); }
 
-    size_t      getIndex(size_t _x, size_t _y) const { return (_y * width + _x) * channels; };
+    // Raw storage of the other types (ex. straight 8-bit pixels of IMAGE_UINT8 linear images)
+    const uint8_t* getRawBytes() const { return bytes.data(); }
+
+    // Total of values stored (including tile padding) and how much memory they use
+    size_t      size() const { return type == IMAGE_FLOAT32 ? data.size() : bytes.size() / getTypeSize(type); }
+    size_t      getBytes() const { return data.size() * sizeof(float) + bytes.size(); }
+
+    size_t      getIndex(size_t _x, size_t _y) const {
+        if (layout == LAYOUT_LINEAR)
+            return (_y * width + _x) * channels;
+        return getTiledIndex(_x, _y);
+    };
     size_t      getIndexUV(float _u, float _v) const { return getIndex(_u * width, _v * height); }
 
+    // 8-bit pixels are kept as they are (IMAGE_UINT8), convert() them to process them as floats
     void        set(const uint8_t* _array3D, int _height, int _width, int _channels);
 
+    // Integer types clamp to 0.0-1.0 and round to their 8/16 bits, see promote()
     void        setValue(size_t _index, float _data);
     void        setValue(size_t _index, const float* _array1D, int _n);
 
@@ -48,29 +100,51 @@ public:
 
     float       getValue(size_t _index) const;
     glm::vec4   getColor(size_t _index) const;
-    
+
+    // Mip levels (1 is half the size, 2 a quarter...) are built the first time they are
+    // requested and kept until clearMips(). Edit the image before asking for them.
+    ImageConstPtr getMip(size_t _level) const;
+    size_t      getMipsTotal() const;
+    void        clearMips();
+
     Image       operator+ (float _value) const;
     Image       operator- (float _value) const;
     Image       operator* (float _value) const;
     Image       operator/ (float _value) const;
-    
+
     Image&      operator+= (float _value);
     Image&      operator-= (float _value);
     Image&      operator*= (float _value);
     Image&      operator/= (float _value);
 
+    static size_t getTypeSize(ImageType _type);
+    static const int TILE_SIZE = 64;
+
     std::string name;
 
 private:
-    std::vector<float>  data;
-    int                 width;
-    int                 height;
-    int                 channels;
+    struct Mips;
+
+    size_t      getTiledIndex(size_t _x, size_t _y) const;
+    float       getElement(size_t _index) const;
+    void        setElement(size_t _index, float _value);
+
+    // applies _op to every element, in parallel chunks (defined on Image.cpp)
+    template<typename F>
+    void        forEachElement(F _op);
+
+    std::vector<float>      data;   // IMAGE_FLOAT32
+    std::vector<uint8_t>    bytes;  // any other type
+    int                     width;
+    int                     height;
+    int                     channels;
+    int                     tilesX;
+    ImageType               type;
+    ImageLayout             layout;
+
+    mutable std::shared_ptr<Mips> mips;
 
     friend bool load( const std::string&, Image&, int );
 };
 
-typedef std::shared_ptr<Image> ImagePtr;
-typedef std::shared_ptr<Image const> ImageConstPtr;
-
-}
\ No newline at end of file
+}
@@ -8,6 +8,7 @@
 #include "glm/glm.hpp"
 
 #include "hilma/types/Image.h"
+#include "hilma/types/Texture.h"
 
 namespace hilma {
 
@@ -17,6 +18,28 @@ enum MaterialPropertyType {
     TEXTURE = 2
 };
 
+// Properties the renderer knows about, resolved once into a MaterialHandle
+enum MaterialSlot {
+    DIFFUSE = 0,
+    SPECULAR,
+    EMISSIVE,
+    ROUGHNESS,
+    METALLIC,
+    OPACITY,
+    OCCLUSION,
+    NORMALMAP,
+    BUMPMAP,
+    DISPLACEMENTMAP,
+    MATERIAL_SLOTS_TOTAL
+};
+
+// Property name for a slot, and the slot for a name (MATERIAL_SLOTS_TOTAL if it's not one)
+std::string     toString(MaterialSlot _slot);
+MaterialSlot    toMaterialSlot(const std::string& _property);
+
+class MaterialHandle;
+typedef std::shared_ptr<const MaterialHandle> MaterialHandleConstPtr;
+
 class Material {
 public:
     // Material() {}
@@ -34,12 +57,17 @@ public:
     bool            haveProperty(const std::string& _property) const;
 
     std::string     getImagePath(const std::string& _property) const;
+    ImagePtr        getImagePtr(const std::string& _property) const;
     Image           getImage(const std::string& _property) const;
     glm::vec4       getColor(const std::string& _property, const glm::vec2& _uv) const;
     float           getValue(const std::string& _property, const glm::vec2& _uv) const;
     glm::vec4       getColor(const std::string& _property) const;
     float           getValue(const std::string& _property) const;
 
+    // Slot indexed view of this material with its textures ready to sample. Built the first
+    // time is requested and kept until the material changes.
+    MaterialHandleConstPtr getHandle() const;
+
     int             illuminationModel;      // illum
 
     std::string     name;
@@ -50,9 +78,37 @@ public:
     std::map<const std::string, float>        values;
     std::map<const std::string, glm::vec4>    colors;
 
+    // images set in memory, the ones from files live on the TextureCache
     std::map<const std::string, ImagePtr>     textures;
     std::map<const std::string, std::string>  texturesPaths;
 
+private:
+    mutable MaterialHandleConstPtr            handle;
+};
+
+class MaterialHandle {
+public:
+    MaterialHandle(const Material& _material, TextureWrap _wrap = WRAP_REPEAT, TextureFilter _filter = FILTER_TRILINEAR);
+
+    bool            have(MaterialSlot _slot) const { return slots[_slot].defined; }
+    MaterialPropertyType getType(MaterialSlot _slot) const { return slots[_slot].type; }
+    const Texture&  getTexture(MaterialSlot _slot) const { return slots[_slot].texture; }
+
+    // _footprint is the UV area side covered by the sample, used to pick the mip level
+    glm::vec4       getColor(MaterialSlot _slot, const glm::vec2& _uv, float _footprint = 0.0f) const;
+    float           getValue(MaterialSlot _slot, const glm::vec2& _uv, float _footprint = 0.0f) const;
+    glm::vec4       getColor(MaterialSlot _slot) const;
+    float           getValue(MaterialSlot _slot) const;
+
+private:
+    struct Slot {
+        bool                    defined = false;
+        MaterialPropertyType    type = VALUE;
+        glm::vec4               color = glm::vec4(-1.0f);
+        Texture                 texture;
+    };
+
+    Slot            slots[MATERIAL_SLOTS_TOTAL];
 };
 
 typedef std::shared_ptr<Material> MaterialPtr;
@@ -48,6 +48,9 @@ public:
     void        clear();
     void        append(const Mesh& _mesh);
 
+    // Makes room for a known amount of vertices (and their normals/texcoords) and face indices
+    void        reserve(size_t _vertices, size_t _faceIndices, bool _normals = false, bool _texcoords = false);
+
     void        setFaceType(FaceType _mode = TRIANGLES, bool _compute = false);
     FaceType    getFaceType() const { return faceMode; };
 
@@ -199,6 +202,7 @@ private:
     friend bool loadStl( const std::string&, Mesh& );
     friend bool loadObj( const std::string&, Mesh& );
     friend bool saveObj( const std::string&, const Mesh& );
+    friend bool saveGlb( const std::string&, const Mesh&, bool, bool );
 
     friend void scale(Mesh&, float );
     friend void scaleX(Mesh&, float );
@@ -225,6 +229,8 @@ private:
     friend void center(Mesh&);
 
     friend BoundingBox getBoundingBox(const Mesh&);
+
+    friend class MeshBatch;
 };
 
 }
\ No newline at end of file
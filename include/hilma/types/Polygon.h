@@ -1,9 +1,13 @@
 #pragma once
 
+#include <memory>
+
 #include "hilma/types/Polyline.h"
 
 namespace hilma {
 
+class PolygonGrid;
+
 class Polygon {
 public:
 
@@ -18,16 +22,26 @@ public:
     void append( const std::vector< std::vector<glm::vec3> >& _polygon );
 
     const Polyline& operator[] (int _index) const { return data[_index]; }
-    Polyline&   operator[] (int _index) { return data[_index]; }
+    Polyline&   operator[] (int _index) { grid.reset(); return data[_index]; }
 
     const Polyline& get(int _index) const { return data[_index]; }
-    Polyline&   get(int _index) { return data[_index]; }
+    Polyline&   get(int _index) { grid.reset(); return data[_index]; }
 
     size_t size() const { return data.size(); }
 
+    // Point queries (on x,y) through a PolygonGrid made the first time one is asked.
+    // Rings are closed and holes follow the even-odd rule. Build it with getGrid()
+    // before querying from several threads.
+    bool        inside(const glm::vec2& _point) const;
+    glm::vec2   getClosestPoint(const glm::vec2& _point) const;
+    float       getDistance(const glm::vec2& _point, bool _signed = false) const;
+    const PolygonGrid& getGrid() const;
+
 private:
     std::vector<Polyline>   data;
 
+    mutable std::shared_ptr<PolygonGrid> grid;
+
 };
 
 }
\ No newline at end of file
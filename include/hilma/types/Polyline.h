@@ -432,6 +432,11 @@ public:
     /// => 25% along the path)
     glm::vec3 getPointAtPercent(float f) const;
 
+    /// \brief Get the points at many lengths along the path at once. Lengths in
+    /// increasing order are found in a single walk over the segments, the
+    /// rest through a binary search.
+    std::vector<glm::vec3> getPointsAtLengths(const std::vector<float>& lengths) const;
+
     /// \brief Get point along the path at interpolated index (e.g. `f=5.75` =>
     /// 75% along the path between 5th and 6th points)
     glm::vec3 getPointAtIndexInterpolated(float findex) const;
@@ -498,12 +503,17 @@ private:
     bool bClosed;
     bool bHasChanged;   // public API has access to this
     mutable bool bCacheIsDirty;   // used only internally, no public API to read
+    mutable bool bLengthsAreDirty;  // lengths are kept apart, they are cheaper and more often asked
 
     void updateCache(bool bForceUpdate = false) const;
+    void updateLengths() const;
 
     // given an interpolated index (e.g. 5.75) return neighboring indices and interolation factor (e.g. 5, 6, 0.75)
     void getInterpolationParams(float findex, int &i1, int &i2, float &t) const;
 
+    // segment at a length along the path and how far along it (from 0 to 1) through a binary search
+    int getSegmentAtLength(float length, float &t) const;
+
     void calcData(int index, glm::vec3&tangent, float &angle, glm::vec3&rotation, glm::vec3&normal) const;
 
     friend void scale(Polyline&, float );
@@ -7,8 +7,8 @@ namespace hilma {
 class Ray {
 public:
     
-    Ray(): origin(0.0,0.0,0.0), direction(1.0,0.0,0.0) { };
-    Ray(const glm::vec3& _org, const glm::vec3& _dir) { set(_org, _dir); };
+    Ray(): origin(0.0,0.0,0.0), direction(1.0,0.0,0.0), coneWidth(0.0f), coneSpread(0.0f) { };
+    Ray(const glm::vec3& _org, const glm::vec3& _dir): coneWidth(0.0f), coneSpread(0.0f) { set(_org, _dir); };
     
     void set(const glm::vec3& _org, const glm::vec3& _dir){
         origin = _org;
@@ -21,11 +21,20 @@ public:
     const glm::vec3& getInvertDirection() const { return invDirection; }
     
     glm::vec3 getAt(float _t) const { return origin + direction * _t; }
+
+    // Ray cone: width at the origin and how much it grows per unit of distance (the angle).
+    // Used to know how big is the footprint of a pixel where the ray lands.
+    void  setCone(float _width, float _spread) { coneWidth = _width; coneSpread = _spread; }
+    float getConeWidth() const { return coneWidth; }
+    float getConeSpread() const { return coneSpread; }
+    float getConeWidthAt(float _t) const { return coneWidth + coneSpread * _t; }
     
 private:
     glm::vec3 origin;
     glm::vec3 direction;
     glm::vec3 invDirection;
+    float     coneWidth;
+    float     coneSpread;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "glm/glm.hpp"
+
+#include "hilma/types/Image.h"
+
+namespace hilma {
+
+enum TextureWrap {
+    WRAP_CLAMP = 0,
+    WRAP_REPEAT = 1,
+    WRAP_MIRROR = 2
+};
+
+enum TextureFilter {
+    FILTER_NEAREST = 0,
+    FILTER_BILINEAR = 1,
+    FILTER_TRILINEAR = 2
+};
+
+// Read only view of an Image for sampling. Nothing is copied, for trilinear filtering
+// it holds on to the image mip levels (built by the image the first time).
+class Texture {
+public:
+    Texture();
+    Texture(const ImageConstPtr& _image, TextureWrap _wrap = WRAP_REPEAT, TextureFilter _filter = FILTER_TRILINEAR);
+
+    bool            isAllocated() const { return image != nullptr; }
+
+    int             getWidth() const { return image ? image->getWidth() : 0; }
+    int             getHeight() const { return image ? image->getHeight() : 0; }
+    size_t          getLevelsTotal() const { return levels.size() + (image ? 1 : 0); }
+
+    TextureWrap     getWrap() const { return wrap; }
+    TextureFilter   getFilter() const { return filter; }
+
+    // _footprint is how much of the UV space a sample covers (ex. a pixel), 0 for the sharpest level
+    glm::vec4       sample(const glm::vec2& _uv, float _footprint = 0.0f) const;
+
+    // Level of detail for a given UV footprint
+    float           getLod(float _footprint) const;
+
+private:
+    const Image&    getLevel(size_t _level) const { return _level == 0 ? *image : *levels[_level-1]; }
+    int             wrapCoord(int _x, int _size) const;
+    glm::vec4       fetch(const Image& _level, int _x, int _y) const;
+    glm::vec4       nearest(const Image& _level, const glm::vec2& _uv) const;
+    glm::vec4       bilinear(const Image& _level, const glm::vec2& _uv) const;
+
+    ImageConstPtr       image;
+    std::vector<ImageConstPtr> levels;
+
+    TextureWrap         wrap;
+    TextureFilter       filter;
+};
+
+typedef std::shared_ptr<Texture> TexturePtr;
+typedef std::shared_ptr<const Texture> TextureConstPtr;
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "hilma/types/Image.h"
+
+namespace hilma {
+
+// Process-wide cache of images loaded from disk, keyed by path.
+// Images are decoded once (on first request or ahead of time on a background
+// pool) and shared by every material that uses them. When the memory used goes
+// over the budget, the least recently used images that nobody else holds are dropped.
+class TextureCache {
+public:
+
+    static TextureCache& instance();
+
+    // Returns the image for _filename, decoding it (or waiting for the background
+    // decode) the first time. nullptr if it can't be loaded.
+    ImagePtr    get(const std::string& _filename);
+
+    // Queues _filename to be decoded on the background pool
+    void        prefetch(const std::string& _filename);
+
+    bool        have(const std::string& _filename) const;
+    void        release(const std::string& _filename);
+    void        clear();
+
+    // Memory budget in bytes, 0 for no limit
+    void        setBudget(size_t _bytes);
+    size_t      getBudget() const { return budget; }
+    size_t      getMemoryUsage() const;
+    size_t      getTotal() const;
+
+private:
+    TextureCache();
+    ~TextureCache();
+
+    typedef std::shared_ptr< std::promise<ImagePtr> > ImagePromise;
+
+    struct Entry {
+        std::shared_future<ImagePtr>        future;
+        ImagePromise                        promise;    // still not decoding
+        size_t                              bytes = 0;
+        std::list<std::string>::iterator    lru;
+    };
+
+    void        decode(const std::string& _filename, ImagePromise _promise);
+    void        evict();
+    void        worker();
+
+    std::unordered_map<std::string, Entry>  entries;
+    std::list<std::string>                  lru;
+    std::deque<std::string>                 queue;
+
+    std::vector<std::thread>                workers;
+    mutable std::mutex                      mutex;
+    std::condition_variable                 condition;
+
+    size_t                                  budget;
+    size_t                                  usage;
+    bool                                    running;
+};
+
+}
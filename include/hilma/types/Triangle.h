@@ -37,18 +37,20 @@ public :
     void                setColor(float _r, float _g, float _b, float _a = 1.0f);
     void                setColor(size_t _index, const glm::vec4& _color);
     const glm::vec4&    getColor(size_t _index) const { return colors[_index]; }
-    glm::vec4           getColor(const glm::vec3& _barycenterCoord ) const;
+    glm::vec4           getColor(const glm::vec3& _barycenterCoord, float _footprint = 0.0f ) const;
 
     bool                haveNormals() const { return !normals.empty(); }
     void                setNormal(size_t _index, const glm::vec3& _normal);
     const glm::vec3&    getNormal() const { return normal; }
     const glm::vec3&    getNormal(size_t _index) const { return normals[_index]; }
-    glm::vec3           getNormal(const glm::vec3& _barycenterCoord ) const;
+    glm::vec3           getNormal(const glm::vec3& _barycenterCoord, float _footprint = 0.0f ) const;
 
     bool                haveTexCoords() const { return !texcoords.empty(); }
     void                setTexCoord(size_t _index, const glm::vec2& _texcoord);
     const glm::vec2&    getTexCoord(size_t _index) const { return texcoords[_index]; }
     glm::vec2           getTexCoord(const glm::vec3& _barycenterCoord ) const;
+    // UV units per world unit over this triangle, turns a world footprint into a texture one
+    float               getTexCoordDensity() const;
 
     bool                haveTangents() const { return !tangents.empty(); }
     void                setTangent(size_t _index, const glm::vec4& _tangent);
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cfloat>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "hilma/types/Image.h"
+
+namespace hilma {
+
+// Sparse 3D grid of floats stored in 8x8x8 bricks. Bricks are only allocated where
+// detail is needed (ex. near the surface of an SDF), everywhere else a brick is a single
+// constant value (a tile). Voxel x,y,z sits at origin + (x,y,z + 0.5) * voxelSize.
+class Volume {
+public:
+    Volume();
+    Volume(int _width, int _height, int _depth, float _background = 0.0f);
+
+    void        allocate(int _width, int _height, int _depth, float _background = 0.0f);
+    void        clear();
+
+    int         getWidth() const { return width; }
+    int         getHeight() const { return height; }
+    int         getDepth() const { return depth; }
+
+    static const int BRICK_BITS = 3;
+    static const int BRICK_SIZE = 1 << BRICK_BITS;
+
+    // bricks
+    int         getBricksWidth() const { return bricksWidth; }
+    int         getBricksHeight() const { return bricksHeight; }
+    int         getBricksDepth() const { return bricksDepth; }
+    size_t      getBricksTotal() const { return table.size(); }
+    size_t      getBricksAllocated() const { return data.size() / (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE); }
+    bool        haveBrick(int _bx, int _by, int _bz) const { return table[getBrickIndex(_bx, _by, _bz)] >= 0; }
+    void        allocateBrick(int _bx, int _by, int _bz);
+    void        setTile(int _bx, int _by, int _bz, float _value);
+    float       getTile(int _bx, int _by, int _bz) const { return tiles[getBrickIndex(_bx, _by, _bz)]; }
+
+    // Memory used by the bricks, tiles and tables
+    size_t      getBytes() const;
+
+    // voxels (outside the volume reads the closest edge)
+    void        setValue(int _x, int _y, int _z, float _value);
+    float       getValue(int _x, int _y, int _z) const;
+
+    // Trilinear sampling and its gradient, on voxel coordinates (voxel centers on integers)
+    float       sample(const glm::vec3& _voxel) const;
+    glm::vec3   getGradient(const glm::vec3& _voxel) const;
+    glm::vec3   getNormal(const glm::vec3& _voxel) const;
+
+    glm::vec3   toVoxel(const glm::vec3& _world) const { return (_world - origin) / voxelSize - 0.5f; }
+    glm::vec3   toWorld(const glm::vec3& _voxel) const { return origin + (_voxel + 0.5f) * voxelSize; }
+
+    // Dense Z slices, one image per voxel layer
+    Image       getSlice(int _z) const;
+    std::vector<Image> getSlices() const;
+
+    glm::vec3   origin;
+    float       voxelSize;
+
+private:
+    size_t      getBrickIndex(int _bx, int _by, int _bz) const { return (size_t(_bz) * bricksHeight + _by) * bricksWidth + _bx; }
+
+    std::vector<int32_t>    table;  // brick offset (in bricks) on data, -1 for tiles
+    std::vector<float>      tiles;  // value of the bricks that are not allocated
+    std::vector<float>      data;
+
+    int         width;
+    int         height;
+    int         depth;
+    int         bricksWidth;
+    int         bricksHeight;
+    int         bricksDepth;
+};
+
+typedef std::shared_ptr<Volume> VolumePtr;
+
+}
@@ -24,11 +24,14 @@ hilma_module = Extension(
     'src/types/Camera.cpp',
     'src/types/Image.cpp',
     'src/types/Material.cpp',
+    'src/types/Texture.cpp',
+    'src/types/TextureCache.cpp',
     'src/types/Line.cpp',
     'src/types/Triangle.cpp',
     'src/types/Polygon.cpp',
     'src/types/Polyline.cpp',
     'src/types/Mesh.cpp',
+    'src/types/Volume.cpp',
     'src/ops/compute.cpp',
     'src/ops/convert_image.cpp',
     'src/ops/convert_path.cpp',
@@ -36,13 +39,20 @@ hilma_module = Extension(
     'src/ops/transform.cpp',
     'src/ops/intersection.cpp',
     'src/ops/raytrace.cpp',
+    'src/ops/pipeline.cpp',
+    'src/ops/boolean.cpp',
     'src/io/obj.cpp',
     'src/io/ply.cpp',
     'src/io/stl.cpp',
     'src/io/gltf.cpp',
     'src/io/auto.cpp',
+    'src/io/raw.cpp',
+    'src/io/terrain.cpp',
+    'src/io/async.cpp',
     'src/accel/BVH.cpp',
     'src/accel/KdTree.cpp',
+    'src/accel/MeshBVH.cpp',
+    'src/accel/PolygonGrid.cpp',
    ],
    swig_opts = ['-c++']
 )
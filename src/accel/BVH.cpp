@@ -2,6 +2,7 @@
 
 #include "hilma/ops/intersection.h"
 
+#include <cfloat>
 #include <algorithm>
 
 namespace hilma {
@@ -102,36 +103,51 @@ std::shared_ptr<BVH> BVH::hit(const Ray& _ray, float& _minDistance, float& _maxD
         return std::make_shared<BVH>( *this );
 }
 
-std::shared_ptr<BVH> BVH::closest(const glm::vec3& _point) {
-    if ( !contains(_point) )
-        return nullptr;
-
-     if (!leaf) {
-        std::shared_ptr<BVH> left_c = left->closest(_point);
-        std::shared_ptr<BVH> right_c = right->closest(_point);
-
-        if (left_c != nullptr && right_c != nullptr) {
-            // // Both hit, get the closer
-            // float left_distance = glm::distance(_point, left_c->getCenter());
-            // float right_distance = glm::distance(_point, right_c->getCenter());
-            // if (left_distance < right_distance)
-            //     return left_c;
-            // else
-            //     return right_c;
-
-            // both hits return it self
-            return std::make_shared<BVH>( *this );
+// Branch and bound over the children, visiting the nearest box first. _best is the squared
+// distance to the closest triangle found so far and _leaf the node that holds it.
+static void closest(const std::shared_ptr<BVH>& _node, const glm::vec3& _point, float& _best, std::shared_ptr<BVH>& _leaf) {
+    glm::vec3 d = glm::max(glm::max(_node->min - _point, _point - _node->max), glm::vec3(0.0f));
+    if (glm::dot(d, d) > _best)
+        return;
+
+    if (_node->leaf) {
+        glm::vec3 p;
+        for (size_t i = 0; i < _node->elements.size(); i++) {
+            float dist = distance(_point, _node->elements[i], p);
+            if (dist * dist < _best) {
+                _best = dist * dist;
+                _leaf = _node;
+            }
         }
-        else if (left_c != nullptr) 
-            return left_c;
-        else if (right_c != nullptr)
-            return right_c;
+        return;
+    }
 
-        return nullptr;
+    glm::vec3 dl = glm::max(glm::max(_node->left->min - _point, _point - _node->left->max), glm::vec3(0.0f));
+    glm::vec3 dr = glm::max(glm::max(_node->right->min - _point, _point - _node->right->max), glm::vec3(0.0f));
+    if (glm::dot(dl, dl) <= glm::dot(dr, dr)) {
+        closest(_node->left, _point, _best, _leaf);
+        closest(_node->right, _point, _best, _leaf);
+    }
+    else {
+        closest(_node->right, _point, _best, _leaf);
+        closest(_node->left, _point, _best, _leaf);
     }
-    else
-        return std::make_shared<BVH>( *this );
 }
 
+std::shared_ptr<BVH> BVH::closest(const glm::vec3& _point) {
+    // a single leaf has nothing else to look at
+    if (leaf)
+        return std::make_shared<BVH>( *this );
+
+    if (left == nullptr || right == nullptr)
+        return nullptr;
+
+    // the leaves are already owned by their parents, return those instead of copies
+    float best = FLT_MAX;
+    std::shared_ptr<BVH> found = nullptr;
+    hilma::closest(left, _point, best, found);
+    hilma::closest(right, _point, best, found);
+    return found;
+}
 
 }
\ No newline at end of file
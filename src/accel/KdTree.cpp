@@ -46,7 +46,7 @@ void KDTree<HullType>::construct(unsigned int node, const BoundingBox& box, unsi
     // Sort range according to center of the longest side.
     std::sort(lst.begin() + b, lst.begin() + b + n, 
         [&](unsigned int a, unsigned int b) {
-            return entityPosition(a)(max_dir) < entityPosition(b)(max_dir);
+            return entityPosition(a)[max_dir] < entityPosition(b)[max_dir];
         }
     );
 
@@ -57,10 +57,10 @@ void KDTree<HullType>::construct(unsigned int node, const BoundingBox& box, unsi
     nodes[node].children[1] = n1;
 
     auto c = 0.5 * (
-        entityPosition(lst[b + hal -1])(max_dir) + 
-        entityPosition(lst[b + hal   ])(max_dir));
-    auto l_box = box; l_box.max()(max_dir) = c;
-    auto r_box = box; r_box.min()(max_dir) = c;
+        entityPosition(lst[b + hal -1])[max_dir] + 
+        entityPosition(lst[b + hal   ])[max_dir]);
+    auto l_box = box; l_box.max[max_dir] = c;
+    auto r_box = box; r_box.min[max_dir] = c;
 
     construct(nodes[node].children[0], l_box, b, hal);
     construct(nodes[node].children[1], r_box, b + hal, n - hal);
@@ -150,8 +150,8 @@ void KDTree<HullType>::traverseDepthFirst(unsigned int node_index, unsigned int
 
 
 template <typename HullType>
-void KDTree<HullType>::traverseBreadthFirst(const TraversalPredicate& pred, const TraversalCallback& cb, unsigned int start_node, const TraversalPriorityLess& pless, TraversalQueue& pending) const {
-    //auto pending = TraversalQueue{};
+void KDTree<HullType>::traverseBreadthFirst(const TraversalPredicate& pred, const TraversalCallback& cb, unsigned int start_node, const TraversalPriorityLess& pless) const {
+    auto pending = TraversalQueue{};
     cb(start_node, 0);
     if (pred(start_node, 0)) pending.push({ start_node, 0 });
     traverseBreadthFirst(pending, pred, cb, pless);
@@ -171,8 +171,8 @@ void KDTree<HullType>::update() {
     traverseDepthFirst(
         [&](unsigned int, unsigned int) { return true; },
         [&](unsigned int node_index, unsigned int) {
-            auto const& node = node(node_index);
-            computeHull(node.begin, node.n, hull(node_index));
+            Node const& n = nodes[node_index];
+            computeHull(n.begin, n.n, hulls[node_index]);
         }
     );
 }
@@ -187,7 +187,7 @@ void KDTree<HullType>::traverseBreadthFirst(TraversalQueue& pending, const Trave
 
         cb(n, d);
         auto is_pred = pred(n, d);
-        if (!node.is_leaf() && is_pred) {
+        if (!node.isLeaf() && is_pred) {
             if (pless && !pless(node.children)) {
                 pending.push({ static_cast<unsigned int>(node.children[1]), d + 1 });
                 pending.push({ static_cast<unsigned int>(node.children[0]), d + 1 });
@@ -0,0 +1,297 @@
+#include "hilma/accel/MeshBVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "hilma/parallel.h"
+
+namespace hilma {
+
+const uint32_t LEAF_SIZE = 4;
+const float FOUR_PI = 12.5663706144f;
+
+// Barycentric coordinates of the closest point to _p on the triangle _a, _b, _c
+// (Ericson, Real-Time Collision Detection 5.1.5)
+static glm::vec3 closestOnTriangle(const glm::vec3& _p, const glm::vec3& _a, const glm::vec3& _b, const glm::vec3& _c) {
+    glm::vec3 ab = _b - _a;
+    glm::vec3 ac = _c - _a;
+    glm::vec3 ap = _p - _a;
+    float d1 = glm::dot(ab, ap);
+    float d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return glm::vec3(1.0f, 0.0f, 0.0f);
+
+    glm::vec3 bp = _p - _b;
+    float d3 = glm::dot(ab, bp);
+    float d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+        return glm::vec3(0.0f, 1.0f, 0.0f);
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        float v = d1 / (d1 - d3);
+        return glm::vec3(1.0f - v, v, 0.0f);
+    }
+
+    glm::vec3 cp = _p - _c;
+    float d5 = glm::dot(ab, cp);
+    float d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+        return glm::vec3(0.0f, 0.0f, 1.0f);
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        float w = d2 / (d2 - d6);
+        return glm::vec3(1.0f - w, 0.0f, w);
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        return glm::vec3(0.0f, 1.0f - w, w);
+    }
+
+    float denom = 1.0f / (va + vb + vc);
+    float v = vb * denom;
+    float w = vc * denom;
+    return glm::vec3(1.0f - v - w, v, w);
+}
+
+// Squared distance from _p to the box, 0 if inside
+static float distance2ToBox(const glm::vec3& _p, const glm::vec3& _min, const glm::vec3& _max) {
+    glm::vec3 d = glm::max(glm::max(_min - _p, _p - _max), glm::vec3(0.0f));
+    return glm::dot(d, d);
+}
+
+// Signed solid angle of a triangle seen from _p (Van Oosterom & Strackee)
+static float solidAngle(const glm::vec3& _p, const glm::vec3& _a, const glm::vec3& _b, const glm::vec3& _c) {
+    glm::vec3 a = _a - _p;
+    glm::vec3 b = _b - _p;
+    glm::vec3 c = _c - _p;
+    float la = glm::length(a);
+    float lb = glm::length(b);
+    float lc = glm::length(c);
+
+    float num = glm::dot(a, glm::cross(b, c));
+    float den = la * lb * lc + glm::dot(a, b) * lc + glm::dot(b, c) * la + glm::dot(c, a) * lb;
+    return 2.0f * std::atan2(num, den);
+}
+
+MeshBVH::MeshBVH() {
+}
+
+MeshBVH::MeshBVH(const std::vector<Triangle>& _triangles) {
+    load(_triangles);
+}
+
+MeshBVH::MeshBVH(const Mesh& _mesh) {
+    load(_mesh.getTriangles());
+}
+
+void MeshBVH::clear() {
+    nodes.clear();
+    points.clear();
+    ids.clear();
+    min = glm::vec3(std::numeric_limits<float>::max());
+    max = glm::vec3(std::numeric_limits<float>::min());
+}
+
+void MeshBVH::load(const std::vector<Triangle>& _triangles) {
+    clear();
+    if (_triangles.size() == 0)
+        return;
+
+    size_t total = _triangles.size();
+    std::vector<glm::vec3> centroids(total);
+    ids.resize(total);
+    for (size_t i = 0; i < total; i++) {
+        ids[i] = i;
+        centroids[i] = _triangles[i].getCentroid();
+    }
+
+    // positions are read through ids while building, then stored in leaf order
+    points.resize(total * 3);
+    for (size_t i = 0; i < total; i++)
+        for (size_t v = 0; v < 3; v++)
+            points[i * 3 + v] = _triangles[i][v];
+
+    nodes.reserve(total * 2 / LEAF_SIZE + 1);
+    build(0, total, centroids);
+
+    std::vector<glm::vec3> sorted(total * 3);
+    for (size_t i = 0; i < total; i++)
+        for (size_t v = 0; v < 3; v++)
+            sorted[i * 3 + v] = points[ids[i] * 3 + v];
+    points.swap(sorted);
+
+    min = nodes[0].min;
+    max = nodes[0].max;
+}
+
+uint32_t MeshBVH::build(uint32_t _begin, uint32_t _end, std::vector<glm::vec3>& _centroids) {
+    uint32_t index = nodes.size();
+    nodes.push_back(Node());
+
+    Node node;
+    node.min = glm::vec3(FLT_MAX);
+    node.max = glm::vec3(-FLT_MAX);
+    node.center = glm::vec3(0.0f);
+    node.normal = glm::vec3(0.0f);
+    glm::vec3 cmin = glm::vec3(FLT_MAX);
+    glm::vec3 cmax = glm::vec3(-FLT_MAX);
+    float area = 0.0f;
+
+    for (uint32_t i = _begin; i < _end; i++) {
+        const glm::vec3* p = &points[ids[i] * 3];
+        for (size_t v = 0; v < 3; v++) {
+            node.min = glm::min(node.min, p[v]);
+            node.max = glm::max(node.max, p[v]);
+        }
+
+        glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]) * 0.5f;
+        float a = glm::length(n);
+        node.normal += n;
+        node.center += _centroids[ids[i]] * a;
+        area += a;
+
+        cmin = glm::min(cmin, _centroids[ids[i]]);
+        cmax = glm::max(cmax, _centroids[ids[i]]);
+    }
+
+    node.center = (area > 0.0f) ? node.center / area : (node.min + node.max) * 0.5f;
+    node.radius = 0.0f;
+    for (uint32_t i = _begin; i < _end; i++)
+        for (size_t v = 0; v < 3; v++)
+            node.radius = std::max(node.radius, glm::length(points[ids[i] * 3 + v] - node.center));
+
+    if (_end - _begin <= LEAF_SIZE) {
+        node.first = _begin;
+        node.count = _end - _begin;
+        nodes[index] = node;
+        return index;
+    }
+
+    // split on the median of the longest axis of the centroids
+    glm::vec3 extent = cmax - cmin;
+    int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+    uint32_t mid = (_begin + _end) / 2;
+    std::nth_element(ids.begin() + _begin, ids.begin() + mid, ids.begin() + _end,
+                    [&_centroids, axis](uint32_t a, uint32_t b) { return _centroids[a][axis] < _centroids[b][axis]; });
+
+    build(_begin, mid, _centroids);
+    node.first = build(mid, _end, _centroids);
+    node.count = 0;
+    nodes[index] = node;
+    return index;
+}
+
+bool MeshBVH::closest(const glm::vec3& _point, SurfacePoint& _closest, float _maxDistance, bool _signed) const {
+    if (nodes.size() == 0)
+        return false;
+
+    float best = (_maxDistance < FLT_MAX) ? _maxDistance * _maxDistance : FLT_MAX;
+    uint32_t found = 0xFFFFFFFF;
+
+    uint32_t stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[ stack[--top] ];
+        if (distance2ToBox(_point, node.min, node.max) > best)
+            continue;
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                const glm::vec3* p = &points[i * 3];
+                glm::vec3 b = closestOnTriangle(_point, p[0], p[1], p[2]);
+                glm::vec3 d = p[0] * b.x + p[1] * b.y + p[2] * b.z - _point;
+                float d2 = glm::dot(d, d);
+                if (d2 <= best) {
+                    best = d2;
+                    found = i;
+                    _closest.barycentric = b;
+                }
+            }
+            continue;
+        }
+
+        // push the furthest child first so the nearest one is visited (and tightens the bound) first
+        uint32_t left = &node - &nodes[0] + 1;
+        uint32_t right = node.first;
+        float dl = distance2ToBox(_point, nodes[left].min, nodes[left].max);
+        float dr = distance2ToBox(_point, nodes[right].min, nodes[right].max);
+        if (dl < dr) {
+            stack[top++] = right;
+            stack[top++] = left;
+        }
+        else {
+            stack[top++] = left;
+            stack[top++] = right;
+        }
+    }
+
+    if (found == 0xFFFFFFFF)
+        return false;
+
+    const glm::vec3* p = &points[found * 3];
+    const glm::vec3& b = _closest.barycentric;
+    _closest.position = p[0] * b.x + p[1] * b.y + p[2] * b.z;
+    _closest.triangle = ids[found];
+    _closest.distance = std::sqrt(best);
+
+    // inside when the surface wraps around the point
+    if (_signed && getWindingNumber(_point) > 0.5f)
+        _closest.distance = -_closest.distance;
+
+    return true;
+}
+
+bool MeshBVH::closest(const glm::vec3& _point, glm::vec3& _closest, size_t& _triangle, float _maxDistance) const {
+    SurfacePoint hit;
+    if (!closest(_point, hit, _maxDistance))
+        return false;
+
+    _closest = hit.position;
+    _triangle = hit.triangle;
+    return true;
+}
+
+std::vector<SurfacePoint> MeshBVH::closest(const std::vector<glm::vec3>& _points, float _maxDistance, bool _signed, size_t _threads) const {
+    std::vector<SurfacePoint> out(_points.size());
+
+    parallelFor(_points.size(), [&](size_t _i, size_t /*_thread*/) {
+        if (!closest(_points[_i], out[_i], _maxDistance, _signed))
+            out[_i].triangle = SurfacePoint::NONE;
+    }, _threads);
+
+    return out;
+}
+
+float MeshBVH::getWindingNumber(const glm::vec3& _point, float _accuracy) const {
+    if (nodes.size() == 0)
+        return 0.0f;
+
+    return getWindingNumber(0, _point, _accuracy) / FOUR_PI;
+}
+
+float MeshBVH::getWindingNumber(uint32_t _node, const glm::vec3& _point, float _accuracy) const {
+    const Node& node = nodes[_node];
+
+    if (node.count > 0) {
+        float angle = 0.0f;
+        for (uint32_t i = node.first; i < node.first + node.count; i++)
+            angle += solidAngle(_point, points[i * 3], points[i * 3 + 1], points[i * 3 + 2]);
+        return angle;
+    }
+
+    // far enough, the whole node looks like a single dipole
+    glm::vec3 d = node.center - _point;
+    float l = glm::length(d);
+    if (l > _accuracy * node.radius)
+        return glm::dot(d, node.normal) / (l * l * l);
+
+    return getWindingNumber(_node + 1, _point, _accuracy) + getWindingNumber(node.first, _point, _accuracy);
+}
+
+}
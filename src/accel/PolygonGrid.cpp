@@ -0,0 +1,271 @@
+#include "hilma/accel/PolygonGrid.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "hilma/parallel.h"
+
+#include "bins.h"
+
+namespace hilma {
+
+// Edges per band and per cell, on average
+const float EDGES_PER_BAND = 2.0f;
+const float EDGES_PER_CELL = 2.0f;
+
+static glm::vec2 closestOnSegment(const glm::vec2& _p, const glm::vec2& _a, const glm::vec2& _b) {
+    glm::vec2 ab = _b - _a;
+    float l2 = glm::dot(ab, ab);
+    if (l2 == 0.0f)
+        return _a;
+    float t = glm::clamp(glm::dot(_p - _a, ab) / l2, 0.0f, 1.0f);
+    return _a + ab * t;
+}
+
+PolygonGrid::PolygonGrid() {
+    clear();
+}
+
+PolygonGrid::PolygonGrid(const Polygon& _polygon) {
+    std::vector< std::vector<glm::vec2> > rings(_polygon.size());
+    for (size_t r = 0; r < _polygon.size(); r++)
+        for (size_t i = 0; i < _polygon[r].size(); i++)
+            rings[r].push_back( glm::vec2(_polygon[r][i]) );
+    load(rings);
+}
+
+PolygonGrid::PolygonGrid(const Polyline& _polyline) {
+    std::vector< std::vector<glm::vec2> > rings(1);
+    for (size_t i = 0; i < _polyline.size(); i++)
+        rings[0].push_back( glm::vec2(_polyline[i]) );
+    load(rings);
+}
+
+PolygonGrid::PolygonGrid(const std::vector<glm::vec2>& _ring) {
+    load( std::vector< std::vector<glm::vec2> >(1, _ring) );
+}
+
+PolygonGrid::PolygonGrid(const std::vector< std::vector<glm::vec2> >& _rings) {
+    load(_rings);
+}
+
+void PolygonGrid::clear() {
+    edges.clear();
+    bandsOffsets.assign(2, 0);
+    bands.clear();
+    bandsTotal = 1;
+    bandsScale = 0.0f;
+    cellsOffsets.assign(2, 0);
+    cells.clear();
+    cellsWidth = 1;
+    cellsHeight = 1;
+    cellsScale = glm::vec2(0.0f);
+    min = glm::vec3(std::numeric_limits<float>::max());
+    max = glm::vec3(std::numeric_limits<float>::min());
+}
+
+void PolygonGrid::load(const std::vector< std::vector<glm::vec2> >& _rings) {
+    clear();
+    min = glm::vec3(FLT_MAX);
+    max = glm::vec3(-FLT_MAX);
+
+    for (size_t r = 0; r < _rings.size(); r++) {
+        size_t n = _rings[r].size();
+        for (size_t i = 0; i < n; i++) {
+            Edge edge;
+            edge.a = _rings[r][i];
+            edge.b = _rings[r][(i + 1) % n];
+            edges.push_back(edge);
+            expand(edge.a.x, edge.a.y, 0.0f);
+        }
+    }
+
+    if (edges.size() == 0) {
+        clear();
+        return;
+    }
+
+    const size_t total = edges.size();
+    const float width = max.x - min.x;
+    const float height = max.y - min.y;
+    std::vector<uint32_t> lo(total);
+    std::vector<uint32_t> hi(total);
+
+    // horizontal bands
+    bandsTotal = (height > 0.0f) ? std::max(1, int(total / EDGES_PER_BAND)) : 1;
+    bandsScale = (height > 0.0f) ? bandsTotal / height : 0.0f;
+    for (size_t e = 0; e < total; e++) {
+        lo[e] = std::min(bandsTotal - 1, int((std::min(edges[e].a.y, edges[e].b.y) - min.y) * bandsScale));
+        hi[e] = std::min(bandsTotal - 1, int((std::max(edges[e].a.y, edges[e].b.y) - min.y) * bandsScale));
+    }
+    bin(lo, hi, bandsTotal, bandsOffsets, bands);
+
+    // right most first, so the ray test can stop at the first edge that is left of the point
+    for (int b = 0; b < bandsTotal; b++)
+        std::sort(bands.begin() + bandsOffsets[b], bands.begin() + bandsOffsets[b + 1], [this](uint32_t _a, uint32_t _b) {
+            return std::max(edges[_a].a.x, edges[_a].b.x) > std::max(edges[_b].a.x, edges[_b].b.x);
+        });
+
+    // uniform grid with roughly square cells
+    float cellSize = std::sqrt( std::max(width * height, 1e-12f) * EDGES_PER_CELL / total );
+    if (width == 0.0f || height == 0.0f)
+        cellSize = std::max(width, height) * EDGES_PER_CELL / total;
+    cellsWidth = (cellSize > 0.0f) ? std::max(1, std::min(4096, int(std::ceil(width / cellSize)))) : 1;
+    cellsHeight = (cellSize > 0.0f) ? std::max(1, std::min(4096, int(std::ceil(height / cellSize)))) : 1;
+    cellsScale = glm::vec2( (width > 0.0f) ? cellsWidth / width : 0.0f, (height > 0.0f) ? cellsHeight / height : 0.0f );
+
+    // edges are binned by their bounding box, so an edge is listed on every cell it touches
+    std::vector<uint32_t> cellsLo, cellsHi, list;
+    for (size_t e = 0; e < total; e++) {
+        glm::vec2 emin = glm::min(edges[e].a, edges[e].b);
+        glm::vec2 emax = glm::max(edges[e].a, edges[e].b);
+        int x0 = std::min(cellsWidth - 1, int((emin.x - min.x) * cellsScale.x));
+        int x1 = std::min(cellsWidth - 1, int((emax.x - min.x) * cellsScale.x));
+        int y0 = std::min(cellsHeight - 1, int((emin.y - min.y) * cellsScale.y));
+        int y1 = std::min(cellsHeight - 1, int((emax.y - min.y) * cellsScale.y));
+        for (int y = y0; y <= y1; y++) {
+            cellsLo.push_back(y * cellsWidth + x0);
+            cellsHi.push_back(y * cellsWidth + x1);
+            list.push_back(e);
+        }
+    }
+    std::vector<uint32_t> spans;
+    bin(cellsLo, cellsHi, size_t(cellsWidth) * cellsHeight, cellsOffsets, spans);
+    cells.resize(spans.size());
+    for (size_t i = 0; i < spans.size(); i++)
+        cells[i] = list[spans[i]];
+}
+
+bool PolygonGrid::inside(const glm::vec2& _point) const {
+    if (edges.size() == 0 || _point.y < min.y || _point.y > max.y || _point.x > max.x)
+        return false;
+
+    int band = std::min(bandsTotal - 1, int((_point.y - min.y) * bandsScale));
+
+    // same ray crossing test (and ties) as inside(const std::vector<glm::vec2>&, const glm::vec2&)
+    int counter = 0;
+    for (uint32_t i = bandsOffsets[band]; i < bandsOffsets[band + 1]; i++) {
+        const glm::vec2& p1 = edges[bands[i]].a;
+        const glm::vec2& p2 = edges[bands[i]].b;
+        if (_point.x > std::max(p1.x, p2.x))
+            break;
+
+        if (_point.y > std::min(p1.y, p2.y) && _point.y <= std::max(p1.y, p2.y) && p1.y != p2.y) {
+            double xinters = (_point.y - p1.y) * (p2.x - p1.x) / (p2.y - p1.y) + p1.x;
+            if (p1.x == p2.x || _point.x <= xinters)
+                counter++;
+        }
+    }
+
+    return counter % 2 == 1;
+}
+
+float PolygonGrid::closest(const glm::vec2& _point, glm::vec2& _closest, size_t& _edge) const {
+    float best = FLT_MAX;
+    _closest = _point;
+    _edge = 0;
+    if (edges.size() == 0)
+        return best;
+
+    const glm::vec2 origin = glm::vec2(min.x, min.y);
+    const glm::vec2 size = glm::vec2( (cellsScale.x > 0.0f) ? 1.0f / cellsScale.x : 0.0f,
+                                      (cellsScale.y > 0.0f) ? 1.0f / cellsScale.y : 0.0f );
+    int cx = glm::clamp(int(std::floor((_point.x - min.x) * cellsScale.x)), 0, cellsWidth - 1);
+    int cy = glm::clamp(int(std::floor((_point.y - min.y) * cellsScale.y)), 0, cellsHeight - 1);
+
+    auto visit = [&](int _x, int _y) {
+        if (_x < 0 || _y < 0 || _x >= cellsWidth || _y >= cellsHeight)
+            return;
+
+        glm::vec2 cmin = origin + glm::vec2(_x, _y) * size;
+        glm::vec2 d = glm::max(glm::max(cmin - _point, _point - (cmin + size)), glm::vec2(0.0f));
+        if (glm::dot(d, d) > best)
+            return;
+
+        size_t c = size_t(_y) * cellsWidth + _x;
+        for (uint32_t i = cellsOffsets[c]; i < cellsOffsets[c + 1]; i++) {
+            glm::vec2 p = closestOnSegment(_point, edges[cells[i]].a, edges[cells[i]].b);
+            glm::vec2 dp = p - _point;
+            float d2 = glm::dot(dp, dp);
+            if (d2 < best || (d2 == best && cells[i] < _edge)) {
+                best = d2;
+                _closest = p;
+                _edge = cells[i];
+            }
+        }
+    };
+
+    // rings of cells around the one of the point, until nothing unvisited can be closer
+    for (int r = 0; ; r++) {
+        int x0 = cx - r, x1 = cx + r;
+        int y0 = cy - r, y1 = cy + r;
+        if (r == 0)
+            visit(cx, cy);
+        else {
+            for (int x = x0; x <= x1; x++) {
+                visit(x, y0);
+                visit(x, y1);
+            }
+            for (int y = y0 + 1; y < y1; y++) {
+                visit(x0, y);
+                visit(x1, y);
+            }
+        }
+
+        // the unvisited cells are beyond the sides of the visited block that are not on the border
+        float bound = FLT_MAX;
+        if (x0 > 0)                 bound = std::min(bound, std::max(0.0f, _point.x - (origin.x + x0 * size.x)));
+        if (x1 < cellsWidth - 1)    bound = std::min(bound, std::max(0.0f, (origin.x + (x1 + 1) * size.x) - _point.x));
+        if (y0 > 0)                 bound = std::min(bound, std::max(0.0f, _point.y - (origin.y + y0 * size.y)));
+        if (y1 < cellsHeight - 1)   bound = std::min(bound, std::max(0.0f, (origin.y + (y1 + 1) * size.y) - _point.y));
+
+        if (bound == FLT_MAX || bound * bound >= best)
+            break;
+    }
+
+    return std::sqrt(best);
+}
+
+glm::vec2 PolygonGrid::getClosestPoint(const glm::vec2& _point, size_t* _edge) const {
+    glm::vec2 p;
+    size_t edge;
+    closest(_point, p, edge);
+    if (_edge != nullptr)
+        *_edge = edge;
+    return p;
+}
+
+float PolygonGrid::getDistance(const glm::vec2& _point, bool _signed) const {
+    glm::vec2 p;
+    size_t edge;
+    float d = closest(_point, p, edge);
+    if (_signed && inside(_point))
+        d = -d;
+    return d;
+}
+
+std::vector<uint8_t> PolygonGrid::inside(const std::vector<glm::vec2>& _points, size_t _threads) const {
+    std::vector<uint8_t> out(_points.size());
+    parallelFor(_points.size(), [&](size_t _i, size_t /*_thread*/) {
+        out[_i] = inside(_points[_i]) ? 1 : 0;
+    }, _threads);
+    return out;
+}
+
+std::vector<glm::vec2> PolygonGrid::getClosestPoints(const std::vector<glm::vec2>& _points, size_t _threads) const {
+    std::vector<glm::vec2> out(_points.size());
+    parallelFor(_points.size(), [&](size_t _i, size_t /*_thread*/) {
+        out[_i] = getClosestPoint(_points[_i]);
+    }, _threads);
+    return out;
+}
+
+std::vector<float> PolygonGrid::getDistances(const std::vector<glm::vec2>& _points, bool _signed, size_t _threads) const {
+    std::vector<float> out(_points.size());
+    parallelFor(_points.size(), [&](size_t _i, size_t /*_thread*/) {
+        out[_i] = getDistance(_points[_i], _signed);
+    }, _threads);
+    return out;
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace hilma {
+
+// Counting sort of elements into bins: element e goes on every bin from _lo[e] to _hi[e]
+// (inclusive). _offsets gets where each bin starts on _list, _list gets the element indices,
+// or their _ids when given.
+inline void bin(const std::vector<uint32_t>& _lo, const std::vector<uint32_t>& _hi, size_t _total,
+                std::vector<uint32_t>& _offsets, std::vector<uint32_t>& _list, const std::vector<uint32_t>* _ids = nullptr) {
+    _offsets.assign(_total + 1, 0);
+    for (size_t e = 0; e < _lo.size(); e++)
+        for (uint32_t i = _lo[e]; i <= _hi[e]; i++)
+            _offsets[i + 1]++;
+
+    for (size_t i = 0; i < _total; i++)
+        _offsets[i + 1] += _offsets[i];
+
+    std::vector<uint32_t> next(_offsets.begin(), _offsets.end() - 1);
+    _list.resize(_offsets[_total]);
+    for (size_t e = 0; e < _lo.size(); e++)
+        for (uint32_t i = _lo[e]; i <= _hi[e]; i++)
+            _list[ next[i]++ ] = _ids ? (*_ids)[e] : uint32_t(e);
+}
+
+}
@@ -113,31 +113,49 @@ private:
             reset(blockSize_);
         }
         ~ObjectPool() {
-            clear();
+            release();
         }
         template <typename... Args>
         T* construct(Args&&... args) {
             if (currentIndex >= blockSize) {
-                currentBlock = alloc_traits::allocate(alloc, blockSize);
-                allocations.emplace_back(currentBlock);
+                // reuse the blocks kept from earlier polygons before allocating new ones
+                if (currentBlockIndex < allocations.size()) {
+                    currentBlock = allocations[currentBlockIndex];
+                } else {
+                    currentBlock = alloc_traits::allocate(alloc, blockSize);
+                    allocations.emplace_back(currentBlock);
+                }
+                currentBlockIndex++;
                 currentIndex = 0;
             }
             T* object = &currentBlock[currentIndex++];
             alloc_traits::construct(alloc, object, std::forward<Args>(args)...);
             return object;
         }
+        // keeps the blocks for the next polygon, unless it asks for bigger ones
         void reset(std::size_t newBlockSize) {
+            newBlockSize = std::max<std::size_t>(1, newBlockSize);
+            if (newBlockSize > blockSize) {
+                release();
+                blockSize = newBlockSize;
+            }
+            currentBlock = nullptr;
+            currentBlockIndex = 0;
+            currentIndex = blockSize;
+        }
+        void clear() { reset(blockSize); }
+        void release() {
             for (auto allocation : allocations) {
                 alloc_traits::deallocate(alloc, allocation, blockSize);
             }
             allocations.clear();
-            blockSize = std::max<std::size_t>(1, newBlockSize);
             currentBlock = nullptr;
+            currentBlockIndex = 0;
             currentIndex = blockSize;
         }
-        void clear() { reset(blockSize); }
     private:
         T* currentBlock = nullptr;
+        std::size_t currentBlockIndex = 0;
         std::size_t currentIndex = 1;
         std::size_t blockSize = 1;
         std::vector<T*> allocations;
@@ -145,6 +163,7 @@ private:
         typedef typename std::allocator_traits<Alloc> alloc_traits;
     };
     ObjectPool<Node> nodes;
+    std::vector<Node*> queue;   // holes, kept between calls
 };
 
 template <typename N> template <typename Polygon>
@@ -441,7 +460,7 @@ typename Earcut<N>::Node*
 Earcut<N>::eliminateHoles(const Polygon& points, Node* outerNode) {
     const size_t len = points.size();
 
-    std::vector<Node*> queue;
+    queue.clear();
     for (size_t i = 1; i < len; i++) {
         Node* list = linkedList(points[i], false);
         if (list) {
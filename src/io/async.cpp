@@ -0,0 +1,139 @@
+#include "hilma/io/async.h"
+
+#include "hilma/io/auto.h"
+#include "hilma/io/png.h"
+#include "hilma/io/jpg.h"
+#include "hilma/io/hdr.h"
+#include "hilma/ops/convert_image.h"
+#include "hilma/parallel.h"
+#include "hilma/fs.h"
+
+#include <memory>
+
+namespace hilma {
+
+ImageIO::ImageIO(size_t _threads, size_t _queueSize): running(0), stopping(false) {
+    if (_threads == 0)
+        _threads = hilma::getThreadsTotal();
+    queueSize = (_queueSize == 0)? _threads * 2 : _queueSize;
+
+    staging.resize(_threads);
+    for (size_t t = 0; t < _threads; t++)
+        workers.push_back( std::thread( [this, t]() {
+            while (true) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    haveJobs.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                    if (jobs.empty())
+                        return;
+
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                    running++;
+                }
+                haveRoom.notify_one();
+
+                job(t);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    running--;
+                }
+                idle.notify_all();
+            }
+        }) );
+}
+
+ImageIO::~ImageIO() {
+    // whatever is queued still gets done
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    haveJobs.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ImageIO::submit(Job _job) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        haveRoom.wait(lock, [this]() { return jobs.size() < queueSize; });
+        jobs.push_back( std::move(_job) );
+    }
+    haveJobs.notify_one();
+}
+
+void ImageIO::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return jobs.empty() && running == 0; });
+}
+
+size_t ImageIO::getPendingTotal() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size() + running;
+}
+
+std::future<Image> ImageIO::load(const std::string& _filename, int _channels) {
+    // std::function needs copyable jobs, so the promise goes on a shared_ptr
+    std::shared_ptr< std::promise<Image> > promise = std::make_shared< std::promise<Image> >();
+    submit( [promise, _filename, _channels](size_t /*_thread*/) {
+        Image image;
+        hilma::load(_filename, image, _channels);
+        promise->set_value( std::move(image) );
+    } );
+    return promise->get_future();
+}
+
+void ImageIO::load(const std::string& _filename, std::function<void(Image&, bool)> _done, int _channels) {
+    submit( [_done, _filename, _channels](size_t /*_thread*/) {
+        Image image;
+        bool loaded = hilma::load(_filename, image, _channels);
+        _done(image, loaded);
+    } );
+}
+
+std::future<bool> ImageIO::save(const std::string& _filename, Image _image) {
+    std::shared_ptr< std::promise<bool> > promise = std::make_shared< std::promise<bool> >();
+    std::shared_ptr<Image> image = std::make_shared<Image>( std::move(_image) );
+    submit( [this, promise, image, _filename](size_t _thread) {
+        promise->set_value( encode(_filename, *image, _thread) );
+    } );
+    return promise->get_future();
+}
+
+void ImageIO::save(const std::string& _filename, Image _image, std::function<void(bool)> _done) {
+    std::shared_ptr<Image> image = std::make_shared<Image>( std::move(_image) );
+    submit( [this, _done, image, _filename](size_t _thread) {
+        _done( encode(_filename, *image, _thread) );
+    } );
+}
+
+bool ImageIO::encode(const std::string& _filename, const Image& _image, size_t _thread) {
+    std::string ext = getExt(_filename);
+    bool png = ext == "png" || ext == "PNG";
+    bool jpg = ext == "jpg" || ext == "JPG" || ext == "jpeg" || ext == "JPEG";
+
+    if (!png && !jpg)
+        return hilma::save(_filename, _image);
+
+    // 8-bit images don't need staging
+    if (_image.getType() == IMAGE_UINT8 && _image.getLayout() == LAYOUT_LINEAR) {
+        if (png)
+            return savePng(_filename, _image);
+        return saveJpg(_filename, _image);
+    }
+
+    // the staging buffer only grows, after a few images there are no more allocations
+    std::vector<unsigned char>& pixels = staging[_thread];
+    pixels.resize( size_t(_image.getWidth()) * _image.getHeight() * _image.getChannels() );
+    to8bit(_image, pixels.data());
+
+    if (png)
+        return savePng(_filename, pixels.data(), _image.getWidth(), _image.getHeight(), _image.getChannels());
+    return saveJpg(_filename, pixels.data(), _image.getWidth(), _image.getHeight(), _image.getChannels());
+}
+
+}
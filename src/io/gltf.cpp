@@ -11,7 +11,11 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <sstream>
 #include <map>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -31,6 +35,7 @@
 
 #include "hilma/fs.h"
 #include "hilma/text.h"
+#include "hilma/parallel.h"
 #include "hilma/ops/convert_image.h"
 #include "hilma/ops/compute.h"
 
@@ -43,35 +48,46 @@ bool load(const std::string& _filename, Image& _image, int _channels) {
     int width, height, channels;
     std::string ext = getExt(_filename);
 
+    // stb reports the channels on the file, the pixels come with the ones requested
     if (ext == "hdr" || ext == "HDR") {
         float *pixels = stbi_loadf(_filename.c_str(), &width, &height, &channels, _channels);
 
         if (!pixels)
             return false;
 
-        _image.allocate(width, height, channels);
-        int total = width * height * channels;
-        if (total != _image.data.size())
-            _image.data.resize(total);
-        std::memcpy(&_image.data[0], pixels, total * sizeof(float));
-        _image.name = getFilename( _filename );
+        if (_channels > 0)
+            channels = _channels;
 
-        return true;
+        _image.allocate(width, height, channels);
+        std::memcpy(&_image.data[0], pixels, size_t(width) * height * channels * sizeof(float));
+        stbi_image_free(pixels);
     }
-    else {
+    else if (stbi_is_16_bit(_filename.c_str())) {
         uint16_t* pixels = stbi_load_16(_filename.c_str(), &width, &height, &channels, _channels);
         
         if (!pixels)
             return false;
 
-        _image.allocate(width, height, channels);
-        int total = width * height * channels;
-        const float m = 1.f / 65535.f;
-        for (int i = 0; i < total; i++)
-            _image.setValue(i, float(pixels[i]) * m);
+        if (_channels > 0)
+            channels = _channels;
 
-        delete pixels;
+        // keep the precision of the file, values convert on access
+        _image.allocate(width, height, channels, IMAGE_UINT16, LAYOUT_LINEAR);
+        std::memcpy(&_image.bytes[0], pixels, size_t(width) * height * channels * sizeof(uint16_t));
+        stbi_image_free(pixels);
+    }
+    else {
+        unsigned char* pixels = stbi_load(_filename.c_str(), &width, &height, &channels, _channels);
 
+        if (!pixels)
+            return false;
+
+        if (_channels > 0)
+            channels = _channels;
+
+        _image.allocate(width, height, channels, IMAGE_UINT8, LAYOUT_LINEAR);
+        std::memcpy(&_image.bytes[0], pixels, size_t(width) * height * channels);
+        stbi_image_free(pixels);
     }
 
     _image.name = getFilename( _filename );
@@ -96,6 +112,12 @@ bool saveHdr(const std::string& _filename, const float* _pixels, int _width, int
 }
 
 bool saveHdr(const std::string& _filename, const Image& _image) {
+    if (_image.getType() != IMAGE_FLOAT32 || _image.getLayout() != LAYOUT_LINEAR) {
+        Image linear = _image;
+        linear.convert(IMAGE_FLOAT32, LAYOUT_LINEAR);
+        return saveHdr(_filename, linear);
+    }
+
     return stbi_write_hdr(_filename.c_str(), _image.getWidth(), _image.getHeight(), _image.getChannels(), &_image[0]);
 }
 
@@ -103,7 +125,16 @@ bool savePng(const std::string& _filename, const unsigned char* _pixels, int _wi
     return stbi_write_png(_filename.c_str(), _width, _height, _channels, _pixels, 0);
 }
 
+void setPngCompression(int _level, int _filter) {
+    stbi_write_png_compression_level = _level;
+    stbi_write_force_png_filter = _filter;
+}
+
 bool savePng(const std::string& _filename, const Image& _image) {
+    // 8-bit pixels go straight to the encoder
+    if (_image.getType() == IMAGE_UINT8 && _image.getLayout() == LAYOUT_LINEAR)
+        return savePng(_filename, _image.getRawBytes(), _image.getWidth(), _image.getHeight(), _image.getChannels());
+
     unsigned char* pixels = to8bit(_image);
     savePng(_filename, pixels, _image.getWidth(), _image.getHeight(), _image.getChannels());
     delete [] pixels;
@@ -116,6 +147,9 @@ bool saveJpg(const std::string& _filename, const unsigned char* _pixels, int _wi
 }
 
 bool saveJpg(const std::string& _filename, const Image& _image) {
+    if (_image.getType() == IMAGE_UINT8 && _image.getLayout() == LAYOUT_LINEAR)
+        return saveJpg(_filename, _image.getRawBytes(), _image.getWidth(), _image.getHeight(), _image.getChannels());
+
     unsigned char* pixels = to8bit(_image);
     saveJpg(_filename, pixels, _image.getWidth(), _image.getHeight(), _image.getChannels());
     delete [] pixels;
@@ -223,12 +257,67 @@ bool save(const std::string& _filename, const Image& _image) {
 
 // GLTF LOAD 
 //
-bool loadModel(tinygltf::Model& _model, const std::string& _filename) {
+
+// Images are not decoded while parsing, their encoded bytes are kept here
+// (or read back from their bufferView) and decoded afterwards on all threads
+typedef std::map<int, std::vector<unsigned char> > EncodedImages;
+
+bool deferImageData(tinygltf::Image* _image, const int _imageIndex, std::string*, std::string*, 
+                    int, int, const unsigned char* _bytes, int _size, void* _userData) {
+    if (_image->bufferView == -1) {
+        EncodedImages* encoded = reinterpret_cast<EncodedImages*>(_userData);
+        (*encoded)[_imageIndex] = std::vector<unsigned char>(_bytes, _bytes + _size);
+    }
+    return true;
+}
+
+void decodeImages(tinygltf::Model& _model, const EncodedImages& _encoded, size_t _threads) {
+    parallelFor(_model.images.size(), [&](size_t i, size_t /*_thread*/) {
+        tinygltf::Image& image = _model.images[i];
+
+        const unsigned char* bytes = nullptr;
+        int size = 0;
+
+        EncodedImages::const_iterator it = _encoded.find(int(i));
+        if (it != _encoded.end() && it->second.size() > 0) {
+            bytes = &it->second[0];
+            size = int(it->second.size());
+        }
+        else if (image.bufferView >= 0) {
+            const tinygltf::BufferView& view = _model.bufferViews[image.bufferView];
+            bytes = &_model.buffers[view.buffer].data[view.byteOffset];
+            size = int(view.byteLength);
+        }
+
+        if (bytes == nullptr)
+            return;
+
+        int width, height, channels;
+        unsigned char* pixels = stbi_load_from_memory(bytes, size, &width, &height, &channels, 4);
+        if (!pixels) {
+            std::cout << "Failed to decode image " << image.name << " " << image.uri << std::endl;
+            return;
+        }
+
+        image.width = width;
+        image.height = height;
+        image.component = 4;
+        image.bits = 8;
+        image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+        image.image.assign(pixels, pixels + width * height * 4);
+        stbi_image_free(pixels);
+    }, _threads);
+}
+
+bool loadModel(tinygltf::Model& _model, const std::string& _filename, size_t _threads) {
     tinygltf::TinyGLTF loader;
     std::string err;
     std::string warn;
     std::string ext = getExt(_filename);
 
+    EncodedImages encoded;
+    loader.SetImageLoader(deferImageData, &encoded);
+
     bool res = false;
 
     // assume binary glTF.
@@ -245,6 +334,9 @@ bool loadModel(tinygltf::Model& _model, const std::string& _filename) {
     if (!err.empty())
         std::cout << "ERR: " << err.c_str() << std::endl;
 
+    if (res)
+        decodeImages(_model, encoded, _threads);
+
     return res;
 }
 
@@ -284,52 +376,87 @@ void extractFaceIndices(const tinygltf::Model& _model, const tinygltf::Accessor&
     const tinygltf::Buffer &buffer = _model.buffers[buffer_view.buffer];
     const uint8_t* base = &buffer.data.at(buffer_view.byteOffset + _indexAccessor.byteOffset);
 
+    std::vector<INDEX_TYPE> indices(_indexAccessor.count);
     switch (_indexAccessor.componentType) {
         case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
             const uint32_t *p = (uint32_t*) base;
-            for (size_t i = 0; i < _indexAccessor.count; ++i)
-                _mesh.addFaceIndex( p[i] );
+            std::copy(p, p + _indexAccessor.count, indices.begin());
         }; break;
         case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
             const uint16_t *p = (uint16_t*) base;
-            for (size_t i = 0; i < _indexAccessor.count; ++i)
-                _mesh.addFaceIndex( p[i] );
+            std::copy(p, p + _indexAccessor.count, indices.begin());
         }; break;
         case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
             const uint8_t *p = (uint8_t*) base;
-            for (size_t i = 0; i < _indexAccessor.count; ++i)
-                _mesh.addFaceIndex( p[i] );
+            std::copy(p, p + _indexAccessor.count, indices.begin());
         }; break;
     }
+
+    if (indices.size() > 0)
+        _mesh.addFaceIndices(&indices[0], indices.size());
 }
 
-void extractVertexData(uint32_t v_pos, const uint8_t *base, int accesor_componentType, int accesor_type, bool accesor_normalized, uint32_t byteStride, float *output, uint8_t max_num_comp) {
-    float v[4] = {0.0f, 0.0f, 0.0f, 0.0f};
-    uint32_t ncomp = 1;
-    switch (accesor_type) {
-        case TINYGLTF_TYPE_SCALAR: ncomp = 1; break;
-        case TINYGLTF_TYPE_VEC2:   ncomp = 2; break;
-        case TINYGLTF_TYPE_VEC3:   ncomp = 3; break;
-        case TINYGLTF_TYPE_VEC4:   ncomp = 4; break;
-        default:
-            assert(!"invalid type");
+// Converts _count elements of _ncomp components into packed floats, _outComp per element.
+// Components missing from the source keep the values already in _out.
+template<typename T>
+void readComponents(const uint8_t* _base, size_t _byteStride, size_t _count, size_t _ncomp, 
+                    float _scale, float _min, float* _out, size_t _outComp) {
+    size_t ncomp = std::min(_ncomp, _outComp);
+    for (size_t v = 0; v < _count; v++) {
+        const T* src = reinterpret_cast<const T*>(_base + v * _byteStride);
+        float* dst = _out + v * _outComp;
+        for (size_t c = 0; c < ncomp; c++)
+            dst[c] = std::max(float(src[c]) * _scale, _min);
     }
-    switch (accesor_componentType) {
-        case TINYGLTF_COMPONENT_TYPE_FLOAT: {
-            const float *data = (float*)(base+byteStride*v_pos);
-            for (uint32_t i = 0; (i < ncomp); ++i)
-                v[i] = data[i];
-        }
-        // TODO SUPPORT OTHER FORMATS
-        break;
-        default:
-            assert(!"Conversion Type from float to -> ??? not implemented yet");
+}
+
+// Decodes a whole accessor at once (strided, normalized or not) into _out
+bool readAccessor(const tinygltf::Model& _model, const tinygltf::Accessor& _accessor, float* _out, size_t _outComp) {
+    if (_accessor.bufferView < 0 || _accessor.count == 0)
+        return false;
+
+    const tinygltf::BufferView &bufferView = _model.bufferViews[_accessor.bufferView];
+    const tinygltf::Buffer &buffer = _model.buffers[bufferView.buffer];
+    const uint8_t* base = &buffer.data.at(bufferView.byteOffset + _accessor.byteOffset);
+    size_t ncomp = tinygltf::GetNumComponentsInType(_accessor.type);
+    size_t byteStride = _accessor.ByteStride(bufferView);
+    bool normalized = _accessor.normalized;
+
+    switch (_accessor.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+            if (ncomp == _outComp && byteStride == ncomp * sizeof(float))
+                std::memcpy(_out, base, _accessor.count * ncomp * sizeof(float));
+            else
+                readComponents<float>(base, byteStride, _accessor.count, ncomp, 1.0f, -FLT_MAX, _out, _outComp);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+            readComponents<int8_t>(base, byteStride, _accessor.count, ncomp, normalized ? 1.0f/127.0f : 1.0f, normalized ? -1.0f : -FLT_MAX, _out, _outComp);
             break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            readComponents<uint8_t>(base, byteStride, _accessor.count, ncomp, normalized ? 1.0f/255.0f : 1.0f, -FLT_MAX, _out, _outComp);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+            readComponents<int16_t>(base, byteStride, _accessor.count, ncomp, normalized ? 1.0f/32767.0f : 1.0f, normalized ? -1.0f : -FLT_MAX, _out, _outComp);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            readComponents<uint16_t>(base, byteStride, _accessor.count, ncomp, normalized ? 1.0f/65535.0f : 1.0f, -FLT_MAX, _out, _outComp);
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+            readComponents<uint32_t>(base, byteStride, _accessor.count, ncomp, 1.0f, -FLT_MAX, _out, _outComp);
+            break;
+        default:
+            std::cout << "Accessor component type " << _accessor.componentType << " not supported" << std::endl;
+            return false;
     }
-    for (uint32_t i = 0; i < max_num_comp; ++i)
-        output[i] = v[i];
+
+    return true;
 }
 
+Image toImage(const tinygltf::Image& _image) {
+    if (_image.image.size() == 0)
+        return Image();
+    return Image(&_image.image[0], _image.height, _image.width, _image.component);
+}
 
 Material extractMaterial(const tinygltf::Model& _model, const tinygltf::Material& _material, bool _verbose) {
     Material mat = Material( toLower( toUnderscore( purifyString( _material.name ) ) ) );
@@ -345,7 +472,7 @@ Material extractMaterial(const tinygltf::Model& _model, const tinygltf::Material
         // Todo:
         //      - image.bits
         //
-        Image img = Image(&image.image[0], image.width, image.height, image.component);
+        Image img = toImage(image);
         img.name = name;
         
         mat.set("diffuse", img);
@@ -365,7 +492,7 @@ Material extractMaterial(const tinygltf::Model& _model, const tinygltf::Material
             name = _material.name;
         name += "_emissive";
 
-        Image img = Image(&image.image[0], image.width, image.height, image.component);
+        Image img = toImage(image);
         img.name = name;
 
         mat.set("emissive", img);
@@ -383,7 +510,7 @@ Material extractMaterial(const tinygltf::Model& _model, const tinygltf::Material
         tinygltf::Texture tex = _model.textures[_material.pbrMetallicRoughness.metallicRoughnessTexture.index];
         const tinygltf::Image &image = _model.images[tex.source];
 
-        Image img = Image(&image.image[0], image.width, image.height, image.component);
+        Image img = toImage(image);
         std::string name = image.name + "_" + image.uri;
         if (name == "_")
             name = _material.name;
@@ -426,7 +553,7 @@ Material extractMaterial(const tinygltf::Model& _model, const tinygltf::Material
             name = _material.name;
         name += "_occlusion";
         
-        Image img = Image(&image.image[0], image.width, image.height, image.component);
+        Image img = toImage(image);
         img.name = name;
         
         mat.set("occlusion", img);
@@ -442,7 +569,7 @@ Material extractMaterial(const tinygltf::Model& _model, const tinygltf::Material
             name = _material.name;
         name += "_normalmap";
 
-        Image img = Image(&image.image[0], image.width, image.height, image.component);
+        Image img = toImage(image);
         img.name = name;
         
         mat.set("normalmap", img);
@@ -455,108 +582,91 @@ Material extractMaterial(const tinygltf::Model& _model, const tinygltf::Material
 }
 
 
-void extractMesh(const tinygltf::Model& _model, const tinygltf::Mesh& _mesh, glm::mat4 _matrix, Mesh& _out_mesh, bool _verbose) {
+void extractPrimitive(const tinygltf::Model& _model, const tinygltf::Primitive& _primitive, const glm::mat4& _matrix, Mesh& _mesh, bool _verbose) {
     glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(_matrix)));
 
-    for (size_t i = 0; i < _mesh.primitives.size(); ++i) {
-        if (_verbose)
-            std::cout << "   primitive " << i + 1 << "/" << _mesh.primitives.size() << std::endl;
-
-        const tinygltf::Primitive &primitive = _mesh.primitives[i];
-
-        Mesh mesh;
-        if (primitive.indices >= 0)
-            extractFaceIndices(_model, _model.accessors[primitive.indices], mesh);
-        mesh.setFaceType( toFaceType(primitive) );
-
-        // Extract Vertex Data
-        for (auto &attrib : primitive.attributes) {
-            const tinygltf::Accessor &accessor = _model.accessors[attrib.second];
-            const tinygltf::BufferView &bufferView = _model.bufferViews[accessor.bufferView];
-            const tinygltf::Buffer &buffer = _model.buffers[bufferView.buffer];
-            int byteStride = accessor.ByteStride(bufferView);
-
-            if (attrib.first.compare("POSITION") == 0)  {
-                for (size_t v = 0; v < accessor.count; v++) {
-                    glm::vec4 pos = glm::vec4(1.0);
-                    extractVertexData(v, &buffer.data.at(bufferView.byteOffset + accessor.byteOffset), accessor.componentType, accessor.type, accessor.normalized, byteStride, &pos[0], 3);
-                    mesh.addVertex( glm::vec3(_matrix * pos) );
-                }
-            }
-
-            else if (attrib.first.compare("COLOR_0") == 0)  {
-                for (size_t v = 0; v < accessor.count; v++) {
-                    glm::vec4 col = glm::vec4(1.0f);
-                    extractVertexData(v, &buffer.data.at(bufferView.byteOffset + accessor.byteOffset), accessor.componentType, accessor.type, accessor.normalized, byteStride, &col[0], 4);
-                    mesh.addColor(col);
-                }
-            }
-
-            else if (attrib.first.compare("NORMAL") == 0)  {
-                for (size_t v = 0; v < accessor.count; v++) {
-                    glm::vec3 nor;
-                    extractVertexData(v, &buffer.data.at(bufferView.byteOffset + accessor.byteOffset), accessor.componentType, accessor.type, accessor.normalized, byteStride, &nor[0], 3);
-                    mesh.addNormal( normalize(normalMatrix * nor) );
-                }
-            }
+    if (_primitive.indices >= 0)
+        extractFaceIndices(_model, _model.accessors[_primitive.indices], _mesh);
+    _mesh.setFaceType( toFaceType(_primitive) );
+
+    // Extract Vertex Data
+    std::vector<float> data;
+    for (auto &attrib : _primitive.attributes) {
+        const tinygltf::Accessor &accessor = _model.accessors[attrib.second];
+        size_t count = accessor.count;
+
+        if (attrib.first.compare("POSITION") == 0)  {
+            data.assign(count * 3, 0.0f);
+            if (!readAccessor(_model, accessor, &data[0], 3))
+                continue;
+
+            glm::vec3* pos = reinterpret_cast<glm::vec3*>(&data[0]);
+            for (size_t v = 0; v < count; v++)
+                pos[v] = glm::vec3(_matrix * glm::vec4(pos[v], 1.0f));
+            _mesh.addVertices(&data[0], count, 3);
+        }
 
-            else if (attrib.first.compare("TEXCOORD_0") == 0)  {
-                for (size_t v = 0; v < accessor.count; v++) {
-                    glm::vec2 uv;
-                    extractVertexData(v, &buffer.data.at(bufferView.byteOffset + accessor.byteOffset), accessor.componentType, accessor.type, accessor.normalized, byteStride, &uv[0], 2);
-                    mesh.addTexCoord(uv);
-                }
-            }
+        else if (attrib.first.compare("COLOR_0") == 0)  {
+            data.assign(count * 4, 1.0f);
+            if (readAccessor(_model, accessor, &data[0], 4))
+                _mesh.addColors(&data[0], count, 4);
+        }
 
-            else if (attrib.first.compare("TANGENT") == 0)  {
-                for (size_t v = 0; v < accessor.count; v++) {
-                    glm::vec4 tan;
-                    extractVertexData(v, &buffer.data.at(bufferView.byteOffset + accessor.byteOffset), accessor.componentType, accessor.type, accessor.normalized, byteStride, &tan[0], 4);
-                    mesh.addTangent(tan);
-                }
-            }
+        else if (attrib.first.compare("NORMAL") == 0)  {
+            data.assign(count * 3, 0.0f);
+            if (!readAccessor(_model, accessor, &data[0], 3))
+                continue;
 
-            else {
-                std::cout << " " << std::endl;
-                std::cout << "Attribute: " << attrib.first << std::endl;
-                std::cout << "  type        :" << accessor.type << std::endl;
-                std::cout << "  component   :" << accessor.componentType << std::endl;
-                std::cout << "  normalize   :" << accessor.normalized << std::endl;
-                std::cout << "  bufferView  :" << accessor.bufferView << std::endl;
-                std::cout << "  byteOffset  :" << accessor.byteOffset << std::endl;
-                std::cout << "  count       :" << accessor.count << std::endl;
-                std::cout << "  byteStride  :" << byteStride << std::endl;
-                std::cout << " "<< std::endl;
-            }
+            glm::vec3* nor = reinterpret_cast<glm::vec3*>(&data[0]);
+            for (size_t v = 0; v < count; v++)
+                nor[v] = glm::normalize(normalMatrix * nor[v]);
+            _mesh.addNormals(&data[0], count, 3);
         }
 
-        if (_verbose) {
-            std::cout << "    vertices = " << mesh.getVertices().size() << std::endl;
-            std::cout << "    colors   = " << mesh.getColors().size() << std::endl;
-            std::cout << "    normals  = " << mesh.getNormals().size() << std::endl;
-            std::cout << "    uvs      = " << mesh.getTexCoords().size() << std::endl;
-            std::cout << "  f indices  = " << mesh.getFaceIndicesTotal() << std::endl;
-            if (mesh.getFaceType() == TRIANGLES)
-                std::cout << "    triang.  = " << mesh.getFaceIndicesTotal()/3 << std::endl;
-            std::cout << "  e indices  = " << mesh.getEdgeIndicesTotal() << std::endl;
-            if (mesh.getEdgeType() == LINES )
-                std::cout << "    lines    = " << mesh.getEdgeIndicesTotal()/2 << std::endl;
+        else if (attrib.first.compare("TEXCOORD_0") == 0)  {
+            data.assign(count * 2, 0.0f);
+            if (readAccessor(_model, accessor, &data[0], 2))
+                _mesh.addTexCoords(&data[0], count, 2);
         }
 
-        if ( !mesh.haveNormals() )
-            mesh.computeNormals();
+        else if (attrib.first.compare("TANGENT") == 0)  {
+            data.assign(count * 4, 0.0f);
+            if (!readAccessor(_model, accessor, &data[0], 4))
+                continue;
 
-        if ( !mesh.haveTangents() )
-            mesh.computeTangents();
+            const glm::vec4* tan = reinterpret_cast<const glm::vec4*>(&data[0]);
+            for (size_t v = 0; v < count; v++)
+                _mesh.addTangent(tan[v]);
+        }
 
-        Material mat = extractMaterial( _model, _model.materials[primitive.material], _verbose );
-        _out_mesh.addMaterial(mat);
-        _out_mesh.append(mesh);
+        else if (_verbose) {
+            std::cout << " " << std::endl;
+            std::cout << "Attribute: " << attrib.first << std::endl;
+            std::cout << "  type        :" << accessor.type << std::endl;
+            std::cout << "  component   :" << accessor.componentType << std::endl;
+            std::cout << "  normalize   :" << accessor.normalized << std::endl;
+            std::cout << "  bufferView  :" << accessor.bufferView << std::endl;
+            std::cout << "  byteOffset  :" << accessor.byteOffset << std::endl;
+            std::cout << "  count       :" << accessor.count << std::endl;
+            std::cout << " "<< std::endl;
+        }
     }
+
+    if ( !_mesh.haveNormals() )
+        _mesh.computeNormals();
+
+    if ( !_mesh.haveTangents() )
+        _mesh.computeTangents();
 }
 
-// bind models
-void extractNodes(const tinygltf::Model& _model, const tinygltf::Node& _node, glm::mat4 _matrix, Mesh& _mesh, bool _verbose) {
+// Mesh placed on the scene by a node, with its accumulated transformation
+struct GltfInstance {
+    int         mesh;
+    glm::mat4   matrix;
+};
+
+// walk the hierarchy collecting mesh instances
+void extractNodes(const tinygltf::Model& _model, const tinygltf::Node& _node, glm::mat4 _matrix, std::vector<GltfInstance>& _instances, bool _verbose) {
     if (_verbose)
         std::cout << "Entering node " << _node.name << std::endl;
 
@@ -586,8 +696,12 @@ void extractNodes(const tinygltf::Model& _model, const tinygltf::Node& _node, gl
 
     _matrix = _matrix * localMatrix;
 
-    if (_node.mesh >= 0)
-        extractMesh(_model, _model.meshes[ _node.mesh ], _matrix, _mesh, _verbose);
+    if (_node.mesh >= 0) {
+        GltfInstance instance;
+        instance.mesh = _node.mesh;
+        instance.matrix = _matrix;
+        _instances.push_back(instance);
+    }
 
     if (_node.camera >= 0)
         if (_verbose)
@@ -595,21 +709,48 @@ void extractNodes(const tinygltf::Model& _model, const tinygltf::Node& _node, gl
         // TODO extract camera
     
     for (size_t i = 0; i < _node.children.size(); i++) {
-        extractNodes(_model, _model.nodes[ _node.children[i] ], _matrix, _mesh, _verbose);
+        extractNodes(_model, _model.nodes[ _node.children[i] ], _matrix, _instances, _verbose);
     }
 };
 
-bool    loadGltf( const std::string& _filename, Mesh& _mesh ) {
+bool    loadGltf( const std::string& _filename, Mesh& _mesh, size_t _threads ) {
     tinygltf::Model model;
 
-    if (! loadModel(model, _filename)) {
+    if (! loadModel(model, _filename, _threads)) {
         std::cout << "Failed to load .glTF : " << _filename << std::endl;
         return false;
     }
 
+    std::vector<GltfInstance> instances;
     const tinygltf::Scene &scene = model.scenes[model.defaultScene];
     for (size_t i = 0; i < scene.nodes.size(); ++i)
-        extractNodes(model, model.nodes[scene.nodes[i]], glm::mat4(1.0), _mesh, false);
+        extractNodes(model, model.nodes[scene.nodes[i]], glm::mat4(1.0), instances, false);
+
+    // every primitive of every instance is an independent job
+    std::vector< std::pair<size_t, size_t> > jobs;
+    for (size_t i = 0; i < instances.size(); i++)
+        for (size_t j = 0; j < model.meshes[ instances[i].mesh ].primitives.size(); j++)
+            jobs.push_back( std::make_pair(i, j) );
+
+    std::vector<MaterialPtr> materials(model.materials.size());
+    parallelFor(materials.size(), [&](size_t i, size_t /*_thread*/) {
+        materials[i] = std::make_shared<Material>( extractMaterial(model, model.materials[i], false) );
+    }, _threads);
+
+    std::vector<Mesh> meshes(jobs.size());
+    parallelFor(jobs.size(), [&](size_t i, size_t /*_thread*/) {
+        const GltfInstance& instance = instances[ jobs[i].first ];
+        const tinygltf::Primitive& primitive = model.meshes[ instance.mesh ].primitives[ jobs[i].second ];
+        extractPrimitive(model, primitive, instance.matrix, meshes[i], false);
+    }, _threads);
+
+    // merge in scene order
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const tinygltf::Primitive& primitive = model.meshes[ instances[ jobs[i].first ].mesh ].primitives[ jobs[i].second ];
+        if (primitive.material >= 0 && size_t(primitive.material) < materials.size())
+            _mesh.addMaterial( *materials[primitive.material] );
+        _mesh.append( meshes[i] );
+    }
 
     return true;
 }
@@ -747,9 +888,7 @@ int convertTexture(const std::string _filename, const Image& _image, tinygltf::M
     img.width = _image.getWidth();
     img.height = _image.getHeight();
     img.component = _image.getChannels();
-    img.image = toBytes(&_image[0], img.width * img.width * img.component);
     img.bits = 8;
-    img.pixel_type = TINYGLTF_COMPONENT_TYPE_FLOAT;
     img.as_is = false;
 
     if (!_embebedFiles) {
@@ -770,10 +909,27 @@ int convertTexture(const std::string _filename, const Image& _image, tinygltf::M
             view.name = _filename;
         }
 
-        int len;
-        unsigned char* data = to8bit(_image);
-        unsigned char *png = stbi_write_png_to_mem(data, 0,_image.getWidth(), _image.getHeight(), _image.getChannels(), &len);
-        buf.data = std::vector<unsigned char>(png, png + len);
+        // Embed the original file when it is already in a format glTF understands
+        std::string ext = getExt(_filename);
+        bool isPng = (ext == "png" || ext == "PNG");
+        bool isJpg = (ext == "jpg" || ext == "JPG" || ext == "jpeg" || ext == "JPEG");
+        std::ifstream file;
+        if ((isPng || isJpg) && urlExists(_filename))
+            file.open(_filename.c_str(), std::ios::binary);
+
+        if (file.is_open()) {
+            buf.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            img.mimeType = isPng ? "image/png" : "image/jpeg";
+        }
+        else {
+            int len;
+            unsigned char* data = to8bit(_image);
+            unsigned char *png = stbi_write_png_to_mem(data, 0,_image.getWidth(), _image.getHeight(), _image.getChannels(), &len);
+            buf.data = std::vector<unsigned char>(png, png + len);
+            STBIW_FREE(png);
+            delete [] data;
+            img.mimeType = "image/png";
+        }
         
         view.buffer = _outModel.buffers.size();
         _outModel.buffers.push_back(buf);
@@ -786,8 +942,6 @@ int convertTexture(const std::string _filename, const Image& _image, tinygltf::M
 
         img.bufferView = _outModel.bufferViews.size();
         _outModel.bufferViews.push_back(view);
-
-        img.mimeType = "image/png";
     }
 
     tex.sampler = 0; // default
@@ -800,6 +954,12 @@ int convertTexture(const std::string _filename, const Image& _image, tinygltf::M
     return index;
 }
 
+int convertTexture(const std::string _filename, const ImagePtr& _image, tinygltf::Model& _outModel, bool _embebedFiles) {
+    if (!_image)
+        return -1;
+    return convertTexture(_filename, *_image, _outModel, _embebedFiles);
+}
+
 int convertMaterial(MaterialPtr _material, tinygltf::Model& _outModel, bool _embebedFiles) {
 
     // Don't create a material if already exist
@@ -825,7 +985,7 @@ int convertMaterial(MaterialPtr _material, tinygltf::Model& _outModel, bool _emb
         else if (type == TEXTURE) {
             mat.emissiveTexture = tinygltf::TextureInfo();
             mat.emissiveTexture.index = convertTexture( _material->getImagePath("emissive"), 
-                                                        _material->getImage("emissive"),
+                                                        _material->getImagePtr("emissive"),
                                                         _outModel, _embebedFiles);
             mat.emissiveTexture.texCoord = 0;
         }
@@ -840,7 +1000,7 @@ int convertMaterial(MaterialPtr _material, tinygltf::Model& _outModel, bool _emb
         else if (type == TEXTURE) {
             mat.pbrMetallicRoughness.baseColorTexture = tinygltf::TextureInfo();
             mat.pbrMetallicRoughness.baseColorTexture.index = convertTexture(   _material->getImagePath("diffuse"), 
-                                                                                _material->getImage("diffuse"),
+                                                                                _material->getImagePtr("diffuse"),
                                                                                 _outModel, _embebedFiles);
             mat.pbrMetallicRoughness.baseColorTexture.texCoord = 0;
         }
@@ -920,7 +1080,7 @@ int convertMaterial(MaterialPtr _material, tinygltf::Model& _outModel, bool _emb
         mat.normalTexture = tinygltf::NormalTextureInfo();
         mat.normalTexture.texCoord = 0;
         mat.normalTexture.index = convertTexture(   _material->getImagePath("normalmap"), 
-                                                    _material->getImage("normalmap"),
+                                                    _material->getImagePtr("normalmap"),
                                                     _outModel, _embebedFiles);
         mat.normalTexture.scale = 1.0;
         if (_material->haveProperty("normalmap_scale"))
@@ -1056,20 +1216,26 @@ bool convertMesh( const Mesh& _inMesh, tinygltf::Model& _outModel, bool _embebed
     return true;
 }
 
-bool saveGltf( const std::string& _filename, const Mesh& _mesh ) {
-    tinygltf::Model model = tinygltf::Model();
-    model.asset = tinygltf::Asset();
-    model.asset.version = "2.0";
-    model.asset.generator = "Genereted using Hilma C++/Python Library";
-    model.asset.copyright = "2020 (c) Patricio Gonzalez Vivo";
+void initModel( tinygltf::Model& _model ) {
+    _model.asset = tinygltf::Asset();
+    _model.asset.version = "2.0";
+    _model.asset.generator = "Genereted using Hilma C++/Python Library";
+    _model.asset.copyright = "2020 (c) Patricio Gonzalez Vivo";
 
     tinygltf::Sampler sampler = tinygltf::Sampler();
     sampler.minFilter = TINYGLTF_TEXTURE_FILTER_LINEAR;
     sampler.magFilter = TINYGLTF_TEXTURE_FILTER_LINEAR;
-    model.samplers.push_back(sampler);
+    _model.samplers.push_back(sampler);
+}
 
+bool saveGltf( const std::string& _filename, const Mesh& _mesh ) {
     std::string ext = getExt(_filename);
     bool bin = (ext == "glb" || ext == "GLB");
+    if (bin)
+        return saveGlb(_filename, _mesh);
+
+    tinygltf::Model model = tinygltf::Model();
+    initModel(model);
 
     convertMesh(_mesh, model, bin);
 
@@ -1082,4 +1248,553 @@ bool saveGltf( const std::string& _filename, const Mesh& _mesh ) {
                                         bin );    // writeBinary
 }
 
-}
\ No newline at end of file
+// GLB SAVE
+//
+
+// Piece of the BIN chunk. Data that can be written as it is points straight to
+// the mesh storage, anything quantized, encoded or compressed is owned.
+struct GlbChunk {
+    const unsigned char*        data;
+    size_t                      size;
+    size_t                      offset;
+    std::vector<unsigned char>  owned;
+};
+
+// bufferView compressed with EXT_meshopt_compression
+struct GlbMeshopt {
+    int         view;
+    size_t      byteOffset;
+    size_t      byteLength;
+    size_t      byteStride;
+    size_t      count;
+    std::string mode;
+};
+
+struct GlbWriter {
+    tinygltf::Model         model;
+    std::vector<GlbChunk>   chunks;
+    std::vector<GlbMeshopt> meshopt;
+    size_t                  binLength = 0;
+    size_t                  fallbackLength = 0;
+    bool                    compress = false;
+};
+
+size_t align4(size_t _n) { return (_n + 3) & ~size_t(3); }
+
+size_t addChunk(GlbWriter& _glb, const unsigned char* _data, size_t _size) {
+    GlbChunk chunk;
+    chunk.data = _data;
+    chunk.size = _size;
+    chunk.offset = align4(_glb.binLength);
+    _glb.binLength = chunk.offset + _size;
+    _glb.chunks.push_back(std::move(chunk));
+    return _glb.chunks.back().offset;
+}
+
+size_t addChunk(GlbWriter& _glb, std::vector<unsigned char>&& _bytes) {
+    size_t offset = addChunk(_glb, nullptr, _bytes.size());
+    _glb.chunks.back().owned = std::move(_bytes);
+    return offset;
+}
+
+// EXT_meshopt_compression bitstreams: vertex codec (v0) and index sequence codec (v1)
+//
+const size_t kByteGroupSize = 16;
+
+void encodeVByte(std::vector<unsigned char>& _out, uint32_t _v) {
+    do {
+        _out.push_back( (_v & 127) | (_v > 127 ? 128 : 0) );
+        _v >>= 7;
+    } while (_v);
+}
+
+template<typename T>
+std::vector<unsigned char> encodeIndexSequence(const T* _indices, size_t _count) {
+    std::vector<unsigned char> out;
+    out.reserve(1 + _count * 2 + 4);
+    out.push_back(0xd1);
+
+    // each index is a zigzag delta against one of two baselines
+    uint32_t last[2] = {0, 0};
+    uint32_t current = 0;
+    for (size_t i = 0; i < _count; i++) {
+        uint32_t index = _indices[i];
+        int32_t cd = int32_t(index - last[current]);
+        current ^= ((cd < 0 ? -cd : cd) >= 30);
+
+        uint32_t d = index - last[current];
+        uint32_t v = (d << 1) ^ uint32_t(int32_t(d) >> 31);
+        encodeVByte(out, (v << 1) | current);
+        last[current] = index;
+    }
+
+    // decoder tail
+    out.insert(out.end(), 4, 0);
+    return out;
+}
+
+size_t measureBytesGroup(const unsigned char* _buffer, int _bits) {
+    if (_bits == 0) {
+        for (size_t i = 0; i < kByteGroupSize; i++)
+            if (_buffer[i] != 0)
+                return SIZE_MAX;
+        return 0;
+    }
+
+    if (_bits == 8)
+        return kByteGroupSize;
+
+    size_t size = kByteGroupSize * _bits / 8;
+    unsigned char sentinel = (1 << _bits) - 1;
+    for (size_t i = 0; i < kByteGroupSize; i++)
+        size += (_buffer[i] >= sentinel);
+    return size;
+}
+
+void encodeBytesGroup(std::vector<unsigned char>& _out, const unsigned char* _buffer, int _bits) {
+    if (_bits == 0)
+        return;
+
+    if (_bits == 8) {
+        _out.insert(_out.end(), _buffer, _buffer + kByteGroupSize);
+        return;
+    }
+
+    // packed values first, then a full byte for every value that hit the sentinel
+    size_t perByte = 8 / _bits;
+    unsigned char sentinel = (1 << _bits) - 1;
+    for (size_t i = 0; i < kByteGroupSize; i += perByte) {
+        unsigned char byte = 0;
+        for (size_t k = 0; k < perByte; k++) {
+            unsigned char enc = (_buffer[i + k] >= sentinel) ? sentinel : _buffer[i + k];
+            byte = (byte << _bits) | enc;
+        }
+        _out.push_back(byte);
+    }
+
+    for (size_t i = 0; i < kByteGroupSize; i++)
+        if (_buffer[i] >= sentinel)
+            _out.push_back(_buffer[i]);
+}
+
+void encodeBytes(std::vector<unsigned char>& _out, const unsigned char* _buffer, size_t _size) {
+    static const int bitsTable[4] = { 0, 2, 4, 8 };
+
+    // 2 bits of header per group of 16 bytes
+    size_t header = _out.size();
+    _out.resize(header + (_size / kByteGroupSize + 3) / 4, 0);
+
+    for (size_t i = 0; i < _size; i += kByteGroupSize) {
+        int best = 3;
+        size_t bestSize = kByteGroupSize;
+        for (int b = 0; b < 3; b++) {
+            size_t size = measureBytesGroup(_buffer + i, bitsTable[b]);
+            if (size < bestSize) {
+                best = b;
+                bestSize = size;
+            }
+        }
+
+        size_t group = i / kByteGroupSize;
+        _out[header + group / 4] |= best << ((group % 4) * 2);
+        encodeBytesGroup(_out, _buffer + i, bitsTable[best]);
+    }
+}
+
+std::vector<unsigned char> encodeVertexBuffer(const unsigned char* _data, size_t _count, size_t _stride) {
+    std::vector<unsigned char> out;
+    out.reserve(_count * _stride / 2);
+    out.push_back(0xa0);
+
+    size_t blockSize = std::min<size_t>((8192 / _stride) & ~(kByteGroupSize - 1), 256);
+    std::vector<unsigned char> last(_data, _data + _stride);
+    unsigned char buffer[256];
+
+    for (size_t offset = 0; offset < _count; offset += blockSize) {
+        size_t n = std::min(blockSize, _count - offset);
+        size_t aligned = (n + kByteGroupSize - 1) & ~(kByteGroupSize - 1);
+        const unsigned char* block = _data + offset * _stride;
+
+        // encode byte k of every vertex in the block as zigzag deltas
+        for (size_t k = 0; k < _stride; k++) {
+            std::memset(buffer, 0, aligned);
+            unsigned char p = last[k];
+            for (size_t i = 0; i < n; i++) {
+                unsigned char v = block[i * _stride + k];
+                unsigned char d = v - p;
+                buffer[i] = (d << 1) ^ (unsigned char)((signed char)d >> 7);
+                p = v;
+            }
+            encodeBytes(out, buffer, aligned);
+        }
+
+        std::memcpy(&last[0], block + (n - 1) * _stride, _stride);
+    }
+
+    // the tail holds the first vertex, padded to 32 bytes
+    if (_stride < 32)
+        out.insert(out.end(), 32 - _stride, 0);
+    out.insert(out.end(), _data, _data + _stride);
+
+    return out;
+}
+
+int addView(GlbWriter& _glb, const std::string& _name, 
+            const unsigned char* _data, size_t _count, size_t _elementSize, int _target,
+            std::vector<unsigned char>* _owned = nullptr) {
+
+    tinygltf::BufferView view = tinygltf::BufferView();
+    view.name = _name;
+    view.buffer = 0;
+    view.target = _target;
+    view.byteLength = _count * _elementSize;
+    view.byteStride = (_target == TINYGLTF_TARGET_ARRAY_BUFFER)? _elementSize : 0;
+
+    if (_glb.compress) {
+        GlbMeshopt ext;
+        ext.view = _glb.model.bufferViews.size();
+        ext.byteStride = _elementSize;
+        ext.count = _count;
+
+        std::vector<unsigned char> encoded;
+        if (_target == TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER) {
+            ext.mode = "INDICES";
+            if (_elementSize == 2)
+                encoded = encodeIndexSequence(reinterpret_cast<const uint16_t*>(_data), _count);
+            else
+                encoded = encodeIndexSequence(reinterpret_cast<const uint32_t*>(_data), _count);
+        }
+        else {
+            ext.mode = "ATTRIBUTES";
+            encoded = encodeVertexBuffer(_data, _count, _elementSize);
+        }
+
+        ext.byteLength = encoded.size();
+        ext.byteOffset = addChunk(_glb, std::move(encoded));
+        _glb.meshopt.push_back(ext);
+
+        // the view itself points to the fallback buffer, which only declares the decoded size
+        view.buffer = -1;
+        view.byteOffset = _glb.fallbackLength;
+        _glb.fallbackLength = align4(_glb.fallbackLength + view.byteLength);
+    }
+    else if (_owned)
+        view.byteOffset = addChunk(_glb, std::move(*_owned));
+    else
+        view.byteOffset = addChunk(_glb, _data, view.byteLength);
+
+    int index = _glb.model.bufferViews.size();
+    _glb.model.bufferViews.push_back(view);
+    return index;
+}
+
+int addAccessor(tinygltf::Model& _model, int _view, int _componentType, int _type, size_t _count, bool _normalized,
+                const std::vector<double>& _min = std::vector<double>(), const std::vector<double>& _max = std::vector<double>()) {
+    tinygltf::Accessor accessor = tinygltf::Accessor();
+    accessor.bufferView = _view;
+    accessor.byteOffset = 0;
+    accessor.componentType = _componentType;
+    accessor.type = _type;
+    accessor.count = _count;
+    accessor.normalized = _normalized;
+    accessor.minValues = _min;
+    accessor.maxValues = _max;
+
+    int index = _model.accessors.size();
+    _model.accessors.push_back(accessor);
+    return index;
+}
+
+bool skipImageData(const std::string*, const std::string*, tinygltf::Image*, bool, void*) {
+    return true;
+}
+
+bool saveGlb( const std::string& _filename, const Mesh& _mesh, bool _quantize, bool _compress ) {
+    GlbWriter glb;
+    glb.compress = _compress;
+    initModel(glb.model);
+
+    // placeholder for the BIN chunk, textures get embedded on the next ones
+    glb.model.buffers.push_back(tinygltf::Buffer());
+
+    tinygltf::Mesh mesh = tinygltf::Mesh();
+    mesh.name = _mesh.getName();
+
+    tinygltf::Node node = tinygltf::Node();
+    node.name = "meshNode";
+
+    std::map<std::string, int> attributes;
+    size_t total = _mesh.vertices.size();
+
+    // Positions
+    if (total > 0) {
+        glm::vec3 min = _mesh.vertices[0];
+        glm::vec3 max = _mesh.vertices[0];
+        for (size_t i = 1; i < total; i++) {
+            min = glm::min(min, _mesh.vertices[i]);
+            max = glm::max(max, _mesh.vertices[i]);
+        }
+
+        if (_quantize) {
+            // int16 relative to the center of the bounding box, the node transform scales them back
+            glm::vec3 center = (min + max) * 0.5f;
+            glm::vec3 size = max - min;
+            float extent = std::max(size.x, std::max(size.y, size.z)) * 0.5f;
+            float scale = (extent > 0.0f)? extent / 32767.0f : 1.0f;
+
+            std::vector<unsigned char> bytes(total * 4 * sizeof(int16_t), 0);
+            int16_t* q = reinterpret_cast<int16_t*>(&bytes[0]);
+            for (size_t i = 0; i < total; i++) {
+                glm::vec3 p = glm::round((_mesh.vertices[i] - center) / scale);
+                for (int j = 0; j < 3; j++)
+                    q[i * 4 + j] = int16_t(clamp(p[j], -32767.0f, 32767.0f));
+            }
+
+            glm::vec3 qmin = glm::round((min - center) / scale);
+            glm::vec3 qmax = glm::round((max - center) / scale);
+            node.translation = { center.x, center.y, center.z };
+            node.scale = { scale, scale, scale };
+
+            int view = addView(glb, mesh.name + "_vertices", &bytes[0], total, 4 * sizeof(int16_t), TINYGLTF_TARGET_ARRAY_BUFFER, &bytes);
+            attributes["POSITION"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_SHORT, TINYGLTF_TYPE_VEC3, total, false,
+                                                { qmin.x, qmin.y, qmin.z }, { qmax.x, qmax.y, qmax.z });
+
+            glb.model.extensionsUsed.push_back("KHR_mesh_quantization");
+            glb.model.extensionsRequired.push_back("KHR_mesh_quantization");
+        }
+        else {
+            int view = addView(glb, mesh.name + "_vertices", reinterpret_cast<const unsigned char*>(&_mesh.vertices[0].x), total, sizeof(glm::vec3), TINYGLTF_TARGET_ARRAY_BUFFER);
+            attributes["POSITION"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, total, false,
+                                                { min.x, min.y, min.z }, { max.x, max.y, max.z });
+        }
+    }
+
+    // Normals
+    if (total > 0 && _mesh.normals.size() == total) {
+        if (_quantize) {
+            std::vector<unsigned char> bytes(total * 4, 0);
+            int8_t* q = reinterpret_cast<int8_t*>(&bytes[0]);
+            for (size_t i = 0; i < total; i++)
+                for (int j = 0; j < 3; j++)
+                    q[i * 4 + j] = int8_t( std::round( clamp(_mesh.normals[i][j], -1.0f, 1.0f) * 127.0f) );
+
+            int view = addView(glb, mesh.name + "_normals", &bytes[0], total, 4, TINYGLTF_TARGET_ARRAY_BUFFER, &bytes);
+            attributes["NORMAL"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_BYTE, TINYGLTF_TYPE_VEC3, total, true);
+        }
+        else {
+            int view = addView(glb, mesh.name + "_normals", reinterpret_cast<const unsigned char*>(&_mesh.normals[0].x), total, sizeof(glm::vec3), TINYGLTF_TARGET_ARRAY_BUFFER);
+            attributes["NORMAL"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, total, false);
+        }
+    }
+
+    // Tangents
+    if (total > 0 && _mesh.tangents.size() == total) {
+        if (_quantize) {
+            std::vector<unsigned char> bytes(total * 4, 0);
+            int8_t* q = reinterpret_cast<int8_t*>(&bytes[0]);
+            for (size_t i = 0; i < total; i++)
+                for (int j = 0; j < 4; j++)
+                    q[i * 4 + j] = int8_t( std::round( clamp(_mesh.tangents[i][j], -1.0f, 1.0f) * 127.0f) );
+
+            int view = addView(glb, mesh.name + "_tangents", &bytes[0], total, 4, TINYGLTF_TARGET_ARRAY_BUFFER, &bytes);
+            attributes["TANGENT"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_BYTE, TINYGLTF_TYPE_VEC4, total, true);
+        }
+        else {
+            int view = addView(glb, mesh.name + "_tangents", reinterpret_cast<const unsigned char*>(&_mesh.tangents[0].x), total, sizeof(glm::vec4), TINYGLTF_TARGET_ARRAY_BUFFER);
+            attributes["TANGENT"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, total, false);
+        }
+    }
+
+    // TexCoords, normalized uint16 only when they stay inside the [0,1] range
+    if (total > 0 && _mesh.texcoords.size() == total) {
+        bool normalized = _quantize;
+        for (size_t i = 0; i < total && normalized; i++)
+            normalized = _mesh.texcoords[i].x >= 0.0f && _mesh.texcoords[i].x <= 1.0f &&
+                         _mesh.texcoords[i].y >= 0.0f && _mesh.texcoords[i].y <= 1.0f;
+
+        if (normalized) {
+            std::vector<unsigned char> bytes(total * 2 * sizeof(uint16_t), 0);
+            uint16_t* q = reinterpret_cast<uint16_t*>(&bytes[0]);
+            for (size_t i = 0; i < total; i++)
+                for (int j = 0; j < 2; j++)
+                    q[i * 2 + j] = uint16_t( std::round( _mesh.texcoords[i][j] * 65535.0f) );
+
+            int view = addView(glb, mesh.name + "_texcoords", &bytes[0], total, 2 * sizeof(uint16_t), TINYGLTF_TARGET_ARRAY_BUFFER, &bytes);
+            attributes["TEXCOORD_0"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_VEC2, total, true);
+        }
+        else {
+            int view = addView(glb, mesh.name + "_texcoords", reinterpret_cast<const unsigned char*>(&_mesh.texcoords[0].x), total, sizeof(glm::vec2), TINYGLTF_TARGET_ARRAY_BUFFER);
+            attributes["TEXCOORD_0"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, total, false);
+        }
+    }
+
+    // Colors, normalized uint8 only when they stay inside the [0,1] range
+    if (total > 0 && _mesh.colors.size() == total) {
+        bool normalized = _quantize;
+        for (size_t i = 0; i < total && normalized; i++)
+            for (int j = 0; j < 4; j++)
+                normalized = normalized && _mesh.colors[i][j] >= 0.0f && _mesh.colors[i][j] <= 1.0f;
+
+        if (normalized) {
+            std::vector<unsigned char> bytes(total * 4, 0);
+            for (size_t i = 0; i < total; i++)
+                for (int j = 0; j < 4; j++)
+                    bytes[i * 4 + j] = (unsigned char)( std::round( _mesh.colors[i][j] * 255.0f) );
+
+            int view = addView(glb, mesh.name + "_colors", &bytes[0], total, 4, TINYGLTF_TARGET_ARRAY_BUFFER, &bytes);
+            attributes["COLOR_0"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_VEC4, total, true);
+        }
+        else {
+            int view = addView(glb, mesh.name + "_colors", reinterpret_cast<const unsigned char*>(&_mesh.colors[0].x), total, sizeof(glm::vec4), TINYGLTF_TARGET_ARRAY_BUFFER);
+            attributes["COLOR_0"] = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, total, false);
+        }
+    }
+
+    // One primitive per material range, pointing straight into the face indices
+    int mode = toPrimitiveMode( _mesh.getFaceType() );
+    if (_mesh.faceIndices.size() == 0) {
+        tinygltf::Primitive primitive = tinygltf::Primitive();
+        primitive.mode = mode;
+        primitive.attributes = attributes;
+        mesh.primitives.push_back(primitive);
+    }
+    else {
+        MaterialsByIndices ranges = _mesh.materialsByIndices;
+        if (ranges.size() == 0 || ranges[0].first > 0)
+            ranges.insert(ranges.begin(), IndexMaterial(0, nullptr));
+
+        // 65535 is the primitive restart value, glTF doesn't allow it as an unsigned short index
+        bool narrow = _quantize && sizeof(INDEX_TYPE) > sizeof(uint16_t) && total < 65536;
+        for (size_t i = 0; i < ranges.size(); i++) {
+            size_t first = ranges[i].first;
+            size_t last = (i + 1 < ranges.size())? ranges[i+1].first : _mesh.faceIndices.size();
+            if (last <= first)
+                continue;
+
+            size_t count = last - first;
+            const INDEX_TYPE* indices = &_mesh.faceIndices[first];
+            std::string name = mesh.name + "_" + toString(i) + "_indices";
+
+            tinygltf::Primitive primitive = tinygltf::Primitive();
+            primitive.mode = mode;
+            primitive.attributes = attributes;
+
+            if (narrow) {
+                std::vector<unsigned char> bytes(count * sizeof(uint16_t));
+                uint16_t* q = reinterpret_cast<uint16_t*>(&bytes[0]);
+                for (size_t j = 0; j < count; j++)
+                    q[j] = uint16_t(indices[j]);
+
+                int view = addView(glb, name, &bytes[0], count, sizeof(uint16_t), TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER, &bytes);
+                primitive.indices = addAccessor(glb.model, view, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR, count, false);
+            }
+            else {
+                int view = addView(glb, name, reinterpret_cast<const unsigned char*>(indices), count, sizeof(INDEX_TYPE), TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+                primitive.indices = addAccessor(glb.model, view, 
+                                                (sizeof(INDEX_TYPE) == sizeof(uint16_t))? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT : TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, 
+                                                TINYGLTF_TYPE_SCALAR, count, false);
+            }
+
+            if (ranges[i].second != nullptr)
+                primitive.material = convertMaterial(ranges[i].second, glb.model, true);
+
+            mesh.primitives.push_back(primitive);
+        }
+    }
+
+    // textures were embedded on their own buffers, move them into the BIN chunk
+    for (size_t i = 1; i < glb.model.buffers.size(); i++) {
+        size_t offset = addChunk(glb, std::move(glb.model.buffers[i].data));
+        for (size_t j = 0; j < glb.model.bufferViews.size(); j++)
+            if (glb.model.bufferViews[j].buffer == int(i)) {
+                glb.model.bufferViews[j].buffer = 0;
+                glb.model.bufferViews[j].byteOffset += offset;
+            }
+    }
+    // buffers are written by hand below
+    glb.model.buffers.clear();
+
+    if (_compress) {
+        for (size_t i = 0; i < glb.model.bufferViews.size(); i++)
+            if (glb.model.bufferViews[i].buffer == -1)
+                glb.model.bufferViews[i].buffer = 1;
+
+        glb.model.extensionsUsed.push_back("EXT_meshopt_compression");
+        glb.model.extensionsRequired.push_back("EXT_meshopt_compression");
+    }
+
+    node.mesh = glb.model.meshes.size();
+    glb.model.meshes.push_back(mesh);
+
+    int aNode = glb.model.nodes.size();
+    glb.model.nodes.push_back(node);
+
+    tinygltf::Scene scene = tinygltf::Scene();
+    scene.name = "root";
+    scene.nodes.push_back(aNode);
+    glb.model.defaultScene = glb.model.scenes.size();
+    glb.model.scenes.push_back(scene);
+
+    // JSON chunk
+    tinygltf::TinyGLTF gltf = tinygltf::TinyGLTF();
+    gltf.SetImageWriter(skipImageData, nullptr);
+    std::stringstream stream;
+    gltf.WriteGltfSceneToStream(&glb.model, stream, false, false);
+
+    nlohmann::json json = nlohmann::json::parse(stream.str());
+
+    nlohmann::json buffers = nlohmann::json::array();
+    buffers.push_back( { {"byteLength", glb.binLength} } );
+    if (_compress) {
+        buffers.push_back( { {"byteLength", glb.fallbackLength} } );
+        buffers[1]["extensions"]["EXT_meshopt_compression"]["fallback"] = true;
+
+        for (size_t i = 0; i < glb.meshopt.size(); i++) {
+            nlohmann::json& ext = json["bufferViews"][glb.meshopt[i].view]["extensions"]["EXT_meshopt_compression"];
+            ext["buffer"] = 0;
+            ext["byteOffset"] = glb.meshopt[i].byteOffset;
+            ext["byteLength"] = glb.meshopt[i].byteLength;
+            ext["byteStride"] = glb.meshopt[i].byteStride;
+            ext["count"] = glb.meshopt[i].count;
+            ext["mode"] = glb.meshopt[i].mode;
+        }
+    }
+    json["buffers"] = buffers;
+
+    std::string content = json.dump();
+    content.append(align4(content.size()) - content.size(), ' ');
+    size_t binLength = align4(glb.binLength);
+
+    std::ofstream file(_filename.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "Failed to write .glb : " << _filename << std::endl;
+        return false;
+    }
+
+    uint32_t header[3] = { 0x46546C67, 2, uint32_t(12 + 8 + content.size() + 8 + binLength) };
+    uint32_t jsonChunk[2] = { uint32_t(content.size()), 0x4E4F534A };
+    uint32_t binChunk[2] = { uint32_t(binLength), 0x004E4942 };
+    const char zeros[4] = { 0, 0, 0, 0 };
+
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(jsonChunk), sizeof(jsonChunk));
+    file.write(content.c_str(), content.size());
+    file.write(reinterpret_cast<const char*>(binChunk), sizeof(binChunk));
+
+    // BIN chunk
+    size_t written = 0;
+    for (size_t i = 0; i < glb.chunks.size(); i++) {
+        const GlbChunk& chunk = glb.chunks[i];
+        file.write(zeros, chunk.offset - written);
+
+        const unsigned char* data = chunk.owned.size() > 0 ? &chunk.owned[0] : chunk.data;
+        if (chunk.size > 0)
+            file.write(reinterpret_cast<const char*>(data), chunk.size);
+        written = chunk.offset + chunk.size;
+    }
+    file.write(zeros, binLength - written);
+
+    return file.good();
+}
+
+}
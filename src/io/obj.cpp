@@ -86,8 +86,9 @@ bool saveMaterials(const std::string& _filename, const Mesh& _mesh) {
                 if (filename.size() > 0) {
                     fprintf(mtl_file, "map_%s %s\n", mat_value_obj[j].c_str(), filename.c_str() );
                     if (!urlExists(filename)) {
-                        Image img = mat->getImage(mat_value_name[j]);
-                        save(filename, img);
+                        ImagePtr img = mat->getImagePtr(mat_value_name[j]);
+                        if (img)
+                            save(filename, *img);
                     }
                 }
                 else
@@ -100,8 +101,9 @@ bool saveMaterials(const std::string& _filename, const Mesh& _mesh) {
                 if (filename.size() > 0) {
                     fprintf(mtl_file, "map_%s %s\n", mat_color_obj[j].c_str(), filename.c_str() );
                     if (!urlExists(filename)) {
-                        Image img = mat->getImage(mat_color_name[j]);
-                        save(filename, img);
+                        ImagePtr img = mat->getImagePtr(mat_color_name[j]);
+                        if (img)
+                            save(filename, *img);
                     }
                 }
                 else {
@@ -115,8 +117,9 @@ bool saveMaterials(const std::string& _filename, const Mesh& _mesh) {
             if (filename.size() > 0) {
                 fprintf(mtl_file, "map_%s %s\n", mat_tex_obj[j].c_str(),filename.c_str() );
                 if (!urlExists(filename)) {
-                    Image img = mat->getImage(mat_tex_name[j]);
-                    save(filename, img);
+                    ImagePtr img = mat->getImagePtr(mat_tex_name[j]);
+                    if (img)
+                        save(filename, *img);
                 }
             }
         }
@@ -0,0 +1,29 @@
+#include "hilma/io/raw.h"
+
+#include <stdio.h>
+#include <vector>
+
+namespace hilma {
+
+bool saveRaw( const std::string& _filename, const Volume& _volume ) {
+    FILE * raw_file = fopen(_filename.c_str(), "wb");
+    if (NULL == raw_file) {
+        fprintf(stderr,"IOError: %s could not be opened...\n", _filename.c_str());
+        return false;
+    }
+
+    // one row at a time, the volume is never dense in memory
+    std::vector<float> row(_volume.getWidth());
+    bool ok = true;
+    for (int z = 0; z < _volume.getDepth() && ok; z++)
+        for (int y = 0; y < _volume.getHeight() && ok; y++) {
+            for (int x = 0; x < _volume.getWidth(); x++)
+                row[x] = _volume.getValue(x, y, z);
+            ok = fwrite(row.data(), sizeof(float), row.size(), raw_file) == row.size();
+        }
+
+    fclose(raw_file);
+    return ok;
+}
+
+}
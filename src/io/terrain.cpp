@@ -0,0 +1,85 @@
+#include "hilma/io/terrain.h"
+
+#include "hilma/io/gltf.h"
+#include "hilma/io/png.h"
+#include "hilma/ops/convert_image.h"
+#include "hilma/fs.h"
+#include "hilma/text.h"
+
+#include <mutex>
+#include <tuple>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "../deps/json.hpp"
+
+namespace hilma {
+
+bool saveTerrain(   const std::string& _folder, const Image& _heightmap, float _zScale,
+                    int _tileSize, float _maxError, float _skirtHeight,
+                    bool _normalmaps, bool _quantize, size_t _threads) {
+
+    if (!makeDir(_folder)) {
+        std::cout << "Can't create the folder " << _folder << std::endl;
+        return false;
+    }
+
+    std::mutex mutex;
+    std::vector<nlohmann::json> tiles;
+    bool ok = true;
+
+    // tiles are written and released as they come
+    int levels = toTerrainQuadtree(_heightmap, _zScale, _tileSize, _maxError, _skirtHeight, [&](TerrainTile& _tile) {
+        const std::string name = toString(_tile.level) + "_" + toString(_tile.x) + "_" + toString(_tile.y);
+
+        bool saved = saveGlb(_folder + "/" + name + ".glb", _tile.mesh, _quantize);
+
+        // the samples are step pixels apart, and this already runs on a worker thread
+        if (_normalmaps)
+            saved = savePng(_folder + "/" + name + ".png", toNormalmap(_tile.heights, _zScale / _tile.step, NORMALMAP_CENTRAL, 1)) && saved;
+
+        nlohmann::json entry;
+        entry["level"] = _tile.level;
+        entry["x"] = _tile.x;
+        entry["y"] = _tile.y;
+        entry["error"] = _tile.error * _zScale;
+        entry["min"] = { _tile.min.x, _tile.min.y };
+        entry["max"] = { _tile.max.x, _tile.max.y };
+        entry["vertices"] = _tile.mesh.getVerticesTotal();
+        entry["triangles"] = _tile.mesh.getFaceIndicesTotal() / 3;
+        entry["mesh"] = name + ".glb";
+        if (_normalmaps)
+            entry["normalmap"] = name + ".png";
+
+        std::lock_guard<std::mutex> lock(mutex);
+        tiles.push_back(entry);
+        ok = ok && saved;
+    }, _threads);
+
+    // same order no matter how the threads finished
+    std::sort(tiles.begin(), tiles.end(), [](const nlohmann::json& _a, const nlohmann::json& _b) {
+        return std::make_tuple(_a["level"].get<int>(), _a["y"].get<int>(), _a["x"].get<int>()) <
+               std::make_tuple(_b["level"].get<int>(), _b["y"].get<int>(), _b["x"].get<int>());
+    });
+
+    nlohmann::json manifest;
+    manifest["width"] = _heightmap.getWidth();
+    manifest["height"] = _heightmap.getHeight();
+    manifest["tileSize"] = _tileSize;
+    manifest["levels"] = levels;
+    manifest["zScale"] = _zScale;
+    manifest["skirtHeight"] = _skirtHeight;
+    manifest["tiles"] = tiles;
+
+    std::ofstream file(_folder + "/tiles.json");
+    if (!file.is_open()) {
+        std::cout << "Can't write " << _folder << "/tiles.json" << std::endl;
+        return false;
+    }
+    file << manifest.dump(1);
+
+    return ok && levels > 0;
+}
+
+}
@@ -0,0 +1,600 @@
+#include "hilma/ops/boolean.h"
+
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+#include "hilma/math.h"
+#include "hilma/parallel.h"
+
+#include "../accel/bins.h"
+
+namespace hilma {
+
+// The overlay works on doubles: all the edges of both operands are split where they
+// cross or touch, so the pieces only meet at their ends, pieces over the same two
+// vertices are grouped, and each group is kept when the result is inside on one side
+// of it and outside on the other. The winding numbers on the sides of a group come
+// from casting a ray from its middle.
+
+typedef std::vector< std::vector<glm::dvec2> > Rings;
+
+// Relative to the extent of the input
+const double SNAP = 1e-10;
+const double EPSILON = 1e-9;
+
+// Polygons merged together on the first level of merge()
+const size_t MERGE_GROUP = 16;
+
+static double cross(const glm::dvec2& _a, const glm::dvec2& _b) {
+    return _a.x * _b.y - _a.y * _b.x;
+}
+
+static Rings toRings(const Polygon& _polygon) {
+    Rings rings(_polygon.size());
+    for (size_t r = 0; r < _polygon.size(); r++)
+        for (size_t i = 0; i < _polygon[r].size(); i++)
+            rings[r].push_back( glm::dvec2(_polygon[r][i].x, _polygon[r][i].y) );
+    return rings;
+}
+
+static Polygon toPolygon(const Rings& _rings) {
+    Polygon out;
+    for (size_t r = 0; r < _rings.size(); r++) {
+        Polyline ring;
+        for (size_t i = 0; i < _rings[r].size(); i++)
+            ring.addVertex( float(_rings[r][i].x), float(_rings[r][i].y) );
+        ring.close();
+        out.append( ring );
+    }
+    return out;
+}
+
+static bool isInside(int _winding, FillRule _rule) {
+    return (_rule == FILL_EVEN_ODD) ? (_winding & 1) != 0 : _winding != 0;
+}
+
+static bool isInside(int _a, int _b, BooleanOp _op, FillRule _rule) {
+    bool a = isInside(_a, _rule);
+    bool b = isInside(_b, _rule);
+    switch (_op) {
+        case BOOLEAN_UNION:         return a || b;
+        case BOOLEAN_INTERSECTION:  return a && b;
+        case BOOLEAN_DIFFERENCE:    return a && !b;
+        case BOOLEAN_XOR:           return a != b;
+    }
+    return false;
+}
+
+struct OverlayEdge {
+    glm::dvec2  a;
+    glm::dvec2  b;
+    int         operand;
+};
+
+struct Split {
+    double      t;
+    glm::dvec2  p;
+    bool operator<(const Split& _other) const { return t < _other.t; }
+};
+
+// Vertices with the same coordinates once snapped are the same vertex
+struct VertexKey {
+    int64_t x, y;
+    bool operator==(const VertexKey& _other) const { return x == _other.x && y == _other.y; }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& _k) const { return std::hash<int64_t>()(_k.x * 73856093LL ^ _k.y * 19349663LL); }
+};
+
+struct Group {
+    uint32_t    u, v;       // from u to v, u < v
+    int         w[2];       // winding contribution of each operand when going from u to v
+};
+
+// Adds to _splits the points where _i and _j cross or touch
+static void intersect(const std::vector<OverlayEdge>& _edges, uint32_t _i, uint32_t _j, std::vector< std::vector<Split> >& _splits) {
+    const glm::dvec2& a = _edges[_i].a;
+    const glm::dvec2& b = _edges[_i].b;
+    const glm::dvec2& c = _edges[_j].a;
+    const glm::dvec2& d = _edges[_j].b;
+    glm::dvec2 r = b - a;
+    glm::dvec2 s = d - c;
+    glm::dvec2 ac = c - a;
+    double lr = glm::length(r);
+    double ls = glm::length(s);
+    double denom = cross(r, s);
+
+    if (std::fabs(denom) > EPSILON * lr * ls) {
+        double t = cross(ac, s) / denom;
+        double u = cross(ac, r) / denom;
+        if (t < -EPSILON || t > 1.0 + EPSILON || u < -EPSILON || u > 1.0 + EPSILON)
+            return;
+
+        // touching at an end uses that vertex as it is, and axis aligned edges stay that way
+        glm::dvec2 p = a + r * t;
+        if (r.x == 0.0) p.x = a.x;
+        if (r.y == 0.0) p.y = a.y;
+        if (s.x == 0.0) p.x = c.x;
+        if (s.y == 0.0) p.y = c.y;
+        if (u <= EPSILON)               p = c;
+        else if (u >= 1.0 - EPSILON)    p = d;
+        else if (t <= EPSILON)          p = a;
+        else if (t >= 1.0 - EPSILON)    p = b;
+
+        if (t > EPSILON && t < 1.0 - EPSILON)
+            _splits[_i].push_back( Split{t, p} );
+        if (u > EPSILON && u < 1.0 - EPSILON)
+            _splits[_j].push_back( Split{u, p} );
+        return;
+    }
+
+    // parallel, only collinear ones overlap
+    if (std::fabs(cross(ac, r)) > EPSILON * lr * glm::length(ac))
+        return;
+
+    double rr = glm::dot(r, r);
+    double ss = glm::dot(s, s);
+    if (rr == 0.0 || ss == 0.0)
+        return;
+
+    double tc = glm::dot(c - a, r) / rr;
+    double td = glm::dot(d - a, r) / rr;
+    double ua = glm::dot(a - c, s) / ss;
+    double ub = glm::dot(b - c, s) / ss;
+    if (tc > EPSILON && tc < 1.0 - EPSILON) _splits[_i].push_back( Split{tc, c} );
+    if (td > EPSILON && td < 1.0 - EPSILON) _splits[_i].push_back( Split{td, d} );
+    if (ua > EPSILON && ua < 1.0 - EPSILON) _splits[_j].push_back( Split{ua, a} );
+    if (ub > EPSILON && ub < 1.0 - EPSILON) _splits[_j].push_back( Split{ub, b} );
+}
+
+static Rings overlay(const Rings& _a, const Rings& _b, BooleanOp _op, FillRule _rule) {
+    Rings out;
+
+    // work around the corner of the bounding box, so the precision doesn't depend on where the input is
+    glm::dvec2 lo = glm::dvec2(DBL_MAX);
+    glm::dvec2 hi = glm::dvec2(-DBL_MAX);
+    const Rings* operands[2] = { &_a, &_b };
+    for (int o = 0; o < 2; o++)
+        for (size_t r = 0; r < operands[o]->size(); r++)
+            for (size_t i = 0; i < (*operands[o])[r].size(); i++) {
+                lo = glm::min(lo, (*operands[o])[r][i]);
+                hi = glm::max(hi, (*operands[o])[r][i]);
+            }
+
+    double extent = std::max(hi.x - lo.x, hi.y - lo.y);
+    if (!(extent > 0.0))
+        return out;
+
+    std::vector<OverlayEdge> edges;
+    for (int o = 0; o < 2; o++)
+        for (size_t r = 0; r < operands[o]->size(); r++) {
+            const std::vector<glm::dvec2>& ring = (*operands[o])[r];
+            size_t n = ring.size();
+            if (n < 3)
+                continue;
+
+            for (size_t i = 0; i < n; i++) {
+                OverlayEdge edge;
+                edge.a = ring[i] - lo;
+                edge.b = ring[(i + 1) % n] - lo;
+                edge.operand = o;
+                if (edge.a != edge.b)
+                    edges.push_back(edge);
+            }
+        }
+
+    const size_t total = edges.size();
+    if (total == 0)
+        return out;
+
+    // 1. split the edges where they meet, looking for pairs on a uniform grid
+    std::vector< std::vector<Split> > splits(total);
+    {
+        glm::dvec2 size = hi - lo;
+        double cell = std::sqrt( std::max(size.x * size.y, extent * extent * 1e-6) * 2.0 / total );
+        int width = std::max(1, std::min(2048, int(std::ceil(size.x / cell))));
+        int height = std::max(1, std::min(2048, int(std::ceil(size.y / cell))));
+        glm::dvec2 scale = glm::dvec2( width / std::max(size.x, extent * 1e-6), height / std::max(size.y, extent * 1e-6) );
+
+        auto toCell = [&](const glm::dvec2& _p) {
+            return glm::ivec2( glm::clamp(int(_p.x * scale.x), 0, width - 1), glm::clamp(int(_p.y * scale.y), 0, height - 1) );
+        };
+
+        std::vector<uint32_t> cellsLo, cellsHi, ids, offsets, list;
+        for (size_t e = 0; e < total; e++) {
+            glm::ivec2 c0 = toCell( glm::min(edges[e].a, edges[e].b) );
+            glm::ivec2 c1 = toCell( glm::max(edges[e].a, edges[e].b) );
+            for (int y = c0.y; y <= c1.y; y++) {
+                cellsLo.push_back(y * width + c0.x);
+                cellsHi.push_back(y * width + c1.x);
+                ids.push_back(e);
+            }
+        }
+        bin(cellsLo, cellsHi, size_t(width) * height, offsets, list, &ids);
+
+        for (size_t c = 0; c < size_t(width) * height; c++)
+            for (uint32_t i = offsets[c]; i < offsets[c + 1]; i++)
+                for (uint32_t j = i + 1; j < offsets[c + 1]; j++) {
+                    uint32_t ei = list[i];
+                    uint32_t ej = list[j];
+
+                    // each pair only once, on the cell of the corner of their boxes overlap
+                    glm::dvec2 corner = glm::max( glm::min(edges[ei].a, edges[ei].b), glm::min(edges[ej].a, edges[ej].b) );
+                    glm::dvec2 far = glm::min( glm::max(edges[ei].a, edges[ei].b), glm::max(edges[ej].a, edges[ej].b) );
+                    if (corner.x > far.x || corner.y > far.y)
+                        continue;
+                    glm::ivec2 home = toCell(corner);
+                    if (size_t(home.y) * width + home.x != c)
+                        continue;
+
+                    intersect(edges, ei, ej, splits);
+                }
+    }
+
+    // 2. cut the edges into pieces between snapped vertices, and group the pieces over the same vertices
+    const double snap = extent * SNAP;
+    std::vector<glm::dvec2> vertices;
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> vertexIds;
+    auto getVertex = [&](const glm::dvec2& _p) {
+        VertexKey key = { std::llround(_p.x / snap), std::llround(_p.y / snap) };
+        auto it = vertexIds.find(key);
+        if (it != vertexIds.end())
+            return it->second;
+        uint32_t id = vertices.size();
+        vertexIds[key] = id;
+        vertices.push_back(_p);
+        return id;
+    };
+
+    std::vector<Group> groups;
+    std::unordered_map<uint64_t, uint32_t> groupIds;
+    for (size_t e = 0; e < total; e++) {
+        std::sort(splits[e].begin(), splits[e].end());
+        uint32_t prev = getVertex(edges[e].a);
+        for (size_t s = 0; s <= splits[e].size(); s++) {
+            uint32_t next = (s < splits[e].size()) ? getVertex(splits[e][s].p) : getVertex(edges[e].b);
+            if (next == prev)
+                continue;
+
+            uint32_t u = std::min(prev, next);
+            uint32_t v = std::max(prev, next);
+            uint64_t key = (uint64_t(u) << 32) | v;
+            auto it = groupIds.find(key);
+            uint32_t g;
+            if (it == groupIds.end()) {
+                g = groups.size();
+                groupIds[key] = g;
+                Group group;
+                group.u = u;
+                group.v = v;
+                group.w[0] = group.w[1] = 0;
+                groups.push_back(group);
+            }
+            else
+                g = it->second;
+
+            groups[g].w[ edges[e].operand ] += (prev == u) ? 1 : -1;
+            prev = next;
+        }
+    }
+
+    // pieces that cancel each other don't change any winding number
+    groups.erase(std::remove_if(groups.begin(), groups.end(), [](const Group& _g) { return _g.w[0] == 0 && _g.w[1] == 0; }), groups.end());
+    if (groups.size() == 0)
+        return out;
+
+    // 3. rows of groups for rays along +x and columns for rays along +y
+    const size_t bins = std::max(size_t(1), groups.size() / 2);
+    const double binScale = double(bins) / extent;
+    std::vector<uint32_t> rowsOffsets, rows, colsOffsets, cols;
+    {
+        std::vector<uint32_t> rowsLo, rowsHi, rowsIds, colsLo, colsHi, colsIds;
+        for (size_t g = 0; g < groups.size(); g++) {
+            const glm::dvec2& p = vertices[groups[g].u];
+            const glm::dvec2& q = vertices[groups[g].v];
+            if (p.y != q.y) {
+                rowsLo.push_back( std::min(bins - 1, size_t(std::min(p.y, q.y) * binScale)) );
+                rowsHi.push_back( std::min(bins - 1, size_t(std::max(p.y, q.y) * binScale)) );
+                rowsIds.push_back(g);
+            }
+            if (p.x != q.x) {
+                colsLo.push_back( std::min(bins - 1, size_t(std::min(p.x, q.x) * binScale)) );
+                colsHi.push_back( std::min(bins - 1, size_t(std::max(p.x, q.x) * binScale)) );
+                colsIds.push_back(g);
+            }
+        }
+        bin(rowsLo, rowsHi, bins, rowsOffsets, rows, &rowsIds);
+        bin(colsLo, colsHi, bins, colsOffsets, cols, &colsIds);
+    }
+
+    // 4. keep the groups with the result inside on one side only, oriented with the inside on their left
+    std::vector< std::vector<uint32_t> > outgoing(vertices.size());
+    std::vector<uint32_t> ends;
+    for (size_t g = 0; g < groups.size(); g++) {
+        const glm::dvec2& p = vertices[groups[g].u];
+        const glm::dvec2& q = vertices[groups[g].v];
+        glm::dvec2 m = (p + q) * 0.5;
+        int plus[2] = { 0, 0 };
+        int self[2] = { 0, 0 };
+        bool left;      // if the side the ray goes to is the left of u -> v
+
+        // the ray leaves across the group, never along it
+        if (std::fabs(q.y - p.y) >= std::fabs(q.x - p.x)) {
+            // ray along +x, edges going up add their winding
+            size_t row = std::min(bins - 1, size_t(m.y * binScale));
+            for (uint32_t i = rowsOffsets[row]; i < rowsOffsets[row + 1]; i++) {
+                if (rows[i] == g)
+                    continue;
+                const Group& o = groups[rows[i]];
+                const glm::dvec2& a = vertices[o.u];
+                const glm::dvec2& b = vertices[o.v];
+                if (m.y > std::min(a.y, b.y) && m.y <= std::max(a.y, b.y)) {
+                    double x = a.x + (m.y - a.y) * (b.x - a.x) / (b.y - a.y);
+                    if (x > m.x) {
+                        int sign = (b.y > a.y) ? 1 : -1;
+                        plus[0] += sign * o.w[0];
+                        plus[1] += sign * o.w[1];
+                    }
+                }
+            }
+            int sign = (q.y > p.y) ? 1 : -1;
+            self[0] = sign * groups[g].w[0];
+            self[1] = sign * groups[g].w[1];
+            left = q.y < p.y;
+        }
+        else {
+            // ray along +y, edges going left add their winding
+            size_t col = std::min(bins - 1, size_t(m.x * binScale));
+            for (uint32_t i = colsOffsets[col]; i < colsOffsets[col + 1]; i++) {
+                if (cols[i] == g)
+                    continue;
+                const Group& o = groups[cols[i]];
+                const glm::dvec2& a = vertices[o.u];
+                const glm::dvec2& b = vertices[o.v];
+                if (m.x > std::min(a.x, b.x) && m.x <= std::max(a.x, b.x)) {
+                    double y = a.y + (m.x - a.x) * (b.y - a.y) / (b.x - a.x);
+                    if (y > m.y) {
+                        int sign = (b.x < a.x) ? 1 : -1;
+                        plus[0] += sign * o.w[0];
+                        plus[1] += sign * o.w[1];
+                    }
+                }
+            }
+            int sign = (q.x < p.x) ? 1 : -1;
+            self[0] = sign * groups[g].w[0];
+            self[1] = sign * groups[g].w[1];
+            left = q.x > p.x;
+        }
+
+        // crossing the group from the other side adds its own winding
+        bool insidePlus = isInside(plus[0], plus[1], _op, _rule);
+        bool insideMinus = isInside(plus[0] + self[0], plus[1] + self[1], _op, _rule);
+        if (insidePlus == insideMinus)
+            continue;
+
+        bool insideLeft = left ? insidePlus : insideMinus;
+        uint32_t from = insideLeft ? groups[g].u : groups[g].v;
+        uint32_t to = insideLeft ? groups[g].v : groups[g].u;
+        outgoing[from].push_back( ends.size() );
+        ends.push_back( to );
+    }
+
+    // 5. chain them into rings, turning as much to the left as possible on shared vertices
+    std::vector<uint32_t> starts(ends.size());
+    for (size_t v = 0; v < outgoing.size(); v++)
+        for (size_t i = 0; i < outgoing[v].size(); i++)
+            starts[ outgoing[v][i] ] = v;
+
+    std::vector<bool> used(ends.size(), false);
+    for (size_t first = 0; first < ends.size(); first++) {
+        if (used[first])
+            continue;
+
+        std::vector<glm::dvec2> ring;
+        uint32_t e = first;
+        while (true) {
+            used[e] = true;
+            ring.push_back( vertices[starts[e]] );
+            uint32_t v = ends[e];
+            if (v == starts[first])
+                break;
+
+            glm::dvec2 in = vertices[v] - vertices[starts[e]];
+            uint32_t next = 0xFFFFFFFF;
+            double best = -DBL_MAX;
+            for (size_t i = 0; i < outgoing[v].size(); i++) {
+                uint32_t o = outgoing[v][i];
+                if (used[o])
+                    continue;
+                glm::dvec2 d = vertices[ends[o]] - vertices[v];
+                double angle = std::atan2(cross(in, d), glm::dot(in, d));
+                if (angle > best) {
+                    best = angle;
+                    next = o;
+                }
+            }
+
+            if (next == 0xFFFFFFFF)
+                break;
+            e = next;
+        }
+
+        // drop the vertices left in the middle of straight lines by the splits
+        std::vector<glm::dvec2> clean;
+        size_t n = ring.size();
+        for (size_t i = 0; i < n; i++) {
+            const glm::dvec2& a = ring[(i + n - 1) % n];
+            const glm::dvec2& b = ring[i];
+            const glm::dvec2& c = ring[(i + 1) % n];
+            glm::dvec2 ab = b - a;
+            glm::dvec2 bc = c - b;
+            if (std::fabs(cross(ab, bc)) <= EPSILON * glm::length(ab) * glm::length(bc) && glm::dot(ab, bc) > 0.0)
+                continue;
+            clean.push_back(b + lo);
+        }
+
+        if (clean.size() >= 3)
+            out.push_back(clean);
+    }
+
+    return out;
+}
+
+Polygon boolean(const Polygon& _a, const Polygon& _b, BooleanOp _op, FillRule _rule) {
+    return toPolygon( overlay(toRings(_a), toRings(_b), _op, _rule) );
+}
+
+Polygon merge(const Polygon& _polygon, FillRule _rule) {
+    return toPolygon( overlay(toRings(_polygon), Rings(), BOOLEAN_UNION, _rule) );
+}
+
+Polygon merge(const std::vector<Polygon>& _polygons, FillRule _rule, size_t _threads) {
+    // each polygon on its own first, so they come out oriented and can be added with non zero
+    std::vector<Rings> level(_polygons.size());
+    parallelFor(_polygons.size(), [&](size_t _i, size_t /*_thread*/) {
+        level[_i] = overlay(toRings(_polygons[_i]), Rings(), BOOLEAN_UNION, _rule);
+    }, _threads);
+
+    // then in groups, and the groups by pairs until there is one
+    size_t group = MERGE_GROUP;
+    while (level.size() > 1) {
+        std::vector<Rings> next( (level.size() + group - 1) / group );
+        parallelFor(next.size(), [&](size_t _i, size_t /*_thread*/) {
+            Rings rings;
+            for (size_t j = _i * group; j < std::min(level.size(), (_i + 1) * group); j++)
+                rings.insert(rings.end(), level[j].begin(), level[j].end());
+            next[_i] = overlay(rings, Rings(), BOOLEAN_UNION, FILL_NON_ZERO);
+        }, _threads);
+        level.swap(next);
+        group = 2;
+    }
+
+    if (level.size() == 0)
+        return Polygon();
+    return toPolygon(level[0]);
+}
+
+// Counter clockwise circle
+static std::vector<glm::dvec2> circle(const glm::dvec2& _center, double _radius, int _resolution) {
+    std::vector<glm::dvec2> ring(_resolution);
+    for (int i = 0; i < _resolution; i++) {
+        double a = 2.0 * PI * i / _resolution;
+        ring[i] = _center + glm::dvec2(std::cos(a), std::sin(a)) * _radius;
+    }
+    return ring;
+}
+
+static void orient(std::vector<glm::dvec2>& _ring) {
+    double area = 0.0;
+    for (size_t i = 0; i < _ring.size(); i++)
+        area += cross(_ring[i], _ring[(i + 1) % _ring.size()]);
+    if (area < 0.0)
+        std::reverse(_ring.begin(), _ring.end());
+}
+
+// Counter clockwise pieces whose union is the buffer of the line
+static void addBuffer(const std::vector<glm::dvec2>& _points, bool _closed, double _distance, JoinType _join, CapType _cap,
+                    int _resolution, double _miterLimit, Rings& _pieces) {
+    std::vector<glm::dvec2> points;
+    for (size_t i = 0; i < _points.size(); i++)
+        if (points.size() == 0 || _points[i] != points.back())
+            points.push_back(_points[i]);
+    if (_closed && points.size() > 1 && points.front() == points.back())
+        points.pop_back();
+
+    size_t n = points.size();
+    if (n == 0 || _distance <= 0.0)
+        return;
+
+    _resolution = std::max(_resolution, 4);
+    if (n == 1) {
+        if (_cap == CapType::ROUND)
+            _pieces.push_back( circle(points[0], _distance, _resolution) );
+        return;
+    }
+
+    size_t segments = _closed ? n : n - 1;
+    for (size_t i = 0; i < segments; i++) {
+        glm::dvec2 a = points[i];
+        glm::dvec2 b = points[(i + 1) % n];
+        glm::dvec2 dir = glm::normalize(b - a);
+        glm::dvec2 normal = glm::dvec2(-dir.y, dir.x) * _distance;
+
+        if (!_closed && _cap == CapType::SQUARE) {
+            if (i == 0)             a -= dir * _distance;
+            if (i == segments - 1)  b += dir * _distance;
+        }
+
+        std::vector<glm::dvec2> quad = { a - normal, b - normal, b + normal, a + normal };
+        _pieces.push_back(quad);
+    }
+
+    if (!_closed && _cap == CapType::ROUND) {
+        _pieces.push_back( circle(points[0], _distance, _resolution) );
+        _pieces.push_back( circle(points[n - 1], _distance, _resolution) );
+    }
+
+    // joins, on the outer side of each turn
+    for (size_t i = _closed ? 0 : 1; i < (_closed ? n : n - 1); i++) {
+        glm::dvec2 p = points[(i + n - 1) % n];
+        glm::dvec2 v = points[i];
+        glm::dvec2 q = points[(i + 1) % n];
+        glm::dvec2 d0 = glm::normalize(v - p);
+        glm::dvec2 d1 = glm::normalize(q - v);
+        double turn = cross(d0, d1);
+        if (turn == 0.0 && glm::dot(d0, d1) > 0.0)
+            continue;
+
+        if (_join == JoinType::ROUND) {
+            _pieces.push_back( circle(v, _distance, _resolution) );
+            continue;
+        }
+
+        // the outer side is right of the line when turning left
+        double side = (turn > 0.0) ? -1.0 : 1.0;
+        glm::dvec2 n0 = glm::dvec2(-d0.y, d0.x) * side;
+        glm::dvec2 n1 = glm::dvec2(-d1.y, d1.x) * side;
+        std::vector<glm::dvec2> piece = { v, v + n0 * _distance };
+
+        glm::dvec2 miter = n0 + n1;
+        double l = glm::length(miter);
+        if (_join == JoinType::MITER && l > 0.0) {
+            double scale = 2.0 / (l * l);          // 1 / cos(half the angle), over |miter|
+            if (scale * l <= _miterLimit)
+                piece.push_back( v + miter * scale * _distance );
+        }
+
+        piece.push_back( v + n1 * _distance );
+        orient(piece);
+        _pieces.push_back(piece);
+    }
+}
+
+Polygon offset(const Polyline& _polyline, float _distance, JoinType _join, CapType _cap, int _resolution, float _miterLimit) {
+    std::vector<glm::dvec2> points;
+    for (size_t i = 0; i < _polyline.size(); i++)
+        points.push_back( glm::dvec2(_polyline[i].x, _polyline[i].y) );
+
+    Rings pieces;
+    addBuffer(points, _polyline.isClosed(), std::fabs(_distance), _join, _cap, _resolution, _miterLimit, pieces);
+    return toPolygon( overlay(pieces, Rings(), BOOLEAN_UNION, FILL_NON_ZERO) );
+}
+
+Polygon offset(const Polygon& _polygon, float _distance, JoinType _join, int _resolution, float _miterLimit) {
+    Rings rings = overlay(toRings(_polygon), Rings(), BOOLEAN_UNION, FILL_EVEN_ODD);
+    if (_distance == 0.0f)
+        return toPolygon(rings);
+
+    // the band around the outline is added or taken away
+    Rings band;
+    for (size_t r = 0; r < rings.size(); r++)
+        addBuffer(rings[r], true, std::fabs(_distance), _join, CapType::BUTT, _resolution, _miterLimit, band);
+
+    return toPolygon( overlay(rings, band, (_distance > 0.0f) ? BOOLEAN_UNION : BOOLEAN_DIFFERENCE, FILL_NON_ZERO) );
+}
+
+}
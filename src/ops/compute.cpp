@@ -1,7 +1,12 @@
 #include "hilma/ops/compute.h"
 
+#include <array>
+#include <cfloat>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
+
+#include "hilma/parallel.h"
 
 namespace hilma {
 
@@ -131,6 +136,148 @@ void simplify(std::vector<glm::vec2>& _points, float _tolerance) {
     }
 }
 
+// Inputs are reduced in chunks of this many points, one per thread
+static const size_t CHUNK_SIZE = 1 << 16;
+
+// Points taken at once by the reductions, each on its own accumulators so
+// the loop has no dependency chain and compilers can vectorize it
+static const int LANES = 4;
+
+static size_t getChunksTotal(size_t _total) {
+    return (_total + CHUNK_SIZE - 1) / CHUNK_SIZE;
+}
+
+// Min, max and (optionally) sum of the N components of the points in [_begin, _end)
+template<int N, bool SUM>
+struct Reduction {
+    float   min[N];
+    float   max[N];
+    double  sum[N];
+
+    Reduction() {
+        for (int c = 0; c < N; c++) {
+            min[c] = FLT_MAX;
+            max[c] = -FLT_MAX;
+            sum[c] = 0.0;
+        }
+    }
+
+    void add(const float* _data, size_t _begin, size_t _end) {
+        float   lmin[LANES][N];
+        float   lmax[LANES][N];
+        double  lsum[LANES][N];
+        for (int l = 0; l < LANES; l++)
+            for (int c = 0; c < N; c++) {
+                lmin[l][c] = min[c];
+                lmax[l][c] = max[c];
+                lsum[l][c] = 0.0;
+            }
+
+        size_t i = _begin;
+        for (; i + LANES <= _end; i += LANES) {
+            const float* p = _data + i * N;
+            for (int l = 0; l < LANES; l++)
+                for (int c = 0; c < N; c++) {
+                    float v = p[l * N + c];
+                    lmin[l][c] = v < lmin[l][c] ? v : lmin[l][c];
+                    lmax[l][c] = v > lmax[l][c] ? v : lmax[l][c];
+                    if (SUM) lsum[l][c] += v;
+                }
+        }
+        for (; i < _end; i++)
+            for (int c = 0; c < N; c++) {
+                float v = _data[i * N + c];
+                lmin[0][c] = v < lmin[0][c] ? v : lmin[0][c];
+                lmax[0][c] = v > lmax[0][c] ? v : lmax[0][c];
+                if (SUM) lsum[0][c] += v;
+            }
+
+        for (int l = 0; l < LANES; l++)
+            for (int c = 0; c < N; c++) {
+                min[c] = std::min(min[c], lmin[l][c]);
+                max[c] = std::max(max[c], lmax[l][c]);
+                sum[c] += lsum[l][c];
+            }
+    }
+
+    void add(const Reduction& _other) {
+        for (int c = 0; c < N; c++) {
+            min[c] = std::min(min[c], _other.min[c]);
+            max[c] = std::max(max[c], _other.max[c]);
+            sum[c] += _other.sum[c];
+        }
+    }
+};
+
+// Reduces _total points of N floats each, in chunks across threads
+template<int N, bool SUM>
+Reduction<N, SUM> reduce(const float* _data, size_t _total, size_t _threads = 0) {
+    std::vector< Reduction<N, SUM> > chunks( getChunksTotal(_total) );
+    parallelFor(chunks.size(), [&](size_t _i, size_t /*_thread*/) {
+        chunks[_i].add(_data, _i * CHUNK_SIZE, std::min(_total, (_i + 1) * CHUNK_SIZE));
+    }, _threads);
+
+    Reduction<N, SUM> rta;
+    for (size_t i = 0; i < chunks.size(); i++)
+        rta.add(chunks[i]);
+    return rta;
+}
+
+// Twice the signed area of the ring edges that start in [_begin, _end)
+static double getAreaTwice(const std::vector<glm::vec2>& _points, size_t _begin, size_t _end) {
+    double area[LANES] = { 0.0 };
+
+    size_t last = std::min(_end, _points.size() - 1);
+    size_t i = _begin;
+    for (; i + LANES <= last; i += LANES)
+        for (int l = 0; l < LANES; l++)
+            area[l] += double(_points[i+l].x) * _points[i+l+1].y - double(_points[i+l+1].x) * _points[i+l].y;
+    for (; i < last; i++)
+        area[0] += double(_points[i].x) * _points[i+1].y - double(_points[i+1].x) * _points[i].y;
+
+    // the edge that closes the ring
+    if (_end == _points.size()) {
+        const glm::vec2& a = _points.back();
+        const glm::vec2& b = _points.front();
+        area[0] += double(a.x) * b.y - double(b.x) * a.y;
+    }
+
+    return (area[0] + area[1]) + (area[2] + area[3]);
+}
+
+PointsStats getStats(const std::vector<glm::vec2>& _points, size_t _threads) {
+    PointsStats stats;
+    stats.centroid = glm::vec2(0.0f);
+    stats.area = 0.0f;
+    stats.count = _points.size();
+    if (_points.empty())
+        return stats;
+
+    // one pass over every point for all of them
+    size_t total = _points.size();
+    std::vector< Reduction<2, true> > chunks( getChunksTotal(total) );
+    std::vector<double> areas( chunks.size() );
+    parallelFor(chunks.size(), [&](size_t _i, size_t /*_thread*/) {
+        size_t begin = _i * CHUNK_SIZE;
+        size_t end = std::min(total, begin + CHUNK_SIZE);
+        chunks[_i].add(&_points[0].x, begin, end);
+        areas[_i] = getAreaTwice(_points, begin, end);
+    }, _threads);
+
+    Reduction<2, true> all;
+    double area = 0.0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        all.add(chunks[i]);
+        area += areas[i];
+    }
+
+    stats.bbox.expand(all.min[0], all.min[1]);
+    stats.bbox.expand(all.max[0], all.max[1]);
+    stats.centroid = glm::vec2(all.sum[0] / total, all.sum[1] / total);
+    stats.area = area * 0.5;
+    return stats;
+}
+
 bool lexicalComparison(const glm::vec2& _v1, const glm::vec2& _v2) {
     if (_v1.x > _v2.x) return true;
     else if (_v1.x < _v2.x) return false;
@@ -138,103 +285,423 @@ bool lexicalComparison(const glm::vec2& _v1, const glm::vec2& _v2) {
     else return false;
 }
 
-bool isRightTurn(const glm::vec2& _a, const glm::vec2& _b, const glm::vec2& _c) {
-    // use the cross product to determin if we have a right turn
-    return ((_b.x - _a.x)*(_c.y - _a.y) - (_b.y - _a.y)*(_c.x - _a.x)) > 0;
+static double cross(const glm::vec2& _o, const glm::vec2& _a, const glm::vec2& _b) {
+    return (double(_a.x) - _o.x) * (double(_b.y) - _o.y) - (double(_a.y) - _o.y) * (double(_b.x) - _o.x);
 }
 
-std::vector<glm::vec2> getConvexHull(const std::vector<glm::vec2>& _points) {
-    std::vector<glm::vec2> pts;
-    pts.assign(_points.begin(),_points.end());
+// Andrew's monotone chain over points sorted by lexicalComparison. The hull goes counter
+// clockwise from the first point and ends repeating it.
+static void getConvexHullSorted(const std::vector<glm::vec2>& _sorted, std::vector<glm::vec2>& _hull) {
+    size_t n = _sorted.size();
+    _hull.resize(n * 2);
+
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        while (k >= 2 && cross(_hull[k-2], _hull[k-1], _sorted[i]) <= 0.0)
+            k--;
+        _hull[k++] = _sorted[i];
+    }
+
+    for (size_t i = n - 1, t = k + 1; i-- > 0;) {
+        while (k >= t && cross(_hull[k-2], _hull[k-1], _sorted[i]) <= 0.0)
+            k--;
+        _hull[k++] = _sorted[i];
+    }
 
+    _hull.resize(k);
+}
+
+std::vector<glm::vec2> getConvexHull(const std::vector<glm::vec2>& _points, size_t _threads) {
     std::vector<glm::vec2> hull;
-    glm::vec2 h1,h2,h3;
 
     if (_points.size() < 3) {
         // std::cout << "Error: you need at least three points to calculate the convex hull" << std::endl;
         return hull;
     }
 
+    // Akl-Toussaint: the extreme points on x, y, x+y and x-y make a polygon inside
+    // the hull, every point strictly inside of it can be dropped before sorting
+    size_t total = _points.size();
+    size_t chunksTotal = getChunksTotal(total);
+    std::vector< std::array<uint32_t, 8> > extremes(chunksTotal);
+    parallelFor(chunksTotal, [&](size_t _i, size_t /*_thread*/) {
+        size_t begin = _i * CHUNK_SIZE;
+        size_t end = std::min(total, begin + CHUNK_SIZE);
+        std::array<uint32_t, 8>& e = extremes[_i];
+        e.fill(begin);
+        for (size_t i = begin + 1; i < end; i++) {
+            const glm::vec2& p = _points[i];
+            if (p.x > _points[e[0]].x) e[0] = i;
+            if (p.x + p.y > _points[e[1]].x + _points[e[1]].y) e[1] = i;
+            if (p.y > _points[e[2]].y) e[2] = i;
+            if (p.y - p.x > _points[e[3]].y - _points[e[3]].x) e[3] = i;
+            if (p.x < _points[e[4]].x) e[4] = i;
+            if (p.x + p.y < _points[e[5]].x + _points[e[5]].y) e[5] = i;
+            if (p.y < _points[e[6]].y) e[6] = i;
+            if (p.y - p.x < _points[e[7]].y - _points[e[7]].x) e[7] = i;
+        }
+    }, _threads);
+
+    std::array<uint32_t, 8> e = extremes[0];
+    for (size_t c = 1; c < chunksTotal; c++) {
+        const std::array<uint32_t, 8>& o = extremes[c];
+        const glm::vec2 p[8] = {    _points[o[0]], _points[o[1]], _points[o[2]], _points[o[3]],
+                                    _points[o[4]], _points[o[5]], _points[o[6]], _points[o[7]] };
+        if (p[0].x > _points[e[0]].x) e[0] = o[0];
+        if (p[1].x + p[1].y > _points[e[1]].x + _points[e[1]].y) e[1] = o[1];
+        if (p[2].y > _points[e[2]].y) e[2] = o[2];
+        if (p[3].y - p[3].x > _points[e[3]].y - _points[e[3]].x) e[3] = o[3];
+        if (p[4].x < _points[e[4]].x) e[4] = o[4];
+        if (p[5].x + p[5].y < _points[e[5]].x + _points[e[5]].y) e[5] = o[5];
+        if (p[6].y < _points[e[6]].y) e[6] = o[6];
+        if (p[7].y - p[7].x < _points[e[7]].y - _points[e[7]].x) e[7] = o[7];
+    }
+
+    // they come counter clockwise, without the repeated ones
+    std::vector<glm::vec2> filter;
+    for (int i = 0; i < 8; i++)
+        if (filter.empty() || (_points[e[i]] != filter.back() && _points[e[i]] != filter.front()))
+            filter.push_back(_points[e[i]]);
+
+    // each chunk is filtered, sorted and hulled on its own, the hull of their hulls is the hull of all
+    std::vector< std::vector<glm::vec2> > hulls(chunksTotal);
+    parallelFor(chunksTotal, [&](size_t _i, size_t /*_thread*/) {
+        size_t begin = _i * CHUNK_SIZE;
+        size_t end = std::min(total, begin + CHUNK_SIZE);
+
+        std::vector<glm::vec2> pts;
+        pts.reserve(end - begin);
+        for (size_t i = begin; i < end; i++) {
+            bool inside = filter.size() > 2;
+            for (size_t j = 0; j < filter.size() && inside; j++)
+                inside = cross(filter[j], filter[(j + 1) % filter.size()], _points[i]) > 0.0;
+            if (!inside)
+                pts.push_back(_points[i]);
+        }
+
+        std::sort(pts.begin(), pts.end(), &lexicalComparison);
+        if (chunksTotal == 1)
+            getConvexHullSorted(pts, hulls[_i]);
+        else if (pts.size() > 0) {
+            getConvexHullSorted(pts, hulls[_i]);
+            hulls[_i].pop_back();
+        }
+    }, _threads);
+
+    if (chunksTotal == 1)
+        return hulls[0];
+
+    std::vector<glm::vec2> pts;
+    for (size_t i = 0; i < hulls.size(); i++)
+        pts.insert(pts.end(), hulls[i].begin(), hulls[i].end());
     std::sort(pts.begin(), pts.end(), &lexicalComparison);
+    getConvexHullSorted(pts, hull);
+
+    return hull;
+}
+
+// 3D convex hull by quickhull: a tetrahedron grows towards the furthest point outside of
+// each face, replacing the faces that point sees with a fan from the horizon to it.
+struct HullFace {
+    uint32_t                v[3];
+    glm::dvec3              normal;
+    double                  offset;
+    std::vector<uint32_t>   outside;
+    bool                    alive;
+};
 
-    hull.push_back(pts.at(0));
-    hull.push_back(pts.at(1));
+class QuickHull {
+public:
+    QuickHull(const glm::vec3* _points, size_t _total) : points(_points), total(_total) {}
 
-    size_t currentPoint = 2;
-    int direction = 1;
+    // Indices of the triangles, counter clockwise from outside. Empty if the points are flat.
+    void    build(std::vector<uint32_t>& _triangles);
 
-    for (int i=0; i<3000; i++) { //max 1000 tries
+private:
+    static uint64_t key(uint32_t _a, uint32_t _b) { return uint64_t(_a) << 32 | _b; }
 
-        hull.push_back(pts.at(currentPoint));
+    double  distance(const HullFace& _face, uint32_t _point) const {
+        return glm::dot(_face.normal, glm::dvec3(points[_point])) - _face.offset;
+    }
 
-        // look at the turn direction in the last three points
-        h1 = hull.at(hull.size()-3);
-        h2 = hull.at(hull.size()-2);
-        h3 = hull.at(hull.size()-1);
+    uint32_t addFace(uint32_t _a, uint32_t _b, uint32_t _c);
+    void    assign(uint32_t _point, const std::vector<uint32_t>& _faces);
+
+    const glm::vec3*        points;
+    size_t                  total;
+    double                  epsilon;
+
+    std::vector<HullFace>   faces;
+    std::unordered_map<uint64_t, uint32_t> edges;  // directed edge to the face that has it
+};
+
+uint32_t QuickHull::addFace(uint32_t _a, uint32_t _b, uint32_t _c) {
+    HullFace face;
+    face.v[0] = _a;
+    face.v[1] = _b;
+    face.v[2] = _c;
+    glm::dvec3 a = glm::dvec3(points[_a]);
+    glm::dvec3 n = glm::cross(glm::dvec3(points[_b]) - a, glm::dvec3(points[_c]) - a);
+    double l = glm::length(n);
+    face.normal = (l > 0.0) ? n / l : glm::dvec3(0.0);
+    face.offset = glm::dot(face.normal, a);
+    face.alive = true;
+
+    uint32_t index = faces.size();
+    faces.push_back(face);
+    edges[key(_a, _b)] = index;
+    edges[key(_b, _c)] = index;
+    edges[key(_c, _a)] = index;
+    return index;
+}
 
-        // while there are more than two points in the hull
-        // and the last three points do not make a right turn
-        while (!isRightTurn(h1, h2, h3) && hull.size() > 2) {
+void QuickHull::assign(uint32_t _point, const std::vector<uint32_t>& _faces) {
+    double best = epsilon;
+    uint32_t face = uint32_t(-1);
+    for (size_t i = 0; i < _faces.size(); i++) {
+        double d = distance(faces[_faces[i]], _point);
+        if (d > best) {
+            best = d;
+            face = _faces[i];
+        }
+    }
+    if (face != uint32_t(-1))
+        faces[face].outside.push_back(_point);
+}
 
-            // remove the middle of the last three points
-            hull.erase(hull.end() - 2);
+void QuickHull::build(std::vector<uint32_t>& _triangles) {
+    if (total < 4)
+        return;
 
-            if (hull.size() >= 3) {
-                h1 = hull.at(hull.size()-3);
+    // extremes on each axis, the tolerance grows with the size of the coordinates
+    uint32_t extremes[6] = { 0, 0, 0, 0, 0, 0 };
+    glm::vec3 scale = glm::vec3(0.0f);
+    for (uint32_t i = 0; i < total; i++) {
+        for (int c = 0; c < 3; c++) {
+            if (points[i][c] < points[extremes[c]][c]) extremes[c] = i;
+            if (points[i][c] > points[extremes[c+3]][c]) extremes[c+3] = i;
+            scale[c] = std::max(scale[c], std::fabs(points[i][c]));
+        }
+    }
+    epsilon = 1000.0 * DBL_EPSILON * (scale.x + scale.y + scale.z);
+
+    // the initial tetrahedron: the two furthest extremes, the furthest point from their line and from their plane
+    uint32_t a = 0, b = 0;
+    double best = 0.0;
+    for (int i = 0; i < 6; i++)
+        for (int j = i + 1; j < 6; j++) {
+            double d = glm::length(glm::dvec3(points[extremes[i]]) - glm::dvec3(points[extremes[j]]));
+            if (d > best) {
+                best = d;
+                a = extremes[i];
+                b = extremes[j];
             }
-            h2 = hull.at(hull.size()-2);
-            h3 = hull.at(hull.size()-1);
         }
+    if (best <= epsilon)
+        return;
+
+    glm::dvec3 pa = glm::dvec3(points[a]);
+    glm::dvec3 dir = glm::normalize(glm::dvec3(points[b]) - pa);
+    uint32_t c = 0;
+    best = 0.0;
+    for (uint32_t i = 0; i < total; i++) {
+        double d = glm::length(glm::cross(glm::dvec3(points[i]) - pa, dir));
+        if (d > best) {
+            best = d;
+            c = i;
+        }
+    }
+    if (best <= epsilon)
+        return;
 
-        // going through left-to-right calculates the top hull
-        // when we get to the end, we reverse direction
-        // and go back again right-to-left to calculate the bottom hull
-        if (currentPoint == pts.size() -1 || currentPoint == 0) {
-            direction = direction * -1;
+    glm::dvec3 n = glm::normalize(glm::cross(glm::dvec3(points[b]) - pa, glm::dvec3(points[c]) - pa));
+    uint32_t d = 0;
+    best = 0.0;
+    for (uint32_t i = 0; i < total; i++) {
+        double dist = std::fabs(glm::dot(glm::dvec3(points[i]) - pa, n));
+        if (dist > best) {
+            best = dist;
+            d = i;
         }
+    }
+    if (best <= epsilon)
+        return;
 
-        currentPoint += direction;
+    // d goes below a, b, c
+    if (glm::dot(glm::dvec3(points[d]) - pa, n) > 0.0)
+        std::swap(b, c);
+
+    faces.reserve(total / 4 + 16);
+    edges.reserve(total / 2 + 32);
+    std::vector<uint32_t> added;
+    added.push_back( addFace(a, b, c) );
+    added.push_back( addFace(a, d, b) );
+    added.push_back( addFace(b, d, c) );
+    added.push_back( addFace(c, d, a) );
+
+    for (uint32_t i = 0; i < total; i++)
+        if (i != a && i != b && i != c && i != d)
+            assign(i, added);
+
+    std::vector<uint32_t> stack = added;
+    std::vector<uint32_t> visible;
+    std::vector<uint32_t> horizon;
+    std::vector<uint32_t> orphans;
+    std::vector<uint32_t> visibleStamp, hiddenStamp;
+    uint32_t stamp = 0;
+
+    while (!stack.empty()) {
+        uint32_t f = stack.back();
+        stack.pop_back();
+        if (!faces[f].alive || faces[f].outside.empty())
+            continue;
+
+        // the furthest point outside of the face
+        uint32_t eye = faces[f].outside[0];
+        best = distance(faces[f], eye);
+        for (size_t i = 1; i < faces[f].outside.size(); i++) {
+            double dist = distance(faces[f], faces[f].outside[i]);
+            if (dist > best) {
+                best = dist;
+                eye = faces[f].outside[i];
+            }
+        }
 
-        if (hull.front()==hull.back()) {
-            if (currentPoint == 3 && direction == 1) {
-                currentPoint = 4;
-            } else {
-                break;
+        // the faces it sees, walking from f, and the edges to the ones it doesn't see
+        stamp++;
+        visibleStamp.resize(faces.size(), 0);
+        hiddenStamp.resize(faces.size(), 0);
+        visible.clear();
+        horizon.clear();
+        visible.push_back(f);
+        visibleStamp[f] = stamp;
+        for (size_t i = 0; i < visible.size(); i++) {
+            const HullFace& face = faces[ visible[i] ];
+            for (int k = 0; k < 3; k++) {
+                uint32_t v0 = face.v[k];
+                uint32_t v1 = face.v[(k + 1) % 3];
+                uint32_t neighbor = edges[key(v1, v0)];
+                if (visibleStamp[neighbor] == stamp)
+                    continue;
+
+                if (hiddenStamp[neighbor] != stamp && distance(faces[neighbor], eye) > epsilon) {
+                    visibleStamp[neighbor] = stamp;
+                    visible.push_back(neighbor);
+                }
+                else {
+                    hiddenStamp[neighbor] = stamp;
+                    horizon.push_back(v0);
+                    horizon.push_back(v1);
+                }
             }
         }
+
+        // replace them with a fan from the horizon to the eye
+        orphans.clear();
+        for (size_t i = 0; i < visible.size(); i++) {
+            HullFace& face = faces[ visible[i] ];
+            orphans.insert(orphans.end(), face.outside.begin(), face.outside.end());
+            std::vector<uint32_t>().swap(face.outside);
+            face.alive = false;
+            for (int k = 0; k < 3; k++)
+                edges.erase( key(face.v[k], face.v[(k + 1) % 3]) );
+        }
+
+        added.clear();
+        for (size_t i = 0; i < horizon.size(); i += 2)
+            added.push_back( addFace(horizon[i], horizon[i + 1], eye) );
+
+        for (size_t i = 0; i < orphans.size(); i++)
+            if (orphans[i] != eye)
+                assign(orphans[i], added);
+
+        stack.insert(stack.end(), added.begin(), added.end());
     }
 
-    return hull;
+    for (size_t i = 0; i < faces.size(); i++)
+        if (faces[i].alive)
+            _triangles.insert(_triangles.end(), faces[i].v, faces[i].v + 3);
 }
 
+Mesh getConvexHull(const std::vector<glm::vec3>& _points, size_t _threads) {
+    Mesh mesh;
+    if (_points.size() < 4)
+        return mesh;
+
+    // the hull of each chunk goes across threads, the hull of their vertices is the hull of all
+    std::vector<glm::vec3> candidates;
+    const std::vector<glm::vec3>* points = &_points;
+    size_t chunksTotal = getChunksTotal(_points.size());
+    if (chunksTotal > 1) {
+        std::vector< std::vector<uint32_t> > hulls(chunksTotal);
+        parallelFor(chunksTotal, [&](size_t _i, size_t /*_thread*/) {
+            size_t begin = _i * CHUNK_SIZE;
+            size_t end = std::min(_points.size(), begin + CHUNK_SIZE);
+            std::vector<uint32_t> triangles;
+            QuickHull(&_points[begin], end - begin).build(triangles);
+
+            // a flat chunk keeps all its points
+            if (triangles.empty()) {
+                for (size_t i = begin; i < end; i++)
+                    hulls[_i].push_back(i);
+                return;
+            }
+
+            std::sort(triangles.begin(), triangles.end());
+            triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+            for (size_t i = 0; i < triangles.size(); i++)
+                hulls[_i].push_back(begin + triangles[i]);
+        }, _threads);
 
+        for (size_t i = 0; i < hulls.size(); i++)
+            for (size_t j = 0; j < hulls[i].size(); j++)
+                candidates.push_back(_points[ hulls[i][j] ]);
+        points = &candidates;
+    }
 
-float getArea(const std::vector<glm::vec2>& _points) {
-    float area = 0.0;
+    std::vector<uint32_t> triangles;
+    QuickHull(&(*points)[0], points->size()).build(triangles);
 
-    for (int i=0;i<(int)_points.size()-1;i++) {
-        area += _points[i].x * _points[i+1].y - _points[i+1].x * _points[i].y;
+    // only the vertices the triangles use
+    std::vector<uint32_t> ids(points->size(), uint32_t(-1));
+    for (size_t i = 0; i < triangles.size(); i++) {
+        uint32_t& id = ids[ triangles[i] ];
+        if (id == uint32_t(-1)) {
+            id = mesh.getVerticesTotal();
+            mesh.addVertex( (*points)[ triangles[i] ] );
+        }
     }
-    area += _points[_points.size()-1].x * _points[0].y - _points[0].x * _points[_points.size()-1].y;
-    area *= 0.5;
 
-    return area;
+    for (size_t i = 0; i < triangles.size(); i += 3)
+        mesh.addTriangleIndices( ids[triangles[i]], ids[triangles[i+1]], ids[triangles[i+2]] );
+
+    return mesh;
+}
+
+Mesh getConvexHull(const Mesh& _mesh, size_t _threads) {
+    return getConvexHull(_mesh.getVertices(), _threads);
+}
+
+float getArea(const std::vector<glm::vec2>& _points) {
+    if (_points.empty())
+        return 0.0f;
+    return getAreaTwice(_points, 0, _points.size()) * 0.5;
 }
 
 glm::vec2 getCentroid(const std::vector<glm::vec2>& _points) {
-    glm::vec2 centroid;
-    for (size_t i = 0; i < _points.size(); i++) {
-        centroid += _points[i] / (float)_points.size();
-    }
-    return centroid;
+    if (_points.empty())
+        return glm::vec2(0.0f);
+
+    Reduction<2, true> r = reduce<2, true>(&_points[0].x, _points.size());
+    return glm::vec2(r.sum[0] / _points.size(), r.sum[1] / _points.size());
 }
 
 glm::vec3 getCentroid(const std::vector<glm::vec3>& _points) {
-    glm::vec3 centroid;
-    for (size_t i = 0; i < _points.size(); i++) {
-        centroid += _points[i] / (float)_points.size();
-    }
-    return centroid;
+    if (_points.empty())
+        return glm::vec3(0.0f);
+
+    Reduction<3, true> r = reduce<3, true>(&_points[0].x, _points.size());
+    return glm::vec3(r.sum[0] / _points.size(), r.sum[1] / _points.size(), r.sum[2] / _points.size());
 }
 
 BoundingBox getBoundingBox(const Mesh& _mesh) {
@@ -243,15 +710,23 @@ BoundingBox getBoundingBox(const Mesh& _mesh) {
 
 BoundingBox getBoundingBox(const std::vector<glm::vec2>& _points ) {
     BoundingBox bbox;
-    for (std::vector<glm::vec2>::const_iterator it = _points.begin(); it != _points.end(); ++it)
-        bbox.expand(*it);
+    if (_points.empty())
+        return bbox;
+
+    Reduction<2, false> r = reduce<2, false>(&_points[0].x, _points.size());
+    bbox.expand(r.min[0], r.min[1]);
+    bbox.expand(r.max[0], r.max[1]);
     return bbox;
 }
 
 BoundingBox getBoundingBox(const std::vector<glm::vec3>& _points ) {
     BoundingBox bbox;
-    for (std::vector<glm::vec3>::const_iterator it = _points.begin(); it != _points.end(); ++it)
-        bbox.expand(*it);
+    if (_points.empty())
+        return bbox;
+
+    Reduction<3, false> r = reduce<3, false>(&_points[0].x, _points.size());
+    bbox.expand(r.min[0], r.min[1], r.min[2]);
+    bbox.expand(r.max[0], r.max[1], r.max[2]);
     return bbox;
 }
 
@@ -278,42 +753,45 @@ glm::vec2 getRange(const Image& _image) {
     float min =  10000.0f;
     float max = -10000.0f;
 
-    int total = _image.getWidth() * _image.getHeight() * _image.getChannels();
-    for (int i = 0; i < total; i++) {
-        float val = _image[i];
-        if (min > val) min = val;
-        if (max < val) max = val;
-    }
+    int channels = _image.getChannels();
+    for (int y = 0; y < _image.getHeight(); y++)
+        for (int x = 0; x < _image.getWidth(); x++) {
+            size_t index = _image.getIndex(x, y);
+            for (int c = 0; c < channels; c++) {
+                float val = _image.getValue(index + c);
+                if (min > val) min = val;
+                if (max < val) max = val;
+            }
+        }
 
     return glm::vec2(min, max);
 }
 
 std::vector<float> getMax(const float* _array2D, int _m, int _n) {
-    std::vector<float> out;
-    for (int i = 0; i < _n; i++)
-        out.push_back(-9999999.9);
+    std::vector<float> out(_n, -FLT_MAX);
+    float* o = out.data();
 
-    for (int i = 0; i < _m; i++)
+    // row by row, so the inner loop runs over contiguous values
+    for (int i = 0; i < _m; i++) {
+        const float* row = _array2D + size_t(i) * _n;
         for (int j = 0; j < _n; j++)
-            if (_array2D[i * _n + j] > out[j])
-                out[j] = _array2D[i * _n + j];
+            o[j] = row[j] > o[j] ? row[j] : o[j];
+    }
 
     return out;
 }
 
 std::vector<float> getMin(const float* _array2D, int _m, int _n) {
-    std::vector<float> out;
-    for (int i = 0; i < _n; i++)
-        out.push_back(9999999.9);
+    std::vector<float> out(_n, FLT_MAX);
+    float* o = out.data();
 
-    for (int i = 0; i < _m; i++)
+    for (int i = 0; i < _m; i++) {
+        const float* row = _array2D + size_t(i) * _n;
         for (int j = 0; j < _n; j++)
-            if (_array2D[i * _n + j] < out[j])
-                out[j] = _array2D[i * _n + j];
+            o[j] = row[j] < o[j] ? row[j] : o[j];
+    }
 
     return out;
-
-}
-
 }
 
+}
\ No newline at end of file
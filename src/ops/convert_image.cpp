@@ -3,24 +3,24 @@
 #include "hilma/ops/compute.h"
 #include "hilma/ops/transform.h"
 #include "hilma/ops/intersection.h"
+#include "hilma/ops/pipeline.h"
 
 #include "hilma/accel/BVH.h"
+#include "hilma/accel/MeshBVH.h"
 
 #include "hilma/math.h"
 #include "hilma/text.h"
+#include "hilma/parallel.h"
 
 #include <stdio.h>
 #include <cstring>
 #include <vector>
 #include <iostream>
 
-#include <map>
-#include <unordered_map>
+#include <queue>
+#include <cfloat>
 #include <algorithm>
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/normal.hpp>
-#include <glm/gtx/hash.hpp>
 
 #ifdef OPENIMAGEDENOISE_SUPPORT
 #include <OpenImageDenoise/oidn.hpp>
@@ -34,49 +34,36 @@
 namespace hilma {
 
 void sqrt(Image& _image) {
-    int total = _image.getWidth() * _image.getHeight() * _image.getChannels();
-    for (int i = 0; i < total; i++)
-        _image[i] = std::sqrt(_image[i]);
+    ImagePipeline().sqrt().apply(_image);
 }
 
 void invert(Image& _image) {
-    int total = _image.getWidth() * _image.getHeight() * _image.getChannels();
-    for (int i = 0; i < total; i++)
-        _image[i] = 1.0f -_image[i];
+    ImagePipeline().invert().apply(_image);
 }
 
 void gamma(Image& _image, float _gamma) {
-    int total = _image.getWidth() * _image.getHeight() * _image.getChannels();
-    for (int i = 0; i < total; i++)
-        _image[i] = std::pow(_image[i], _gamma);
+    ImagePipeline().gamma(_gamma).apply(_image);
 }
 
 void autolevel(Image& _image){
-    float lo = 1.0f;
-    float hi = 0.0f;
-
-    int total = _image.getWidth() * _image.getHeight() * _image.getChannels();
-    for (int i = 0; i < total; i++) {
-        float data = _image[i];
-        lo = std::min(lo, data);
-        hi = std::max(hi, data);
-    }
-
-    for (int i = 0; i < total; i++) {
-        float data = _image[i];
-        lo = std::min(lo, data);
-        hi = std::max(hi, data);
-    }
+    ImagePipeline().autolevel().apply(_image);
+}
 
-    if (hi == lo) {
+void flip(Image& _image) {
+    if (_image.getType() != IMAGE_FLOAT32 || _image.getLayout() != LAYOUT_LINEAR) {
+        int width = _image.getWidth();
+        int height = _image.getHeight();
+        for (int y = 0; y < height / 2; y++)
+            for (int x = 0; x < width; x++) {
+                size_t a = _image.getIndex(x, y);
+                size_t b = _image.getIndex(x, height - 1 - y);
+                glm::vec4 tmp = _image.getColor(a);
+                _image.setColor(a, _image.getColor(b));
+                _image.setColor(b, tmp);
+            }
         return;
     }
 
-    for (int i = 0; i < total; i++)
-        _image[i] =  (_image[i] - lo) / (hi - lo);
-}
-
-void flip(Image& _image) {
     const size_t stride = _image.getWidth() * _image.getChannels();
     float *row = (float*)malloc(stride * sizeof(float));
     float *low = &_image[0];
@@ -90,15 +77,11 @@ void flip(Image& _image) {
 }
 
 void remap(Image& _image, float _in_min, float _int_max, float _out_min, float _out_max, bool _clamp) {
-    int total = _image.getWidth() * _image.getHeight() * _image.getChannels();
-    for (int i = 0; i < total; i++)
-        _image[i] = remap(_image[i], _in_min, _int_max, _out_min, _out_max, _clamp);
+    ImagePipeline().remap(_in_min, _int_max, _out_min, _out_max, _clamp).apply(_image);
 } 
 
 void threshold(Image& _image, float _threshold) {
-    int total = _image.getWidth() * _image.getHeight() * _image.getChannels();
-    for (int i = 0; i < total; i++)
-        _image[i] = (_image[i] >= _threshold)? 1.0f : 0.0f;
+    ImagePipeline().threshold(_threshold).apply(_image);
 }
 
 Image mergeChannels(const Image& _red, const Image& _green, const Image& _blue) {
@@ -219,10 +202,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
 */
 
 /* dt of 1d function using squared distance */
-static float *dt(float *f, int n) {
-    float *d = new float[n];
-    int *v = new int[n];
-    float *z = new float[n+1];
+static void dt(const float *f, float *d, int n, int *v, float *z) {
     int k = 0;
     v[0] = 0;
     z[0] = -INF;
@@ -245,120 +225,230 @@ static float *dt(float *f, int n) {
         k++;
         d[q] = square(q-v[k]) + f[v[k]];
     }
-
-    delete [] v;
-    delete [] z;
-    return d;
 }
 
-/* dt of 2d function using squared distance */
-void sdf(Image& _image) {
-    if (_image.getChannels() > 1) {
-        std::cout << "We need a one channel image to compute an SDF" << std::endl;
-        return;
-    }
+// Squared euclidean distance transform of every field (width x height floats, 0 on the
+// seeds and INF elsewhere) at once. Columns are done in blocks that are read and written
+// a row segment at a time (transposed on a scratch buffer) so memory is walked in order.
+static void edt(std::vector<float*>& _fields, int _width, int _height, size_t _threads) {
+    const int BLOCK = 16;
 
-    int width = _image.getWidth();
-    int height = _image.getHeight();
-    float *f = new float[std::max(width, height)];
+    if (_threads == 0)
+        _threads = getThreadsTotal();
+
+    struct Scratch {
+        std::vector<float>  cols;
+        std::vector<float>  d;
+        std::vector<int>    v;
+        std::vector<float>  z;
+    };
+    int n = std::max(_width, _height);
+    std::vector<Scratch> scratch(_threads);
+    for (size_t t = 0; t < _threads; t++) {
+        scratch[t].cols.resize(size_t(BLOCK) * _height);
+        scratch[t].d.resize(n);
+        scratch[t].v.resize(n);
+        scratch[t].z.resize(n + 1);
+    }
 
     // transform along columns
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++)
-            f[y] = _image[y * width + x];
-        
-        float *d = dt(f, height);
-        for (int y = 0; y < height; y++) 
-            _image[y * width + x] = d[y];
+    int blocks = (_width + BLOCK - 1) / BLOCK;
+    parallelFor(blocks, [&](size_t _block, size_t _thread) {
+        Scratch& s = scratch[_thread];
+        int x0 = _block * BLOCK;
+        int bw = std::min(BLOCK, _width - x0);
+
+        for (size_t i = 0; i < _fields.size(); i++) {
+            float* field = _fields[i];
+
+            for (int y = 0; y < _height; y++)
+                for (int c = 0; c < bw; c++)
+                    s.cols[c * _height + y] = field[size_t(y) * _width + x0 + c];
+
+            for (int c = 0; c < bw; c++) {
+                float* col = &s.cols[c * _height];
+                dt(col, &s.d[0], _height, &s.v[0], &s.z[0]);
+                std::memcpy(col, &s.d[0], _height * sizeof(float));
+            }
 
-        delete [] d;
-    }
+            for (int y = 0; y < _height; y++)
+                for (int c = 0; c < bw; c++)
+                    field[size_t(y) * _width + x0 + c] = s.cols[c * _height + y];
+        }
+    }, _threads);
 
     // transform along rows
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++)
-            f[x] = _image[y * width + x];
-        
-        float *d = dt(f, width);
-        for (int x = 0; x < width; x++)
-            _image[y * width + x] = d[x];
-            
-        delete [] d;
+    parallelFor(_height, [&](size_t _y, size_t _thread) {
+        Scratch& s = scratch[_thread];
+        for (size_t i = 0; i < _fields.size(); i++) {
+            float* row = _fields[i] + _y * _width;
+            dt(row, &s.d[0], _width, &s.v[0], &s.z[0]);
+            std::memcpy(row, &s.d[0], _width * sizeof(float));
+        }
+    }, _threads);
+}
+
+void sdf(Image& _image, bool _autolevel, size_t _threads) {
+    if (_image.getChannels() > 1) {
+        std::cout << "We need a one channel image to compute an SDF" << std::endl;
+        return;
     }
 
-    sqrt(_image);
-    autolevel(_image);
+    // distances need floats and rows
+    _image.convert(IMAGE_FLOAT32, LAYOUT_LINEAR);
 
-    delete f;
+    std::vector<float*> fields;
+    fields.push_back( &_image[0] );
+    edt(fields, _image.getWidth(), _image.getHeight(), _threads);
+
+    sqrt(_image);
+    if (_autolevel)
+        autolevel(_image);
 }
 
 
 /* dt of binary image using squared distance */
-Image toSdf(const Image& _image, float _on) {
+Image toSdf(const Image& _image, float _on, bool _signed, bool _autolevel, size_t _threads) {
     int width = _image.getWidth();
     int height = _image.getHeight();
     Image out = Image(width, height, 1);
 
+    // distance to the closest _on pixel and, for the signed one, to the closest one that isn't
+    std::vector<float> inside;
+    if (_signed)
+        inside.resize(size_t(width) * height);
+
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
-            if ( _image.getValue( _image.getIndex(x, y) ) == _on)
-	            out.setValue( out.getIndex(x, y), 0.0f);
-            else
-                out.setValue( out.getIndex(x, y), INF);
+            bool on = _image.getValue( _image.getIndex(x, y) ) == _on;
+            out.setValue( out.getIndex(x, y), on ? 0.0f : INF);
+            if (_signed)
+                inside[size_t(y) * width + x] = on ? INF : 0.0f;
         }
     }
 
-    sdf(out);
+    if (!_signed) {
+        sdf(out, _autolevel, _threads);
+        return out;
+    }
+
+    std::vector<float*> fields;
+    fields.push_back( &out[0] );
+    fields.push_back( &inside[0] );
+    edt(fields, width, height, _threads);
+
+    // negative inside the _on regions
+    parallelFor(height, [&](size_t _y, size_t /*_thread*/) {
+        for (int x = 0; x < width; x++) {
+            size_t i = _y * width + x;
+            out[i] = std::sqrt(out[i]) - std::sqrt(inside[i]);
+        }
+    }, _threads);
+
+    if (_autolevel)
+        autolevel(out);
+
     return out;
 }
 
-Image toNormalmap(const Image& _heightmap, float _zScale) {
-    const int w = _heightmap.getWidth() - 1;
-    const int h = _heightmap.getHeight() - 1;
-    std::vector<glm::vec3> result(w * h);
-    int i = 0;
-    for (int y0 = 0; y0 < h; y0++) {
-        const int y1 = y0 + 1;
-        const float yc = y0 + 0.5f;
-        for (int x0 = 0; x0 < w; x0++) {
-            const int x1 = x0 + 1;
-            const float xc = x0 + 0.5f;
-            const float z00 = _heightmap.getValue( _heightmap.getIndex(x0, y0) ) * -_zScale;
-            const float z01 = _heightmap.getValue( _heightmap.getIndex(x0, y1) ) * -_zScale;
-            const float z10 = _heightmap.getValue( _heightmap.getIndex(x1, y0) ) * -_zScale;
-            const float z11 = _heightmap.getValue( _heightmap.getIndex(x1, y1) ) * -_zScale;
-            const float zc = (z00 + z01 + z10 + z11) / 4.f;
-            const glm::vec3 p00(x0, y0, z00);
-            const glm::vec3 p01(x0, y1, z01);
-            const glm::vec3 p10(x1, y0, z10);
-            const glm::vec3 p11(x1, y1, z11);
-            const glm::vec3 pc(xc, yc, zc);
-            const glm::vec3 n0 = glm::triangleNormal(pc, p00, p10);
-            const glm::vec3 n1 = glm::triangleNormal(pc, p10, p11);
-            const glm::vec3 n2 = glm::triangleNormal(pc, p11, p01);
-            const glm::vec3 n3 = glm::triangleNormal(pc, p01, p00);
-            result[i] = glm::normalize(n0 + n1 + n2 + n3) * 0.5f + 0.5f;
-            i++;
+Image toNormalmap(const Image& _heightmap, float _zScale, NormalmapKernel _kernel, size_t _threads) {
+    return toNormalmap(_heightmap, 0, 0, _heightmap.getWidth(), _heightmap.getHeight(), _zScale, _kernel, _threads);
+}
+
+Image toNormalmap(  const Image& _heightmap, int _x, int _y, int _width, int _height,
+                    float _zScale, NormalmapKernel _kernel, size_t _threads) {
+
+    const int w = _heightmap.getWidth();
+    const int h = _heightmap.getHeight();
+    _x = std::max(_x, 0);
+    _y = std::max(_y, 0);
+    _width = std::min(_width, w - _x);
+    _height = std::min(_height, h - _y);
+    if (_width <= 0 || _height <= 0)
+        return Image();
+
+    Image out = Image(_width, _height, 3);
+
+    // one channel linear floats are read in place, anything else row by row
+    const bool direct = _heightmap.getType() == IMAGE_FLOAT32 && _heightmap.getLayout() == LAYOUT_LINEAR && _heightmap.getChannels() == 1;
+
+    if (_threads == 0)
+        _threads = getThreadsTotal();
+
+    // per thread: three rows of the region, one pixel wider on each side (clamped to the edges)
+    const int span = _width + 2;
+    std::vector<float> scratch(_threads * 3 * span);
+
+    parallelFor(_height, [&](size_t _row, size_t _thread) {
+        const int y = _y + int(_row);
+        float* rows[3];
+        for (int r = 0; r < 3; r++) {
+            const int sy = std::min(std::max(y + r - 1, 0), h - 1);
+            float* dst = &scratch[ (_thread * 3 + r) * span ];
+            if (direct && _x > 0 && _x + _width < w)
+                std::memcpy(dst, &_heightmap[ _heightmap.getIndex(_x - 1, sy) ], span * sizeof(float));
+            else
+                for (int i = 0; i < span; i++) {
+                    const int sx = std::min(std::max(_x + i - 1, 0), w - 1);
+                    dst[i] = direct ? _heightmap[ _heightmap.getIndex(sx, sy) ] : _heightmap.getValue( _heightmap.getIndex(sx, sy) );
+                }
+            rows[r] = dst;
         }
-    }
 
-    Image out = Image(w, h, 3);
-    out.setColors(&result[0].r, result.size(), 3);
+        const float* t = rows[0];
+        const float* c = rows[1];
+        const float* b = rows[2];
+        float* dst = &out[ out.getIndex(0, int(_row)) ];
+
+        // slopes per pixel, both kernels average to the same scale
+        for (int x = 0; x < _width; x++) {
+            float dx, dy;
+            if (_kernel == NORMALMAP_SOBEL) {
+                dx = ((t[x + 2] + 2.0f * c[x + 2] + b[x + 2]) - (t[x] + 2.0f * c[x] + b[x])) * 0.125f;
+                dy = ((b[x] + 2.0f * b[x + 1] + b[x + 2]) - (t[x] + 2.0f * t[x + 1] + t[x + 2])) * 0.125f;
+            }
+            else {
+                dx = (c[x + 2] - c[x]) * 0.5f;
+                dy = (b[x + 1] - t[x + 1]) * 0.5f;
+            }
+
+            // flat ground encodes as (0.5, 0.5, 1.0)
+            const float nx = dx * _zScale;
+            const float ny = dy * _zScale;
+            const float l = 0.5f / std::sqrt(nx * nx + ny * ny + 1.0f);
+            dst[x * 3 + 0] = 0.5f + nx * l;
+            dst[x * 3 + 1] = 0.5f + ny * l;
+            dst[x * 3 + 2] = 0.5f + l;
+        }
+    }, _threads);
+
     return out;
 }
 
 Image toLuma(const Image& _image) {
     int width = _image.getWidth();
     int height = _image.getHeight();
+    int channels = _image.getChannels();
+    const glm::vec3 weights = glm::vec3(0.2126f, 0.7152f, 0.0722f);
 
     Image out = Image(width, height, 1);
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            glm::vec4 c = _image.getColor( _image.getIndex(x, y) );
-            float value = glm::dot(glm::vec3(c.x, c.y, c.z), glm::vec3(0.2126f, 0.7152f, 0.0722f));
-            out.setValue( out.getIndex(x, y), value);
+    bool raw = _image.getType() == IMAGE_FLOAT32 && _image.getLayout() == LAYOUT_LINEAR && channels >= 3;
+    parallelFor(height, [&](size_t _y, size_t /*_thread*/) {
+        int y = int(_y);
+        float* dst = &out[out.getIndex(0, y)];
+
+        // straight over the row when there is no conversion to do
+        if (raw) {
+            const float* src = &_image[_image.getIndex(0, y)];
+            for (int x = 0; x < width; x++, src += channels)
+                dst[x] = src[0] * weights.x + src[1] * weights.y + src[2] * weights.z;
         }
-    }
+        else
+            for (int x = 0; x < width; x++) {
+                glm::vec4 c = _image.getColor( _image.getIndex(x, y) );
+                dst[x] = glm::dot(glm::vec3(c.x, c.y, c.z), weights);
+            }
+    });
 
     return out;
 }
@@ -374,7 +464,18 @@ Image   denoise(const Image& _color, const Image& _normal, const Image& _albedo,
         return _color;
     }
 
-    Image out = Image(_color);
+    // OIDN reads linear floats
+    const auto asFloats = [](const Image& _image) {
+        Image linear = _image;
+        if (_image.getType() != IMAGE_FLOAT32 || _image.getLayout() != LAYOUT_LINEAR)
+            linear.convert(IMAGE_FLOAT32, LAYOUT_LINEAR);
+        return linear;
+    };
+    const Image color = asFloats(_color);
+    const Image albedo = asFloats(_albedo);
+    const Image normal = asFloats(_normal);
+
+    Image out = color;
 
     // Create an Intel Open Image Denoise device
     oidn::DeviceRef device = oidn::newDevice();
@@ -382,9 +483,9 @@ Image   denoise(const Image& _color, const Image& _normal, const Image& _albedo,
 
     // Create a denoising filter
     oidn::FilterRef filter = device.newFilter("RT"); // generic ray tracing filter
-    filter.setImage("color", (void*)&_color[0],  oidn::Format::Float3, _color.getWidth(), _color.getHeight());
-    filter.setImage("albedo", (void*)&_albedo[0], oidn::Format::Float3, _albedo.getWidth(), _albedo.getHeight()); // optional
-    filter.setImage("normal", (void*)&_normal[0], oidn::Format::Float3, _normal.getWidth(), _normal.getHeight()); // optional
+    filter.setImage("color", (void*)&color[0],  oidn::Format::Float3, color.getWidth(), color.getHeight());
+    filter.setImage("albedo", (void*)&albedo[0], oidn::Format::Float3, albedo.getWidth(), albedo.getHeight()); // optional
+    filter.setImage("normal", (void*)&normal[0], oidn::Format::Float3, normal.getWidth(), normal.getHeight()); // optional
     filter.setImage("output", (void*)&out[0], oidn::Format::Float3, out.getWidth(), out.getHeight());
     filter.set("hdr", _hdr); // image is HDR
     filter.commit();
@@ -424,9 +525,16 @@ Image toHueRainbow(const Image& _in) {
     int width = _in.getWidth();
     int height = _in.getHeight();
     Image out = Image(width, height, 3);
-    for (int y = 0; y < height; y++)
-        for(int x = 0; x < width; x++)
-            out.setColor( out.getIndex(x,y), hue2rgb( _in.getValue(_in.getIndex(x,y)) ) );
+    parallelFor(height, [&](size_t _y, size_t /*_thread*/) {
+        int y = int(_y);
+        float* dst = &out[out.getIndex(0, y)];
+        for (int x = 0; x < width; x++, dst += 3) {
+            glm::vec3 c = hue2rgb( _in.getValue(_in.getIndex(x, y)) );
+            dst[0] = c.r;
+            dst[1] = c.g;
+            dst[2] = c.b;
+        }
+    });
 
     return out;
 }
@@ -438,7 +546,11 @@ Image toHueRainbow(const Image& _in) {
 //  it significantly uglier using lambdas for my own conviniance
 //
 
-std::pair<glm::ivec2, float> FindCandidate( const Image& _image, const glm::ivec2 p0, const glm::ivec2 p1, const glm::ivec2 p2) { 
+// Heights are read straight from a float buffer (_stride floats per row) in the local
+// coordinates of the region being triangulated. When _locked the border pixels (x == 0,
+// y == 0 or on _max) are never candidates, they get refined along their edges instead
+static std::pair<glm::ivec2, float> FindCandidate( const float* _heights, int _stride, const glm::ivec2& _max, bool _locked,
+                                                   const glm::ivec2 p0, const glm::ivec2 p1, const glm::ivec2 p2) { 
     
     const auto edge = []( const glm::ivec2 a, const glm::ivec2 b, const glm::ivec2 c) {
         return (b.x - c.x) * (a.y - c.y) - (b.y - c.y) * (a.x - c.x);
@@ -461,14 +573,17 @@ std::pair<glm::ivec2, float> FindCandidate( const Image& _image, const glm::ivec
 
     // pre-multiplied z values at vertices
     const float a = edge(p0, p1, p2);
-    const float z0 = _image.getValue( _image.getIndex(p0.x, p0.y) ) / a;
-    const float z1 = _image.getValue( _image.getIndex(p1.x, p1.y) ) / a;
-    const float z2 = _image.getValue( _image.getIndex(p2.x, p2.y) ) / a;
+    const float z0 = _heights[ size_t(p0.y) * _stride + p0.x ] / a;
+    const float z1 = _heights[ size_t(p1.y) * _stride + p1.x ] / a;
+    const float z2 = _heights[ size_t(p2.y) * _stride + p2.x ] / a;
 
     // iterate over pixels in bounding box
     float maxError = 0;
     glm::ivec2 maxPoint(0);
     for (int y = min.y; y <= max.y; y++) {
+        const float* row = _heights + size_t(y) * _stride;
+        const bool border = _locked && (y == 0 || y == _max.y);
+
         // compute starting offset
         int dx = 0;
         if (w00 < 0 && a12 != 0)
@@ -491,8 +606,8 @@ std::pair<glm::ivec2, float> FindCandidate( const Image& _image, const glm::ivec
 
                 // compute z using barycentric coordinates
                 const float z = z0 * w0 + z1 * w1 + z2 * w2;
-                const float dz = std::abs(z - _image.getValue( _image.getIndex(x, y) ) );
-                if (dz > maxError) {
+                const float dz = std::abs(z - row[x]);
+                if (dz > maxError && !(border || (_locked && (x == 0 || x == _max.x))) ) {
                     maxError = dz;
                     maxPoint = glm::ivec2(x, y);
                 }
@@ -528,6 +643,18 @@ struct TriangulatorData {
     std::vector<int>        queue;
     std::vector<int>        pending;
 
+    // region being triangulated (see FindCandidate), sample p of the region is the
+    // pixel ToPixel(p) of the heightmap
+    const float*            heights;
+    int                     stride;
+    glm::ivec2              max;
+    bool                    locked;
+    glm::ivec2              offset;
+    glm::ivec2              limit;
+    int                     step;
+
+    glm::ivec2 ToPixel(const glm::ivec2& _p) const { return glm::min(offset + _p * step, limit); }
+
     void QueueSwap(const int i, const int j) {
         const int pi = queue[i];
         const int pj = queue[j];
@@ -670,11 +797,11 @@ struct TriangulatorData {
         return i;
     }
 
-    void Flush( const Image& _image) {
+    void Flush() {
         for (const int t : pending) {
 
             // rasterize triangle to find maximum pixel error
-            const auto pair = FindCandidate(_image,
+            const auto pair = FindCandidate(heights, stride, max, locked,
                                             points[ triangles[t*3+0] ],
                                             points[ triangles[t*3+1] ],
                                             points[ triangles[t*3+2] ]);
@@ -758,347 +885,714 @@ struct TriangulatorData {
         Legalize(t0 + 1);
         Legalize(t1 + 2);
     }
-};
 
+    // two triangles covering the region, from (0,0) to max
+    void Init() {
+        const int p0 = AddPoint(glm::ivec2(0, 0));
+        const int p1 = AddPoint(glm::ivec2(max.x, 0));
+        const int p2 = AddPoint(glm::ivec2(0, max.y));
+        const int p3 = AddPoint(max);
 
-Mesh toTerrain( const Image& _image,
-                const float _zScale,
-                const float _maxError, const float _baseHeight, 
-                const int _maxTriangles, const int _maxPoints) {
+        const int t0 = AddTriangle(p3, p0, p2, -1, -1, -1, -1);
+        AddTriangle(p0, p3, p1, t0, -1, -1, -1);
+        Flush();
+    }
 
-    if (_image.getChannels() != 1)
-        return Mesh();
+    // splits the triangles at both sides of halfedge a, where pn lays
+    void HandleCollinear(const int pn, const int a) {
+        const int a0 = a - a % 3;
+        const int al = a0 + (a + 1) % 3;
+        const int ar = a0 + (a + 2) % 3;
+        const int p0 = triangles[ar];
+        const int pr = triangles[a];
+        const int pl = triangles[al];
+        const int hal = halfedges[al];
+        const int har = halfedges[ar];
 
-    TriangulatorData data;
+        const int b = halfedges[a];
 
-    // add points at all four corners
-    const int x0 = 0;
-    const int y0 = 0;
-    const int x1 = _image.getWidth() - 1;
-    const int y1 = _image.getHeight() - 1;
-    const int p0 = data.AddPoint(glm::ivec2(x0, y0));
-    const int p1 = data.AddPoint(glm::ivec2(x1, y0));
-    const int p2 = data.AddPoint(glm::ivec2(x0, y1));
-    const int p3 = data.AddPoint(glm::ivec2(x1, y1));
-
-    // add initial two triangles
-    const int t0 = data.AddTriangle(p3, p0, p2, -1, -1, -1, -1);
-    data.AddTriangle(p0, p3, p1, t0, -1, -1, -1);
-    data.Flush(_image);
-
-    // helper function to check if triangulation is complete
-    const auto done = [&]() {
-        const float e = data.errors[data.queue[0]];
-        if (e <= _maxError) {
-            return true;
-        }
-        if (_maxTriangles > 0 && data.queue.size() >= _maxTriangles) {
-            return true;
-        }
-        if (_maxPoints > 0 && data.points.size() >= _maxPoints) {
-            return true;
+        if (b < 0) {
+            const int t0 = AddTriangle(pn, p0, pr, -1, har, -1, a0);
+            const int t1 = AddTriangle(p0, pn, pl, t0, -1, hal, -1);
+            Legalize(t0 + 1);
+            Legalize(t1 + 2);
+            return;
         }
-        return e == 0;
-    };
 
-    while (!done()) {
-        // pop triangle with highest error from priority queue
-        const int t = data.QueuePop();
+        const int b0 = b - b % 3;
+        const int bl = b0 + (b + 2) % 3;
+        const int br = b0 + (b + 1) % 3;
+        const int p1 = triangles[bl];
+        const int hbl = halfedges[bl];
+        const int hbr = halfedges[br];
+
+        QueueRemove(b / 3);
+
+        const int t0 = AddTriangle(p0, pr, pn, har, -1, -1, a0);
+        const int t1 = AddTriangle(pr, p1, pn, hbr, -1, t0 + 1, b0);
+        const int t2 = AddTriangle(p1, pl, pn, hbl, -1, t1 + 1, -1);
+        const int t3 = AddTriangle(pl, p0, pn, hal, t0 + 2, t2 + 1, -1);
+
+        Legalize(t0);
+        Legalize(t1);
+        Legalize(t2);
+        Legalize(t3);
+    }
+
+    // pop triangle with highest error from priority queue and split it at its candidate
+    void Step() {
+        const int t = QueuePop();
 
         const int e0 = t * 3 + 0;
         const int e1 = t * 3 + 1;
         const int e2 = t * 3 + 2;
 
-        const int p0 = data.triangles[e0];
-        const int p1 = data.triangles[e1];
-        const int p2 = data.triangles[e2];
+        const int p0 = triangles[e0];
+        const int p1 = triangles[e1];
+        const int p2 = triangles[e2];
 
-        const glm::ivec2 a = data.points[p0];
-        const glm::ivec2 b = data.points[p1];
-        const glm::ivec2 c = data.points[p2];
-        const glm::ivec2 p = data.candidates[t];
+        const glm::ivec2 a = points[p0];
+        const glm::ivec2 b = points[p1];
+        const glm::ivec2 c = points[p2];
+        const glm::ivec2 p = candidates[t];
 
-        const int pn = data.AddPoint(p);
+        const int pn = AddPoint(p);
 
-        const auto collinear = []( const glm::ivec2 p0, const glm::ivec2 p1, const glm::ivec2 p2) {
-            return (p1.y-p0.y)*(p2.x-p1.x) == (p2.y-p1.y)*(p1.x-p0.x);
-        };
+        if (Collinear(a, b, p))
+            HandleCollinear(pn, e0);
+        else if (Collinear(b, c, p))
+            HandleCollinear(pn, e1);
+        else if (Collinear(c, a, p))
+            HandleCollinear(pn, e2);
+        else {
+            const int h0 = halfedges[e0];
+            const int h1 = halfedges[e1];
+            const int h2 = halfedges[e2];
 
-        const auto handleCollinear = [&](const int pn, const int a) {
-            const int a0 = a - a % 3;
-            const int al = a0 + (a + 1) % 3;
-            const int ar = a0 + (a + 2) % 3;
-            const int p0 = data.triangles[ar];
-            const int pr = data.triangles[a];
-            const int pl = data.triangles[al];
-            const int hal = data.halfedges[al];
-            const int har = data.halfedges[ar];
-
-            const int b = data.halfedges[a];
-
-            if (b < 0) {
-                const int t0 = data.AddTriangle(pn, p0, pr, -1, har, -1, a0);
-                const int t1 = data.AddTriangle(p0, pn, pl, t0, -1, hal, -1);
-                data.Legalize(t0 + 1);
-                data.Legalize(t1 + 2);
-                return;
-            }
+            const int t0 = AddTriangle(p0, p1, pn, h0, -1, -1, e0);
+            const int t1 = AddTriangle(p1, p2, pn, h1, -1, t0 + 1, -1);
+            const int t2 = AddTriangle(p2, p0, pn, h2, t0 + 2, t1 + 1, -1);
 
-            const int b0 = b - b % 3;
-            const int bl = b0 + (b + 2) % 3;
-            const int br = b0 + (b + 1) % 3;
-            const int p1 = data.triangles[bl];
-            const int hbl = data.halfedges[bl];
-            const int hbr = data.halfedges[br];
+            Legalize(t0);
+            Legalize(t1);
+            Legalize(t2);
+        }
 
-            data.QueueRemove(b / 3);
+        Flush();
+    }
 
-            const int t0 = data.AddTriangle(p0, pr, pn, har, -1, -1, a0);
-            const int t1 = data.AddTriangle(pr, p1, pn, hbr, -1, t0 + 1, b0);
-            const int t2 = data.AddTriangle(p1, pl, pn, hbl, -1, t1 + 1, -1);
-            const int t3 = data.AddTriangle(pl, p0, pn, hal, t0 + 2, t2 + 1, -1);
+    // adds a point on the outer edge of the triangulation (ex. a locked border vertex)
+    bool InsertOnBorder(const glm::ivec2& _point) {
+        for (int e = 0; e < int(halfedges.size()); e++) {
+            if (halfedges[e] >= 0)
+                continue;
+
+            const glm::ivec2 a = points[ triangles[e] ];
+            const glm::ivec2 b = points[ triangles[e - e % 3 + (e + 1) % 3] ];
+            if (!Collinear(a, b, _point) || _point == a || _point == b ||
+                _point.x < std::min(a.x, b.x) || _point.x > std::max(a.x, b.x) ||
+                _point.y < std::min(a.y, b.y) || _point.y > std::max(a.y, b.y))
+                continue;
+
+            QueueRemove(e / 3);
+            HandleCollinear(AddPoint(_point), e);
+            return true;
+        }
+        return false;
+    }
 
-            data.Legalize(t0);
-            data.Legalize(t1);
-            data.Legalize(t2);
-            data.Legalize(t3);
+    void Refine(const float _maxError, const int _maxTriangles, const int _maxPoints) {
+        const auto done = [&]() {
+            const float e = errors[queue[0]];
+            if (e <= _maxError) {
+                return true;
+            }
+            if (_maxTriangles > 0 && queue.size() >= _maxTriangles) {
+                return true;
+            }
+            if (_maxPoints > 0 && points.size() >= _maxPoints) {
+                return true;
+            }
+            return e == 0;
         };
 
-        if (collinear(a, b, p))
-            handleCollinear(pn, e0);
-        else if (collinear(b, c, p))
-            handleCollinear(pn, e1);
-        else if (collinear(c, a, p))
-            handleCollinear(pn, e2);
-        else {
-            const int h0 = data.halfedges[e0];
-            const int h1 = data.halfedges[e1];
-            const int h2 = data.halfedges[e2];
+        while (!done())
+            Step();
+    }
 
-            const int t0 = data.AddTriangle(p0, p1, pn, h0, -1, -1, e0);
-            const int t1 = data.AddTriangle(p1, p2, pn, h1, -1, t0 + 1, -1);
-            const int t2 = data.AddTriangle(p2, p0, pn, h2, t0 + 2, t1 + 1, -1);
+    static bool Collinear( const glm::ivec2 p0, const glm::ivec2 p1, const glm::ivec2 p2) {
+        return (p1.y-p0.y)*(p2.x-p1.x) == (p2.y-p1.y)*(p1.x-p0.x);
+    }
+};
 
-            data.Legalize(t0);
-            data.Legalize(t1);
-            data.Legalize(t2);
-        }
 
-        data.Flush(_image);
+// Heights of the region as rows of floats. Points straight into the image when it is already
+// single channel linear floats at full resolution, otherwise the samples are copied once to
+// _buffer so the rasterization doesn't convert pixel by pixel
+static void setHeights( TriangulatorData& _data, const Image& _image, const glm::ivec2& _offset, const int _step,
+                        const glm::ivec2& _max, std::vector<float>& _buffer) {
+    _data.offset = _offset;
+    _data.step = _step;
+    _data.limit = glm::ivec2(_image.getWidth() - 1, _image.getHeight() - 1);
+    _data.max = _max;
+
+    if (_step == 1 && _image.getType() == IMAGE_FLOAT32 && _image.getLayout() == LAYOUT_LINEAR) {
+        _data.heights = &_image[ _image.getIndex(_offset.x, _offset.y) ];
+        _data.stride = _image.getWidth();
+        return;
     }
 
-    std::vector<glm::vec2> texcoords;
-    std::vector<glm::vec3> points;
-    points.reserve(data.points.size());
-    texcoords.reserve(data.points.size());
-    const int w = _image.getWidth();
-    const int h = _image.getHeight();
-    const int w1 = w - 1;
-    const int h1 = h - 1;
-
-    for (const glm::ivec2 &p : data.points) {
-        points.emplace_back(p.x, h1 - p.y, _image.getValue( _image.getIndex(p.x, p.y) ) * _zScale);
-        texcoords.emplace_back(p.x/float(w1), 1.0f-p.y/float(h1));
+    _data.stride = _max.x + 1;
+    _buffer.resize( size_t(_max.x + 1) * (_max.y + 1) );
+    for (int y = 0; y <= _max.y; y++)
+        for (int x = 0; x <= _max.x; x++) {
+            const glm::ivec2 pixel = _data.ToPixel( glm::ivec2(x, y) );
+            _buffer[ size_t(y) * _data.stride + x ] = _image.getValue( _image.getIndex(pixel.x, pixel.y) );
+        }
+    _data.heights = &_buffer[0];
+}
+
+// Writes the triangulation into _mesh in one pass over a reserved mesh: positions, texcoords
+// (over the whole heightmap or just the region), normals from the heightmap gradient and walls
+// along the outer edges. The walls go down to a flat base at -_baseHeight, or else hang
+// _skirtHeight under each border vertex.
+static void toMesh( const TriangulatorData& _data, const Image& _image,
+                    const float _zScale, const float _baseHeight, const float _skirtHeight,
+                    const bool _normals, const bool _localTexcoords, Mesh& _mesh ) {
+
+    const int w1 = _data.limit.x;
+    const int h1 = _data.limit.y;
+    const bool walls = _baseHeight > 0.0f || _skirtHeight > 0.0f;
+
+    // count the outer edges to know how much room the walls take
+    size_t borders = 0;
+    if (walls)
+        for (const int t : _data.queue)
+            for (int e = t * 3; e < t * 3 + 3; e++)
+                if (_data.halfedges[e] < 0)
+                    borders++;
+
+    const size_t base = (_baseHeight > 0.0f)? 1 : 0;
+    _mesh.reserve(  _data.points.size() + borders + base,
+                    (_data.queue.size() + borders * 2 + borders * base) * 3,
+                    _normals, true );
+
+    const auto height = [&](int _x, int _y) {
+        return _image.getValue( _image.getIndex(_x, _y) );
+    };
+
+    const auto texcoord = [&](const glm::ivec2& _p) {
+        if (_localTexcoords)
+            return glm::vec2(_p.x/float(_data.max.x), 1.0f - _p.y/float(_data.max.y));
+        const glm::ivec2 pixel = _data.ToPixel(_p);
+        return glm::vec2(pixel.x/float(w1), 1.0f - pixel.y/float(h1));
+    };
+
+    for (const glm::ivec2 &p : _data.points) {
+        const glm::ivec2 pixel = _data.ToPixel(p);
+        const int x = pixel.x;
+        const int y = pixel.y;
+        _mesh.addVertex( glm::vec3(x, h1 - y, _data.heights[ size_t(p.y) * _data.stride + p.x ] * _zScale) );
+        _mesh.addTexCoord( texcoord(p) );
+
+        if (_normals) {
+            // central differences on the whole heightmap, so tiles match at their borders
+            const int x0 = std::max(x - _data.step, 0), x1 = std::min(x + _data.step, w1);
+            const int y0 = std::max(y - _data.step, 0), y1 = std::min(y + _data.step, h1);
+            const float dx = (height(x1, y) - height(x0, y)) * _zScale / float(std::max(x1 - x0, 1));
+            const float dy = (height(x, y1) - height(x, y0)) * _zScale / float(std::max(y1 - y0, 1));
+            _mesh.addNormal( glm::normalize(glm::vec3(-dx, dy, 1.0f)) );
+        }
     }
 
-    std::vector<glm::ivec3> triangles;
-    triangles.reserve(data.queue.size());
-    for (const int i : data.queue) {
-        triangles.emplace_back(
-            data.triangles[i * 3 + 0],
-            data.triangles[i * 3 + 1],
-            data.triangles[i * 3 + 2] );
+    for (const int i : _data.queue)
+        _mesh.addTriangleIndices( _data.triangles[i * 3 + 0], _data.triangles[i * 3 + 1], _data.triangles[i * 3 + 2] );
+
+    if (!walls)
+        return;
+
+    // one vertex under each border vertex, sharing its texcoord and normal
+    std::vector<int> under(_data.points.size(), -1);
+    const auto bottom = [&](const int _p) {
+        if (under[_p] < 0) {
+            const glm::ivec2& p = _data.points[_p];
+            const glm::vec3& top = _mesh.getVertex(_p);
+            under[_p] = int(_mesh.getVerticesTotal());
+            _mesh.addVertex( glm::vec3(top.x, top.y, (_baseHeight > 0.0f)? -_baseHeight : top.z - _skirtHeight) );
+            _mesh.addTexCoord( texcoord(p) );
+            if (_normals)
+                _mesh.addNormal( _mesh.getNormal(_p) );
+        }
+        return under[_p];
+    };
+
+    int center = -1;
+    if (base) {
+        center = int(_mesh.getVerticesTotal());
+        const glm::vec2 c = glm::vec2(_data.offset) + glm::vec2(_data.ToPixel(_data.max) - _data.offset + 1) * 0.5f;
+        _mesh.addVertex( glm::vec3(c.x, h1 + 1 - c.y, -_baseHeight) );
+        _mesh.addTexCoord( _localTexcoords ? glm::vec2(0.5f) : glm::vec2(c.x/float(w1), (h1 + 1 - c.y)/float(h1)) );
+        if (_normals)
+            _mesh.addNormal( glm::vec3(0.0f, 0.0f, -1.0f) );
     }
 
-    // BASE
-    //
-    
-    if ( _baseHeight > 0.0f ) {
+    // walking the outer halfedges backwards keeps the winding of the surface
+    for (const int t : _data.queue)
+        for (int e = t * 3; e < t * 3 + 3; e++) {
+            if (_data.halfedges[e] >= 0)
+                continue;
+
+            const int a = _data.triangles[e];
+            const int b = _data.triangles[t * 3 + (e + 1) % 3];
+            const int ua = bottom(a);
+            const int ub = bottom(b);
+            _mesh.addTriangleIndices(b, a, ua);
+            _mesh.addTriangleIndices(b, ua, ub);
+            if (center >= 0)
+                _mesh.addTriangleIndices(center, ub, ua);
+        }
+}
 
-        const float z = -_baseHeight;// * _zScale;
-        
-        std::map<int, float> x0s;
-        std::map<int, float> x1s;
-        std::map<int, float> y0s;
-        std::map<int, float> y1s;
-        std::unordered_map<glm::vec3, int> lookup;
-
-        // find points along each edge
-        for (int i = 0; i < points.size(); i++) {
-            const auto &p = points[i];
-            bool edge = false;
-
-            if (p.x == 0) {
-                x0s[p.y] = p.z;
-                edge = true;
-            }
-            else if (p.x == w1) {
-                x1s[p.y] = p.z;
-                edge = true;
-            }
+Mesh toTerrain( const Image& _image,
+                const float _zScale,
+                const float _maxError, const float _baseHeight, 
+                const int _maxTriangles, const int _maxPoints,
+                const float _skirtHeight, const bool _normals) {
 
-            if (p.y == 0) {
-                y0s[p.x] = p.z;
-                edge = true;
-            }
-            else if (p.y == h1) {
-                y1s[p.x] = p.z;
-                edge = true;
+    if (_image.getChannels() != 1)
+        return Mesh();
+
+    TriangulatorData data;
+    std::vector<float> buffer;
+    data.locked = false;
+    setHeights(data, _image, glm::ivec2(0), 1, glm::ivec2(_image.getWidth() - 1, _image.getHeight() - 1), buffer);
+
+    // add points at all four corners and the two initial triangles
+    data.Init();
+    data.Refine(_maxError, _maxTriangles, _maxPoints);
+
+    Mesh mesh;
+    toMesh(data, _image, _zScale, _baseHeight, _skirtHeight, _normals, false, mesh);
+    return mesh;
+}
+
+// Greedy 1D version of the refinement for a border shared by two tiles. For each error
+// level (coarse to fine) keeps adding the sample furthest from the current polyline until
+// it is within the error, so every level holds the points of the previous ones. Returns
+// the position of the points on the border and the level they first appear on.
+static std::vector<glm::ivec2> refineBorder(const std::vector<float>& _profile, const std::vector<float>& _maxErrors) {
+    struct Span {
+        float error;
+        int a, b, at;
+        bool operator< (const Span& _other) const { return error < _other.error; }
+    };
+
+    const auto measure = [&_profile](int _a, int _b) {
+        Span span = { 0.0f, _a, _b, _a };
+        const float za = _profile[_a];
+        const float dz = (_profile[_b] - za) / float(_b - _a);
+        for (int i = _a + 1; i < _b; i++) {
+            const float error = std::abs(za + dz * (i - _a) - _profile[i]);
+            if (error > span.error) {
+                span.error = error;
+                span.at = i;
             }
+        }
+        return span;
+    };
 
-            if (edge)
-                lookup[p] = i;
+    std::vector<glm::ivec2> out;
+    std::priority_queue<Span> spans;
+    spans.push( measure(0, int(_profile.size()) - 1) );
+
+    for (size_t level = 0; level < _maxErrors.size(); level++) {
+        while (!spans.empty() && spans.top().error > _maxErrors[level]) {
+            const Span span = spans.top();
+            spans.pop();
+            out.push_back( glm::ivec2(span.at, level) );
+            spans.push( measure(span.a, span.at) );
+            spans.push( measure(span.at, span.b) );
         }
+    }
 
-        std::vector<std::pair<int, float>> sx0s(x0s.begin(), x0s.end());
-        std::vector<std::pair<int, float>> sx1s(x1s.begin(), x1s.end());
-        std::vector<std::pair<int, float>> sy0s(y0s.begin(), y0s.end());
-        std::vector<std::pair<int, float>> sy1s(y1s.begin(), y1s.end());
+    return out;
+}
 
-        const auto pointIndex = [&lookup, &points, &texcoords, &w1, &h1](
-            const float x, const float y, const float z)
-        {
-            const glm::vec3 point(x, y, z);
-            if (lookup.find(point) == lookup.end()) {
-                lookup[point] = points.size();
-                points.push_back(point);
-                texcoords.push_back( glm::vec2(x/float(w1), y/float(h1)) );
+// Grid of tiles _tileSize samples wide, with samples _step pixels apart. Neighbor tiles share
+// the samples on their borders, and the points of every border are decided once (refined as
+// a 1D profile) so the tiles at both sides get exactly the same vertices and the seams close
+struct TerrainGrid {
+    int         tileSize;
+    int         step;
+    int         tilesX;
+    int         tilesY;
+    glm::ivec2  limit;
+
+    std::vector< std::vector<glm::ivec2> > rows;    // horizontal borders, (tilesY + 1) * tilesX
+    std::vector< std::vector<glm::ivec2> > columns; // vertical borders, tilesY * (tilesX + 1)
+
+    TerrainGrid(const Image& _image, const int _tileSize, const int _step, const std::vector<float>& _maxErrors, size_t _threads) {
+        tileSize = _tileSize;
+        step = _step;
+        limit = glm::ivec2(_image.getWidth() - 1, _image.getHeight() - 1);
+        tilesX = std::max(1, (limit.x + tileSize * step - 1) / (tileSize * step));
+        tilesY = std::max(1, (limit.y + tileSize * step - 1) / (tileSize * step));
+
+        rows.resize( size_t(tilesX) * (tilesY + 1) );
+        columns.resize( size_t(tilesX + 1) * tilesY );
+
+        parallelFor(rows.size() + columns.size(), [&](size_t _i, size_t /*_thread*/) {
+            std::vector<float> profile;
+            if (_i < rows.size()) {
+                const int tx = int(_i % tilesX);
+                const int by = int(_i / tilesX);
+                const int y = std::min(by * tileSize * step, limit.y);
+                const int n = getMax(tx, std::min(by, tilesY - 1)).x;
+                for (int p = 0; p <= n; p++)
+                    profile.push_back( _image.getValue( _image.getIndex(std::min(getOffset(tx, 0).x + p * step, limit.x), y) ) );
+                rows[_i] = refineBorder(profile, _maxErrors);
             }
-            return lookup[point];
-        };
+            else {
+                _i -= rows.size();
+                const int bx = int(_i % (tilesX + 1));
+                const int ty = int(_i / (tilesX + 1));
+                const int x = std::min(bx * tileSize * step, limit.x);
+                const int n = getMax(std::min(bx, tilesX - 1), ty).y;
+                for (int p = 0; p <= n; p++)
+                    profile.push_back( _image.getValue( _image.getIndex(x, std::min(getOffset(0, ty).y + p * step, limit.y)) ) );
+                columns[_i] = refineBorder(profile, _maxErrors);
+            }
+        }, _threads);
+    }
 
-        // compute base center point
-        const int center = pointIndex(w * 0.5f, h * 0.5f, z);
-
-        // edge x = 0
-        for (int i = 1; i < sx0s.size(); i++) {
-            const int y0 = sx0s[i-1].first;
-            const int y1 = sx0s[i].first;
-            const float z0 = sx0s[i-1].second;
-            const float z1 = sx0s[i].second;
-            const int p00 = pointIndex(0, y0, z);
-            const int p01 = pointIndex(0, y0, z0);
-            const int p10 = pointIndex(0, y1, z);
-            const int p11 = pointIndex(0, y1, z1);
-            triangles.emplace_back(p01, p10, p00);
-            triangles.emplace_back(p01, p11, p10);
-            triangles.emplace_back(center, p00, p10);
-        }
+    // first pixel of a tile
+    glm::ivec2 getOffset(int _tx, int _ty) const { return glm::ivec2(_tx, _ty) * (tileSize * step); }
 
-        // edge x = w1
-        for (int i = 1; i < sx1s.size(); i++) {
-            const int y0 = sx1s[i-1].first;
-            const int y1 = sx1s[i].first;
-            const float z0 = sx1s[i-1].second;
-            const float z1 = sx1s[i].second;
-            const int p00 = pointIndex(w1, y0, z);
-            const int p01 = pointIndex(w1, y0, z0);
-            const int p10 = pointIndex(w1, y1, z);
-            const int p11 = pointIndex(w1, y1, z1);
-            triangles.emplace_back(p00, p10, p01);
-            triangles.emplace_back(p10, p11, p01);
-            triangles.emplace_back(center, p10, p00);
-        }
+    // last sample of a tile (the last sample of the heightmap can be closer than step)
+    glm::ivec2 getMax(int _tx, int _ty) const {
+        const glm::ivec2 offset = getOffset(_tx, _ty);
+        const glm::ivec2 end = glm::min(offset + tileSize * step, limit);
+        return (end - offset + (step - 1)) / step;
+    }
 
-        // edge y = 0
-        for (int i = 1; i < sy0s.size(); i++) {
-            const int x0 = sy0s[i-1].first;
-            const int x1 = sy0s[i].first;
-            const float z0 = sy0s[i-1].second;
-            const float z1 = sy0s[i].second;
-            const int p00 = pointIndex(x0, 0, z);
-            const int p01 = pointIndex(x0, 0, z0);
-            const int p10 = pointIndex(x1, 0, z);
-            const int p11 = pointIndex(x1, 0, z1);
-            triangles.emplace_back(p00, p10, p01);
-            triangles.emplace_back(p10, p11, p01);
-            triangles.emplace_back(center, p10, p00);
+    // Triangulates a tile level by level, calling _level(level, data) after each one
+    template<typename F>
+    void mesh(const Image& _image, int _tx, int _ty, const std::vector<float>& _maxErrors, F _level) const {
+        const glm::ivec2 max = getMax(_tx, _ty);
+
+        TriangulatorData data;
+        std::vector<float> buffer;
+        data.locked = true;
+        setHeights(data, _image, getOffset(_tx, _ty), step, max, buffer);
+        data.Init();
+
+        const std::vector<glm::ivec2>& top = rows[ size_t(_ty) * tilesX + _tx ];
+        const std::vector<glm::ivec2>& bottom = rows[ size_t(_ty + 1) * tilesX + _tx ];
+        const std::vector<glm::ivec2>& left = columns[ size_t(_ty) * (tilesX + 1) + _tx ];
+        const std::vector<glm::ivec2>& right = columns[ size_t(_ty) * (tilesX + 1) + _tx + 1 ];
+
+        // each level starts from the triangulation of the previous one
+        for (int level = 0; level < int(_maxErrors.size()); level++) {
+            for (const glm::ivec2& p : top)     if (p.y == level) data.InsertOnBorder( glm::ivec2(p.x, 0) );
+            for (const glm::ivec2& p : bottom)  if (p.y == level) data.InsertOnBorder( glm::ivec2(p.x, max.y) );
+            for (const glm::ivec2& p : left)    if (p.y == level) data.InsertOnBorder( glm::ivec2(0, p.x) );
+            for (const glm::ivec2& p : right)   if (p.y == level) data.InsertOnBorder( glm::ivec2(max.x, p.x) );
+            data.Flush();
+
+            data.Refine(_maxErrors[level], 0, 0);
+            _level(level, data);
         }
+    }
+};
 
-        // edge y = h1
-        for (int i = 1; i < sy1s.size(); i++) {
-            const int x0 = sy1s[i-1].first;
-            const int x1 = sy1s[i].first;
-            const float z0 = sy1s[i-1].second;
-            const float z1 = sy1s[i].second;
-            const int p00 = pointIndex(x0, h1, z);
-            const int p01 = pointIndex(x0, h1, z0);
-            const int p10 = pointIndex(x1, h1, z);
-            const int p11 = pointIndex(x1, h1, z1);
-            triangles.emplace_back(p01, p10, p00);
-            triangles.emplace_back(p01, p11, p10);
-            triangles.emplace_back(center, p00, p10);
-        }
+std::vector<Mesh> toTerrainTiles(   const Image& _image,
+                                    const float _zScale,
+                                    const int _tileSize,
+                                    const std::vector<float>& _maxErrors,
+                                    const float _skirtHeight, const bool _normals, const bool _tileTexcoords,
+                                    size_t _threads ) {
+
+    if (_image.getChannels() != 1 || _tileSize < 1 || _maxErrors.size() == 0) {
+        std::cout << "toTerrainTiles needs a single channel image, a tile size and at least one error level" << std::endl;
+        return std::vector<Mesh>();
     }
 
-    Mesh mesh;
+    const TerrainGrid grid(_image, _tileSize, 1, _maxErrors, _threads);
+    const size_t levels = _maxErrors.size();
+    std::vector<Mesh> out( size_t(grid.tilesX) * grid.tilesY * levels );
 
-    for (const glm::vec3 &p : points)
-        mesh.addVertex( p );
+    parallelFor(size_t(grid.tilesX) * grid.tilesY, [&](size_t _tile, size_t /*_thread*/) {
+        grid.mesh(_image, int(_tile % grid.tilesX), int(_tile / grid.tilesX), _maxErrors, [&](int _level, const TriangulatorData& _data) {
+            toMesh(_data, _image, _zScale, 0.0f, _skirtHeight, _normals, _tileTexcoords, out[_tile * levels + _level]);
+        });
+    }, _threads);
 
-    for (const glm::vec2 &t : texcoords)
-        mesh.addTexCoord( t );
-    
-    for (const glm::ivec3 &tri : triangles)
-        mesh.addTriangleIndices( tri[0], tri[1], tri[2] );
+    return out;
+}
 
-    return mesh;
+int toTerrainQuadtree(  const Image& _image,
+                        const float _zScale,
+                        const int _tileSize,
+                        const float _maxError,
+                        const float _skirtHeight,
+                        std::function<void(TerrainTile&)> _callback,
+                        size_t _threads ) {
+
+    if (_image.getChannels() != 1 || _tileSize < 1) {
+        std::cout << "toTerrainQuadtree needs a single channel image and a tile size" << std::endl;
+        return 0;
+    }
+
+    // levels until a single tile covers the whole heightmap
+    const int size = std::max(_image.getWidth(), _image.getHeight()) - 1;
+    int levels = 1;
+    while ((_tileSize << (levels - 1)) < size)
+        levels++;
+
+    for (int level = 0; level < levels; level++) {
+        const int step = 1 << (levels - 1 - level);
+        const std::vector<float> maxErrors = { _maxError * step };
+
+        // only the borders of the level being meshed and the tiles in flight are in memory
+        const TerrainGrid grid(_image, _tileSize, step, maxErrors, _threads);
+
+        parallelFor(size_t(grid.tilesX) * grid.tilesY, [&](size_t _tile, size_t /*_thread*/) {
+            TerrainTile tile;
+            tile.level = level;
+            tile.x = int(_tile % grid.tilesX);
+            tile.y = int(_tile / grid.tilesX);
+            tile.step = step;
+            tile.error = maxErrors[0];
+
+            grid.mesh(_image, tile.x, tile.y, maxErrors, [&](int /*_level*/, const TriangulatorData& _data) {
+                tile.min = _data.offset;
+                tile.max = _data.ToPixel(_data.max);
+                toMesh(_data, _image, _zScale, 0.0f, _skirtHeight, true, true, tile.mesh);
+
+                tile.heights.allocate(_data.max.x + 1, _data.max.y + 1, 1);
+                for (int y = 0; y <= _data.max.y; y++)
+                    for (int x = 0; x <= _data.max.x; x++)
+                        tile.heights.setValue( tile.heights.getIndex(x, y), _data.heights[ size_t(y) * _data.stride + x ] );
+            });
+
+            _callback(tile);
+        }, _threads);
+    }
+
+    return levels;
+}
+
+// First order Eikonal update (fast marching) from the smallest known neighbour distance
+// on each of the _n axes that have one
+static float marchVoxel(float* _a, int _n, float _h) {
+    std::sort(_a, _a + _n);
+
+    // grow the number of axes used while the solution stays upwind
+    float d = _a[0] + _h;
+    for (int k = 2; k <= _n; k++) {
+        float sum = 0.0f, sum2 = 0.0f;
+        for (int j = 0; j < k; j++) {
+            sum += _a[j];
+            sum2 += _a[j] * _a[j];
+        }
+        float disc = sum * sum - k * (sum2 - _h * _h);
+        if (disc < 0.0f)
+            break;
+        float s = (sum + std::sqrt(disc)) / k;
+        d = s;
+        if (k < _n && s > _a[k])
+            continue;
+        break;
+    }
+    return d;
 }
 
-std::vector<Image>  toSdf(const Mesh& _mesh, float _scale, bool _absolute) {
+Volume toSdf(const Mesh& _mesh, float _scale, bool _absolute, float _narrowBand, size_t _threads) {
     Mesh tmp = _mesh;
     center(tmp);
     std::vector<Triangle> elements = tmp.getTriangles();
     BoundingBox bbox = getBoundingBox( elements );
+    MeshBVH bvh( elements );
 
     int width = bbox.getWidth() * _scale;
     int height = bbox.getHeight() * _scale;
-    int depth = bbox.getDepth() * _scale;
-    std::cout << width << "," << height << "," << depth << std::endl;
+    int depth = bbox.getDepth() * _scale + 1;
 
-    std::vector<Image> out;
-    for (int z = 0; z < depth + 1; z++) {
-        Image layer = Image(width, height, 1);
+    const float voxel = 1.0f / _scale;
+    Volume out = Volume(width, height, depth, FLT_MAX);
+    out.origin = bbox.min;
+    out.voxelSize = voxel;
 
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                int index = layer.getIndex(x, y);
-                layer.setValue(index, FLT_MAX);
-
-                glm::vec3 center = bbox.min + glm::vec3(x + 0.5f, y + 0.5f, z + 0.5f)/_scale;
-
-                {
-                    int num_intersect = 0;
-                    glm::vec3 closest_point;
-                    for (size_t i = 0; i < elements.size(); i++) {
-                        distance(center, elements[i], closest_point);
-                        float distance = glm::distance(center, closest_point);// / _scale;
-                        if (distance < layer.getValue(index))
-                            layer.setValue(index, distance);
-
-                        if (!_absolute) {
-                            float t, u, v;
-                            Ray ray = Ray(center, glm::normalize(glm::vec3(0.0f)-center));
-                            bool intersect = intersection(ray, elements[i], t, u, v);
-
-                            if (intersect && t >= 0)
-                                num_intersect++;
-                        }
+    if (elements.size() == 0)
+        return out;
+
+    const int bw = out.getBricksWidth();
+    const int bh = out.getBricksHeight();
+    const size_t bricks = out.getBricksTotal();
+    const int BRICK_VOXELS = Volume::BRICK_SIZE * Volume::BRICK_SIZE * Volume::BRICK_SIZE;
+
+    // Only bricks close to some triangle hold voxels, the rest are a single value each.
+    // Without a band every brick is allocated and every voxel is exact.
+    const bool sparse = _narrowBand > 0.0f;
+    const float band = sparse ? _narrowBand * voxel : FLT_MAX;
+    std::vector<uint8_t> near(bricks, sparse ? 0 : 1);
+    if (sparse) {
+        glm::ivec3 top = glm::ivec3(width - 1, height - 1, depth - 1);
+        for (size_t i = 0; i < elements.size(); i++) {
+            BoundingBox tri;
+            tri.expand(elements[i]);
+            tri.expand(band);
+            glm::ivec3 lo = glm::clamp(glm::ivec3(glm::floor((tri.min - bbox.min) * _scale - 0.5f)), glm::ivec3(0), top) / Volume::BRICK_SIZE;
+            glm::ivec3 hi = glm::clamp(glm::ivec3(glm::ceil((tri.max - bbox.min) * _scale - 0.5f)), glm::ivec3(0), top) / Volume::BRICK_SIZE;
+            for (int z = lo.z; z <= hi.z; z++)
+                for (int y = lo.y; y <= hi.y; y++)
+                    for (int x = lo.x; x <= hi.x; x++)
+                        near[(size_t(z) * bh + y) * bw + x] = 1;
+        }
+    }
+
+    // allocate before going parallel, so the bricks storage doesn't move
+    std::vector<int32_t> slots(bricks, -1);
+    std::vector<uint32_t> slotBricks;
+    for (size_t b = 0; b < bricks; b++)
+        if (near[b]) {
+            slots[b] = slotBricks.size();
+            slotBricks.push_back(b);
+            out.allocateBrick(b % bw, (b / bw) % bh, b / (size_t(bw) * bh));
+        }
+
+    // 0 unknown, 1 on the marching front, 2 marched, 3 exact (voxels of the allocated bricks)
+    std::vector<uint8_t> state(sparse ? slotBricks.size() * BRICK_VOXELS : 0, 0);
+
+    // voxel index on state, -1 for voxels outside the volume or on a tile
+    auto slotIndex = [&](int _x, int _y, int _z) -> int64_t {
+        if (_x < 0 || _y < 0 || _z < 0 || _x >= width || _y >= height || _z >= depth)
+            return -1;
+        int32_t slot = slots[(size_t(_z >> Volume::BRICK_BITS) * bh + (_y >> Volume::BRICK_BITS)) * bw + (_x >> Volume::BRICK_BITS)];
+        if (slot < 0)
+            return -1;
+        return int64_t(slot) * BRICK_VOXELS + (((_z & (Volume::BRICK_SIZE - 1)) * Volume::BRICK_SIZE + (_y & (Volume::BRICK_SIZE - 1))) * Volume::BRICK_SIZE + (_x & (Volume::BRICK_SIZE - 1)));
+    };
+
+    // exact distances on the band, a distance from their center for the far bricks
+    parallelFor(bricks, [&](size_t _b, size_t /*_thread*/) {
+        int bx = _b % bw;
+        int by = (_b / bw) % bh;
+        int bz = _b / (size_t(bw) * bh);
+        SurfacePoint closest;
+
+        if (!near[_b]) {
+            glm::vec3 center = out.toWorld( glm::vec3(bx, by, bz) * float(Volume::BRICK_SIZE) + (Volume::BRICK_SIZE - 1) * 0.5f );
+            bvh.closest(center, closest, FLT_MAX, !_absolute);
+            out.setTile(bx, by, bz, closest.distance);
+            return;
+        }
+
+        int x0 = bx * Volume::BRICK_SIZE, x1 = std::min(x0 + Volume::BRICK_SIZE, width);
+        int y0 = by * Volume::BRICK_SIZE, y1 = std::min(y0 + Volume::BRICK_SIZE, height);
+        int z0 = bz * Volume::BRICK_SIZE, z1 = std::min(z0 + Volume::BRICK_SIZE, depth);
+        for (int z = z0; z < z1; z++)
+            for (int y = y0; y < y1; y++)
+                for (int x = x0; x < x1; x++) {
+                    glm::vec3 center = out.toWorld( glm::vec3(x, y, z) );
+                    if ( bvh.closest(center, closest, band, !_absolute) ) {
+                        out.setValue(x, y, z, closest.distance);
+                        if (sparse)
+                            state[ slotIndex(x, y, z) ] = 3;
                     }
+                }
+    }, _threads);
+
+    if (!sparse)
+        return out;
+
+    // Fill the rest of the allocated bricks marching out from the band (on unsigned distances)
+    typedef std::pair<float, int64_t> Front;
+    std::priority_queue<Front, std::vector<Front>, std::greater<Front> > front;
 
-                    if (!_absolute && num_intersect%2 == 1)
-                        layer.setValue(index, layer.getValue(index) * -1.0f);
-                } 
+    const int dx[6] = { -1, 1, 0, 0, 0, 0 };
+    const int dy[6] = { 0, 0, -1, 1, 0, 0 };
+    const int dz[6] = { 0, 0, 0, 0, -1, 1 };
 
+    auto position = [&](int64_t _i, int& _x, int& _y, int& _z) {
+        uint32_t b = slotBricks[_i / BRICK_VOXELS];
+        int local = _i % BRICK_VOXELS;
+        _x = (b % bw) * Volume::BRICK_SIZE + local % Volume::BRICK_SIZE;
+        _y = ((b / bw) % bh) * Volume::BRICK_SIZE + (local / Volume::BRICK_SIZE) % Volume::BRICK_SIZE;
+        _z = (b / (size_t(bw) * bh)) * Volume::BRICK_SIZE + local / (Volume::BRICK_SIZE * Volume::BRICK_SIZE);
+    };
 
+    auto update = [&](int64_t _i) {
+        int x, y, z;
+        position(_i, x, y, z);
+        for (int n = 0; n < 6; n++) {
+            int nx = x + dx[n], ny = y + dy[n], nz = z + dz[n];
+            int64_t j = slotIndex(nx, ny, nz);
+            if (j < 0 || state[j] >= 2)
+                continue;
+
+            // smallest known neighbour on each axis
+            float a[3];
+            int axes = 0;
+            for (int axis = 0; axis < 3; axis++) {
+                float m = FLT_MAX;
+                for (int side = -1; side <= 1; side += 2) {
+                    int ax = nx + (axis == 0 ? side : 0);
+                    int ay = ny + (axis == 1 ? side : 0);
+                    int az = nz + (axis == 2 ? side : 0);
+                    int64_t k = slotIndex(ax, ay, az);
+                    if (k >= 0 && state[k] >= 2)
+                        m = std::min(m, std::fabs(out.getValue(ax, ay, az)));
+                }
+                if (m < FLT_MAX)
+                    a[axes++] = m;
             }
-        }
 
-        out.push_back(layer);
+            float d = marchVoxel(a, axes, voxel);
+            if (d < out.getValue(nx, ny, nz)) {
+                out.setValue(nx, ny, nz, d);
+                state[j] = 1;
+                front.push( Front(d, j) );
+            }
+        }
+    };
 
-        printProgressBar("toSdf", z/float(depth), 100 );
+    for (int64_t i = 0; i < int64_t(state.size()); i++)
+        if (state[i] == 3)
+            update(i);
+
+    while (!front.empty()) {
+        Front f = front.top();
+        front.pop();
+        int x, y, z;
+        position(f.second, x, y, z);
+        if (state[f.second] >= 2 || f.first > out.getValue(x, y, z))
+            continue;
+        state[f.second] = 2;
+        update(f.second);
     }
 
+    // marched voxels take their sign from the winding number, the ones the march
+    // couldn't reach get an exact distance
+    parallelFor(slotBricks.size(), [&](size_t _s, size_t /*_thread*/) {
+        SurfacePoint closest;
+        for (int local = 0; local < BRICK_VOXELS; local++) {
+            int64_t i = int64_t(_s) * BRICK_VOXELS + local;
+            int x, y, z;
+            position(i, x, y, z);
+            if (state[i] == 3 || x >= width || y >= height || z >= depth)
+                continue;
+
+            glm::vec3 center = out.toWorld( glm::vec3(x, y, z) );
+            if (state[i] != 2) {
+                bvh.closest(center, closest, FLT_MAX, !_absolute);
+                out.setValue(x, y, z, closest.distance);
+            }
+            else if (!_absolute && bvh.getWindingNumber(center) > 0.5f)
+                out.setValue(x, y, z, -out.getValue(x, y, z));
+        }
+    }, _threads);
+
     return out;
 }
 
@@ -1118,6 +1612,10 @@ Image toHeightmap(const Image& _in) {
     return out;
 }
 
+Image packInSprite( const Volume& _volume ) {
+    return packInSprite( _volume.getSlices() );
+}
+
 Image packInSprite( const std::vector<Image>& _images ) {
     Image out;
     if (_images.size() == 0)
@@ -1149,11 +1647,34 @@ Image packInSprite( const std::vector<Image>& _images ) {
 }
 
 unsigned char* to8bit(const Image& _image) {
-    int total = _image.getWidth() * _image.getHeight() * _image.getChannels();
-    unsigned char* pixels = new unsigned char[total];
-    for (int i = 0; i < total; i++)
-        pixels[i] = static_cast<char>(256 * clamp(_image[i], 0.0f, 0.999f));
+    unsigned char* pixels = new unsigned char[ size_t(_image.getWidth()) * _image.getHeight() * _image.getChannels() ];
+    to8bit(_image, pixels);
     return pixels;
 }
 
+void to8bit(const Image& _image, unsigned char* _pixels) {
+    int total = _image.getWidth() * _image.getHeight() * _image.getChannels();
+
+    if (_image.getType() == IMAGE_UINT8 && _image.getLayout() == LAYOUT_LINEAR) {
+        std::memcpy(_pixels, _image.getRawBytes(), total);
+        return;
+    }
+
+    if (_image.getType() == IMAGE_FLOAT32 && _image.getLayout() == LAYOUT_LINEAR) {
+        for (int i = 0; i < total; i++)
+            _pixels[i] = static_cast<char>(256 * clamp(_image[i], 0.0f, 0.999f));
+        return;
+    }
+
+    int width = _image.getWidth();
+    int channels = _image.getChannels();
+    for (int y = 0; y < _image.getHeight(); y++)
+        for (int x = 0; x < width; x++) {
+            size_t src = _image.getIndex(x, y);
+            size_t dst = (y * width + x) * channels;
+            for (int c = 0; c < channels; c++)
+                _pixels[dst + c] = static_cast<char>(256 * clamp(_image.getValue(src + c), 0.0f, 0.999f));
+        }
+}
+
 }
\ No newline at end of file
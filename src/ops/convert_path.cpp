@@ -1,7 +1,7 @@
 #include "hilma/ops/convert_path.h"
-#include "hilma/ops/earcut.h"
 
 #include "hilma/math.h"
+#include "hilma/parallel.h"
 #include "hilma/accel/BoundingBox.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
@@ -12,7 +12,13 @@
 // #include <map>
 // #include <unordered_map>
 
+#include <iostream>
 #include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../deps/earcut.h"
+#include "../types/weld.h"
 
 namespace mapbox { namespace util {
 
@@ -30,67 +36,128 @@ struct nth<1, glm::vec3> {
 
 namespace hilma {
 
-Mesh toSurface(const std::vector<std::vector<glm::vec3>>& _polygon, BoundingBox& _bbox) {
-    Mesh mesh;
+// Rings of a Polygon the way earcut reads them, without copying them
+struct PolygonRings {
+    PolygonRings(const Polygon& _polygon) : polygon(_polygon) {}
 
-    BoundingBox bb;
-    static const glm::vec3 upVector(0.0f, 0.0f, 1.0f);
-    for (size_t i = 0; i < _polygon.size(); i++) {
-        for (size_t j = 0; j < _polygon[i].size(); j++ ) {
-            mesh.addVertex( _polygon[i][j].x, _polygon[i][j].y, 0.0f );
-            mesh.addNormal( upVector );
-            bb.expand( _polygon[i][j].x, _polygon[i][j].y );
-        }
-    }
+    bool    empty() const { return polygon.size() == 0; }
+    size_t  size() const { return polygon.size(); }
+    const std::vector<glm::vec3>& operator[](size_t _index) const { return polygon[_index].getVertices(); }
+
+    const Polygon& polygon;
+};
+
+// Triangulator of the calling thread. It keeps its nodes and indices between calls, so
+// triangulating many small polygons doesn't allocate. Polygons of more than 80 vertices
+// look for ears through a z-order hash.
+inline mapbox::detail::Earcut<uint32_t>& getTriangulator() {
+    static thread_local mapbox::detail::Earcut<uint32_t> earcut;
+    return earcut;
+}
+
+// The shapes are tessellated through a sink: appended to a Mesh, only counted (to size a batch)
+// or written in place on their slot of a batch mesh
+
+struct MeshSink {
+    MeshSink(Mesh& _mesh) : mesh(_mesh) {}
 
-    for (size_t i = 0; i < mesh.getVerticesTotal(); i++) {
-        glm::vec3 p = mesh.getVertices()[i];
-        mesh.addTexCoord(   remap(p.x, bb.min.x, bb.max.x, 0.0f, 1.0f, true),
-                            remap(p.y, bb.min.y, bb.max.y, 0.0f, 1.0f, true) );
+    size_t  getVerticesTotal() const { return mesh.getVerticesTotal(); }
+
+    void    addVertex(const glm::vec3& _vertex, const glm::vec3& _normal, const glm::vec2& _uv) {
+        mesh.addVertex(_vertex);
+        mesh.addNormal(_normal);
+        mesh.addTexCoord(_uv);
     }
 
-    std::vector<uint32_t> indices = mapbox::earcut<uint32_t>(_polygon);
-    for (size_t i = 0; i < indices.size(); i++)
-        mesh.addFaceIndex(indices[i]);
+    void    addTriangle(size_t _i1, size_t _i2, size_t _i3) { mesh.addTriangleIndices(_i1, _i2, _i3); }
 
-    return mesh;
-}
+    Mesh&   mesh;
+};
 
-Mesh toSurface(const std::vector<std::vector<glm::vec3>>& _polygon, const BoundingBox& _bbox) {
-    Mesh mesh;
+struct CountSink {
+    size_t  getVerticesTotal() const { return verticesTotal; }
+    void    addVertex(const glm::vec3&, const glm::vec3&, const glm::vec2&) { verticesTotal++; }
+    void    addTriangle(size_t, size_t, size_t) { indicesTotal += 3; }
+
+    size_t  verticesTotal = 0;
+    size_t  indicesTotal = 0;
+};
+
+struct SpanSink {
+    size_t  getVerticesTotal() const { return verticesTotal; }
+
+    void    addVertex(const glm::vec3& _vertex, const glm::vec3& _normal, const glm::vec2& _uv) {
+        vertices[verticesTotal] = _vertex;
+        normals[verticesTotal] = _normal;
+        texcoords[verticesTotal] = _uv;
+        verticesTotal++;
+    }
 
+    void    addTriangle(size_t _i1, size_t _i2, size_t _i3) {
+        indices[indicesTotal++] = offset + _i1;
+        indices[indicesTotal++] = offset + _i2;
+        indices[indicesTotal++] = offset + _i3;
+    }
+
+    glm::vec3*  vertices;
+    glm::vec3*  normals;
+    glm::vec2*  texcoords;
+    INDEX_TYPE* indices;
+    size_t      offset;     // index of the first vertex of the shape on the mesh
+    size_t      verticesTotal = 0;
+    size_t      indicesTotal = 0;
+};
+
+template<typename Rings, typename Sink>
+void surface(const Rings& _rings, const BoundingBox& _bbox, float _z, const uint32_t* _indices, size_t _indicesTotal, Sink& _sink) {
     BoundingBox bb = _bbox;
+    for (size_t i = 0; i < _rings.size(); i++)
+        for (size_t j = 0; j < _rings[i].size(); j++ )
+            bb.expand( _rings[i][j].x, _rings[i][j].y );
+
     static const glm::vec3 upVector(0.0f, 0.0f, 1.0f);
-    for (size_t i = 0; i < _polygon.size(); i++) {
-        for (size_t j = 0; j < _polygon[i].size(); j++ ) {
-            mesh.addVertex( _polygon[i][j].x, _polygon[i][j].y, 0.0f );
-            mesh.addNormal( upVector );
-            bb.expand( _polygon[i][j].x, _polygon[i][j].y );
+    for (size_t i = 0; i < _rings.size(); i++) {
+        const std::vector<glm::vec3>& ring = _rings[i];
+        for (size_t j = 0; j < ring.size(); j++ ) {
+            const glm::vec3& p = ring[j];
+            _sink.addVertex(glm::vec3(p.x, p.y, _z), upVector,
+                            glm::vec2(  remap(p.x, bb.min.x, bb.max.x, 0.0f, 1.0f, true),
+                                        remap(p.y, bb.min.y, bb.max.y, 0.0f, 1.0f, true) ) );
         }
     }
 
-    for (size_t i = 0; i < mesh.getVerticesTotal(); i++) {
-        glm::vec3 p = mesh.getVertices()[i];
-        mesh.addTexCoord(   remap(p.x, bb.min.x, bb.max.x, 0.0f, 1.0f, true),
-                            remap(p.y, bb.min.y, bb.max.y, 0.0f, 1.0f, true) );
-    }
+    for (size_t i = 0; i + 2 < _indicesTotal; i += 3)
+        _sink.addTriangle(_indices[i], _indices[i+1], _indices[i+2]);
+}
 
-    std::vector<uint32_t> indices = mapbox::earcut<uint32_t>(_polygon);
-    for (size_t i = 0; i < indices.size(); i++)
-        mesh.addFaceIndex(indices[i]);
+template<typename Rings>
+Mesh surfaceMesh(const Rings& _rings, const BoundingBox& _bbox) {
+    mapbox::detail::Earcut<uint32_t>& earcut = getTriangulator();
+    earcut(_rings);
 
+    Mesh mesh;
+    mesh.reserve(earcut.vertices, earcut.indices.size(), true, true);
+    MeshSink sink(mesh);
+    surface(_rings, _bbox, 0.0f, earcut.indices.data(), earcut.indices.size(), sink);
     return mesh;
 }
 
-Mesh toWall(const std::vector<glm::vec3>& _polyline, float _maxHeight, float _minHeight) {
-    Mesh mesh;
-    
+Mesh toSurface(const std::vector<std::vector<glm::vec3>>& _polygon, const BoundingBox& _bbox) {
+    return surfaceMesh(_polygon, _bbox);
+}
+
+Mesh toSurface(const Polygon& _polygon, const BoundingBox& _bbox) {
+    return surfaceMesh(PolygonRings(_polygon), _bbox);
+}
+
+template<typename Sink>
+void wall(const std::vector<glm::vec3>& _polyline, float _maxHeight, float _minHeight, Sink& _sink) {
     static const glm::vec3 upVector(0.0f, 0.0f, 1.0f);
     glm::vec3 normalVector;
 
     int lineN  = 0;
-    INDEX_TYPE vertexN = 0;
-    for (size_t i = 0; i < _polyline.size() - 1; i++) {
+    INDEX_TYPE vertexN = _sink.getVerticesTotal();
+    for (size_t i = 0; i + 1 < _polyline.size(); i++) {
 
         glm::vec3 a(_polyline[i].x, _polyline[i].y, 0.f);
         glm::vec3 b(_polyline[i+1].x, _polyline[i+1].y, 0.f);
@@ -107,41 +174,38 @@ Mesh toWall(const std::vector<glm::vec3>& _polyline, float _maxHeight, float _mi
 
         // 1st vertex top
         a.z = _maxHeight;
-        mesh.addVertex(a);
-        mesh.addNormal(normalVector);
-        mesh.addTexCoord(1.,1.);
+        _sink.addVertex(a, normalVector, glm::vec2(1., 1.));
 
         // 2nd vertex top
         b.z = _maxHeight;
-        mesh.addVertex(b);
-        mesh.addNormal(normalVector);
-        mesh.addTexCoord(0.,1.);
+        _sink.addVertex(b, normalVector, glm::vec2(0., 1.));
 
         // 1st vertex bottom
         a.z = _minHeight;
-        mesh.addVertex(a);
-        mesh.addNormal(normalVector);
-        mesh.addTexCoord(1.,0.);
+        _sink.addVertex(a, normalVector, glm::vec2(1., 0.));
 
         // 2nd vertex bottom
         b.z = _minHeight;
-        mesh.addVertex(b);
-        mesh.addNormal(normalVector);
-        mesh.addTexCoord(0.,0.);
+        _sink.addVertex(b, normalVector, glm::vec2(0., 0.));
 
         // Start the index from the previous state of the vertex Data
         if (lineN == 0) {
-            mesh.addTriangleIndices(vertexN, vertexN + 2, vertexN + 1);
-            mesh.addTriangleIndices(vertexN + 1, vertexN + 2, vertexN + 3);
+            _sink.addTriangle(vertexN, vertexN + 2, vertexN + 1);
+            _sink.addTriangle(vertexN + 1, vertexN + 2, vertexN + 3);
         }
         else {
-            mesh.addTriangleIndices(vertexN, vertexN + 1, vertexN + 2);
-            mesh.addTriangleIndices(vertexN + 1, vertexN + 3, vertexN + 2);
+            _sink.addTriangle(vertexN, vertexN + 1, vertexN + 2);
+            _sink.addTriangle(vertexN + 1, vertexN + 3, vertexN + 2);
         }
 
         vertexN += 4;
     }
+}
 
+Mesh toWall(const std::vector<glm::vec3>& _polyline, float _maxHeight, float _minHeight) {
+    Mesh mesh;
+    MeshSink sink(mesh);
+    wall(_polyline, _maxHeight, _minHeight, sink);
     return mesh;
 }
 
@@ -155,32 +219,28 @@ inline glm::vec2 perp2d(const glm::vec3& _v1, const glm::vec3& _v2 ) {
 }
 
 // Helper function for polyline tesselation
-inline void addPolyLineVertex(const glm::vec3& _coord, const glm::vec2& _normal, const glm::vec2& _uv, Mesh& _mesh, float _width) {
-    if (_width > 0.0f) {
-        glm::vec3 p = _coord + glm::vec3(_normal, 0.0f) * _width;
-        _mesh.addVertex(p);
-        _mesh.addNormal(0.0f, 0.0f, 1.0f);
-    }
-    else {
+template<typename Sink>
+inline void addPolyLineVertex(const glm::vec3& _coord, const glm::vec2& _normal, const glm::vec2& _uv, Sink& _sink, float _width) {
+    if (_width > 0.0f)
+        _sink.addVertex(_coord + glm::vec3(_normal, 0.0f) * _width, glm::vec3(0.0f, 0.0f, 1.0f), _uv);
+    else
         // Collapsed spline 
-        _mesh.addVertex(_coord);
-        _mesh.addNormal(_normal.x, _normal.y, 0.0f);
-    }
-    _mesh.addTexCoord(_uv);
+        _sink.addVertex(_coord, glm::vec3(_normal.x, _normal.y, 0.0f), _uv);
 }
 
 // Helper function for polyline tesselation; adds indices for pairs of vertices arranged like a line strip
-void indexPairs(size_t _nPairs, Mesh& _mesh) {
-    size_t nVertices = _mesh.getVerticesTotal();
+template<typename Sink>
+void indexPairs(size_t _nPairs, Sink& _sink) {
+    size_t nVertices = _sink.getVerticesTotal();
 
     for (size_t i = 0; i < _nPairs; i++) {
-        _mesh.addTriangleIndices(   nVertices - 2*i - 4,
-                                    nVertices - 2*i - 2,
-                                    nVertices - 2*i - 3 );
+        _sink.addTriangle(  nVertices - 2*i - 4,
+                            nVertices - 2*i - 2,
+                            nVertices - 2*i - 3 );
 
-        _mesh.addTriangleIndices(   nVertices - 2*i - 3,
-                                    nVertices - 2*i - 2,
-                                    nVertices - 2*i - 1 );
+        _sink.addTriangle(  nVertices - 2*i - 3,
+                            nVertices - 2*i - 2,
+                            nVertices - 2*i - 1 );
     }
 }
 
@@ -189,22 +249,23 @@ void indexPairs(size_t _nPairs, Mesh& _mesh) {
 //  and interpolating their UVs               \ p /
 //                                             \./
 //                                              C
+template<typename Sink>
 void addFan(const glm::vec3& _pC,
             const glm::vec2& _nA, const glm::vec2& _nB, const glm::vec2& _nC,
             const glm::vec2& _uA, const glm::vec2& _uB, const glm::vec2& _uC,
-            size_t _numTriangles, Mesh& _mesh, float _width) {
+            size_t _numTriangles, Sink& _sink, float _width) {
 
     // Find angle difference
     float cross = _nA.x * _nB.y - _nA.y * _nB.x; // z component of cross(_CA, _CB)
     float angle = atan2f(cross, glm::dot(_nA, _nB));
 
-    size_t startIndex = _mesh.getVerticesTotal();
+    size_t startIndex = _sink.getVerticesTotal();
 
     // Add center vertex
-    addPolyLineVertex(_pC, _nC, _uC, _mesh, _width);
+    addPolyLineVertex(_pC, _nC, _uC, _sink, _width);
 
     // Add vertex for point A
-    addPolyLineVertex(_pC, _nA, _uA, _mesh, _width);
+    addPolyLineVertex(_pC, _nA, _uA, _sink, _width);
 
     // Add radial vertices
     glm::vec2 radial = _nA;
@@ -216,18 +277,19 @@ void addFan(const glm::vec3& _pC,
         // if (_mesh.useTexCoords)
         uv = (1.f - frac) * _uA + frac * _uB;
 
-        addPolyLineVertex(_pC, radial, uv, _mesh, _width);
+        addPolyLineVertex(_pC, radial, uv, _sink, _width);
 
         // Add indices
-        _mesh.addTriangleIndices(   startIndex, // center vertex
-                                    startIndex + i + (angle > 0 ? 1 : 2),
-                                    startIndex + i + (angle > 0 ? 2 : 1) );
+        _sink.addTriangle(  startIndex, // center vertex
+                            startIndex + i + (angle > 0 ? 1 : 2),
+                            startIndex + i + (angle > 0 ? 2 : 1) );
     }
 
 }
 
 // Function to add the vertices for line caps
-void addCap(const glm::vec3& _coord, const glm::vec2& _normal, int _numCorners, bool _isBeginning, Mesh& _mesh, float _width) {
+template<typename Sink>
+void addCap(const glm::vec3& _coord, const glm::vec2& _normal, int _numCorners, bool _isBeginning, Sink& _sink, float _width) {
 
     float v = _isBeginning ? 0.f : 1.f; // length-wise tex coord
 
@@ -238,10 +300,10 @@ void addCap(const glm::vec3& _coord, const glm::vec2& _normal, int _numCorners,
     else if (_numCorners == 2) {
         // "Square" cap needs two extra vertices
         glm::vec2 tangent(-_normal.y, _normal.x);
-        addPolyLineVertex(_coord, _normal + tangent, {0.f, v}, _mesh, _width);
-        addPolyLineVertex(_coord, -_normal + tangent, {0.f, v}, _mesh, _width);
+        addPolyLineVertex(_coord, _normal + tangent, {0.f, v}, _sink, _width);
+        addPolyLineVertex(_coord, -_normal + tangent, {0.f, v}, _sink, _width);
         if (!_isBeginning) { // At the beginning of a line we can't form triangles with previous vertices
-            indexPairs(1, _mesh);
+            indexPairs(1, _sink);
         }
         return;
     }
@@ -254,12 +316,11 @@ void addCap(const glm::vec3& _coord, const glm::vec2& _normal, int _numCorners,
         uA.x = 0.f; // To keep tex coords consistent, we must reverse these too
         uB.x = 1.f;
     }
-    addFan(_coord, nA, nB, nC, uA, uB, uC, _numCorners, _mesh, _width);
+    addFan(_coord, nA, nB, nC, uA, uB, uC, _numCorners, _sink, _width);
 }
 
-Mesh toSpline(const std::vector<glm::vec3>& _polyline, float _width, JoinType _join, CapType _cap, float _miterLimit) { //}, bool _close) {;
-
-    Mesh mesh;
+template<typename Sink>
+void spline(const std::vector<glm::vec3>& _polyline, float _width, JoinType _join, CapType _cap, float _miterLimit, Sink& _sink) {
     size_t startIndex = 0;
     size_t endIndex = _polyline.size();
     bool endCap = true;
@@ -272,7 +333,7 @@ Mesh toSpline(const std::vector<glm::vec3>& _polyline, float _width, JoinType _j
     int lineSize = (int)((endIndex > startIndex) ?
                    (endIndex - startIndex) :
                    (origLineSize - startIndex + endIndex));
-    if (lineSize < 2) { return mesh; }
+    if (lineSize < 2) { return; }
 
     glm::vec3 coordCurr(_polyline[startIndex]);
     // get the Point using wrapped index in the original line geometry
@@ -286,10 +347,10 @@ Mesh toSpline(const std::vector<glm::vec3>& _polyline, float _width, JoinType _j
     normNext = glm::normalize(perp2d(coordCurr, coordNext));
 
     if (endCap)
-        addCap(coordCurr, normNext, cornersOnCap, true, mesh, _width);
+        addCap(coordCurr, normNext, cornersOnCap, true, _sink, _width);
     
-    addPolyLineVertex(coordCurr, normNext, {1.0f, 0.0f}, mesh, _width); // right corner
-    addPolyLineVertex(coordCurr, -normNext, {0.0f, 0.0f}, mesh, _width); // left corner
+    addPolyLineVertex(coordCurr, normNext, {1.0f, 0.0f}, _sink, _width); // right corner
+    addPolyLineVertex(coordCurr, -normNext, {0.0f, 0.0f}, _sink, _width); // left corner
 
 
     // Process intermediate points
@@ -334,9 +395,9 @@ Mesh toSpline(const std::vector<glm::vec3>& _polyline, float _width, JoinType _j
         if (trianglesOnJoin == 0) {
             // Join type is a simple miter
 
-            addPolyLineVertex(coordCurr, miterVec, {1.0, v}, mesh, _width); // right corner
-            addPolyLineVertex(coordCurr, -miterVec, {0.0, v}, mesh, _width); // left corner
-            indexPairs(1, mesh);
+            addPolyLineVertex(coordCurr, miterVec, {1.0, v}, _sink, _width); // right corner
+            addPolyLineVertex(coordCurr, -miterVec, {0.0, v}, _sink, _width); // left corner
+            indexPairs(1, _sink);
 
         }
         else {
@@ -347,25 +408,25 @@ Mesh toSpline(const std::vector<glm::vec3>& _polyline, float _width, JoinType _j
 
             if (isRightTurn) {
 
-                addPolyLineVertex(coordCurr, miterVec, {1.0f, v}, mesh, _width); // right (inner) corner
-                addPolyLineVertex(coordCurr, -normPrev, {0.0f, v}, mesh, _width); // left (outer) corner
-                indexPairs(1, mesh);
+                addPolyLineVertex(coordCurr, miterVec, {1.0f, v}, _sink, _width); // right (inner) corner
+                addPolyLineVertex(coordCurr, -normPrev, {0.0f, v}, _sink, _width); // left (outer) corner
+                indexPairs(1, _sink);
 
-                addFan(coordCurr, -normPrev, -normNext, miterVec, {0.f, v}, {0.f, v}, {1.f, v}, trianglesOnJoin, mesh, _width);
+                addFan(coordCurr, -normPrev, -normNext, miterVec, {0.f, v}, {0.f, v}, {1.f, v}, trianglesOnJoin, _sink, _width);
 
-                addPolyLineVertex(coordCurr, miterVec, {1.0f, v}, mesh, _width); // right (inner) corner
-                addPolyLineVertex(coordCurr, -normNext, {0.0f, v}, mesh, _width); // left (outer) corner
+                addPolyLineVertex(coordCurr, miterVec, {1.0f, v}, _sink, _width); // right (inner) corner
+                addPolyLineVertex(coordCurr, -normNext, {0.0f, v}, _sink, _width); // left (outer) corner
 
             } else {
 
-                addPolyLineVertex(coordCurr, normPrev, {1.0f, v}, mesh, _width); // right (outer) corner
-                addPolyLineVertex(coordCurr, -miterVec, {0.0f, v}, mesh, _width); // left (inner) corner
-                indexPairs(1, mesh);
+                addPolyLineVertex(coordCurr, normPrev, {1.0f, v}, _sink, _width); // right (outer) corner
+                addPolyLineVertex(coordCurr, -miterVec, {0.0f, v}, _sink, _width); // left (inner) corner
+                indexPairs(1, _sink);
 
-                addFan(coordCurr, normPrev, normNext, -miterVec, {1.f, v}, {1.f, v}, {0.0f, v}, trianglesOnJoin, mesh, _width);
+                addFan(coordCurr, normPrev, normNext, -miterVec, {1.f, v}, {1.f, v}, {0.0f, v}, trianglesOnJoin, _sink, _width);
 
-                addPolyLineVertex(coordCurr, normNext, {1.0f, v}, mesh, _width); // right (outer) corner
-                addPolyLineVertex(coordCurr, -miterVec, {0.0f, v}, mesh, _width); // left (inner) corner
+                addPolyLineVertex(coordCurr, normNext, {1.0f, v}, _sink, _width); // right (outer) corner
+                addPolyLineVertex(coordCurr, -miterVec, {0.0f, v}, _sink, _width); // left (inner) corner
             }
         }
     }
@@ -373,93 +434,424 @@ Mesh toSpline(const std::vector<glm::vec3>& _polyline, float _width, JoinType _j
     distance += glm::distance(coordCurr, coordNext);
 
     // Process last point in line with a cap
-    addPolyLineVertex(coordNext, normNext, {1.f, distance}, mesh, _width); // right corner
-    addPolyLineVertex(coordNext, -normNext, {0.f, distance}, mesh, _width); // left corner
-    indexPairs(1, mesh);
+    addPolyLineVertex(coordNext, normNext, {1.f, distance}, _sink, _width); // right corner
+    addPolyLineVertex(coordNext, -normNext, {0.f, distance}, _sink, _width); // left corner
+    indexPairs(1, _sink);
     if (endCap)
-        addCap(coordNext, normNext, cornersOnCap, false, mesh, _width);
+        addCap(coordNext, normNext, cornersOnCap, false, _sink, _width);
+}
 
+Mesh toSpline(const std::vector<glm::vec3>& _polyline, float _width, JoinType _join, CapType _cap, float _miterLimit) {
+    Mesh mesh;
+    MeshSink sink(mesh);
+    spline(_polyline, _width, _join, _cap, _miterLimit, sink);
     return mesh;
 }
 
-Mesh toTube(const Polyline& _polyline, const float* _array1D, int _n, int _resolution, bool _caps) {
-    Mesh mesh;
-    size_t offset = 0;
+// BATCHES
+//
+
+// Per shape values come one per shape, a single one for all of them or none
+inline bool haveValuesFor(size_t _values, size_t _total) {
+    return _values <= 1 || _values == _total;
+}
+
+// One value per shape or a single one for all
+inline float valueAt(const std::vector<float>& _values, size_t _index, float _default) {
+    if (_values.size() == 0)
+        return _default;
+    return (_values.size() == 1) ? _values[0] : _values[_index];
+}
+
+// Mesh is friend of it to size its buffers once and have the threads write straight into them
+class MeshBatch {
+public:
+    // _shapes(index, sink) tessellates a shape into any of the sinks. It's called twice per
+    // shape: once to count and once to write, on its own slot of the mesh.
+    template<typename Shapes>
+    static Mesh build(size_t _total, const Shapes& _shapes, const std::vector<MaterialPtr>& _materials, std::vector<uint32_t>* _ids, size_t _threads) {
+        std::vector<size_t> verticesOffsets(_total + 1, 0);
+        std::vector<size_t> indicesOffsets(_total + 1, 0);
+
+        parallelFor(_total, [&](size_t _i, size_t /*_thread*/) {
+            CountSink count;
+            _shapes(_i, count);
+            verticesOffsets[_i + 1] = count.verticesTotal;
+            indicesOffsets[_i + 1] = count.indicesTotal;
+        }, _threads);
+
+        for (size_t i = 0; i < _total; i++) {
+            verticesOffsets[i + 1] += verticesOffsets[i];
+            indicesOffsets[i + 1] += indicesOffsets[i];
+        }
+
+        Mesh mesh;
+        mesh.vertices.resize(verticesOffsets[_total]);
+        mesh.normals.resize(verticesOffsets[_total]);
+        mesh.texcoords.resize(verticesOffsets[_total]);
+        mesh.faceIndices.resize(indicesOffsets[_total]);
+        if (_ids)
+            _ids->resize(verticesOffsets[_total]);
+
+        // runs of shapes sharing a material
+        MaterialPtr last;
+        for (size_t i = 0; i < _materials.size() && i < _total; i++) {
+            if (_materials[i] && _materials[i] != last && indicesOffsets[i + 1] > indicesOffsets[i]) {
+                mesh.addMaterial(*_materials[i], indicesOffsets[i]);
+                last = _materials[i];
+            }
+        }
+
+        parallelFor(_total, [&](size_t _i, size_t /*_thread*/) {
+            SpanSink span;
+            span.vertices = mesh.vertices.data() + verticesOffsets[_i];
+            span.normals = mesh.normals.data() + verticesOffsets[_i];
+            span.texcoords = mesh.texcoords.data() + verticesOffsets[_i];
+            span.indices = mesh.faceIndices.data() + indicesOffsets[_i];
+            span.offset = verticesOffsets[_i];
+            _shapes(_i, span);
 
+            if (_ids)
+                std::fill(_ids->begin() + verticesOffsets[_i], _ids->begin() + verticesOffsets[_i + 1], uint32_t(_i));
+        }, _threads);
 
-    if ( !_polyline.isClosed() && _caps) {
-        mesh.addVertex(_polyline.getVertices()[0]);
-        mesh.addNormal( glm::normalize( _polyline.getVertices()[1] - _polyline.getVertices()[2] ) );
-        mesh.addTexCoord( glm::vec2(0.5, 0.0));
-        offset = 1;
+        return mesh;
     }
-    
-    for (size_t i = 0; i < _polyline.size(); i++) {
-        const glm::vec3& p0 = _polyline[i];
-        const glm::vec3& n0 = _polyline.getNormalAtIndex(i);
-        const glm::vec3& t0 = _polyline.getTangentAtIndex(i);
-        float r0 = _array1D[i%_n];
-
-        glm::vec3 v0;
-        for(int j = 0; j < _resolution; j++) {
-            float p = j / (float)_resolution;
-            float a = p * TAU;
-            v0 = glm::rotate(n0, a, t0);
-            
-            mesh.addTexCoord( glm::vec2(p, i/(_polyline.size()-1.0)) );
-            mesh.addNormal(v0);
-            
-            v0 *= r0;
-            v0 += p0;
-            
-            mesh.addVertex(v0);
+};
+
+struct SurfaceShapes {
+    template<typename Sink>
+    void operator()(size_t _i, Sink& _sink) const {
+        const uint32_t* indices = buffers[threads[_i]].data() + starts[_i];
+        surface(PolygonRings((*polygons)[_i]), BoundingBox(), valueAt(*heights, _i, 0.0f), indices, counts[_i], _sink);
+    }
+
+    const std::vector<Polygon>* polygons;
+    const std::vector<float>*   heights;
+
+    // the indices of each shape, on the buffer of the thread that triangulated it
+    std::vector< std::vector<uint32_t> > buffers;
+    std::vector<uint32_t>   threads;
+    std::vector<size_t>     starts;
+    std::vector<size_t>     counts;
+};
+
+Mesh toSurface(const std::vector<Polygon>& _polygons, const std::vector<float>& _heights, const std::vector<MaterialPtr>& _materials, std::vector<uint32_t>* _ids, size_t _threads) {
+    if (!haveValuesFor(_heights.size(), _polygons.size()) || !haveValuesFor(_materials.size(), _polygons.size())) {
+        std::cout << "ERROR: toSurface() heights and materials must be one per polygon, a single one or none" << std::endl;
+        return Mesh();
+    }
+
+    SurfaceShapes shapes;
+    shapes.polygons = &_polygons;
+    shapes.heights = &_heights;
+    shapes.buffers.resize( (_threads == 0) ? getThreadsTotal() : _threads );
+    shapes.threads.resize(_polygons.size());
+    shapes.starts.resize(_polygons.size());
+    shapes.counts.resize(_polygons.size());
+
+    // the triangulation is the costly part, done once ahead of counting
+    parallelFor(_polygons.size(), [&](size_t _i, size_t _thread) {
+        mapbox::detail::Earcut<uint32_t>& earcut = getTriangulator();
+        earcut(PolygonRings(_polygons[_i]));
+
+        std::vector<uint32_t>& buffer = shapes.buffers[_thread];
+        shapes.threads[_i] = _thread;
+        shapes.starts[_i] = buffer.size();
+        shapes.counts[_i] = earcut.indices.size();
+        buffer.insert(buffer.end(), earcut.indices.begin(), earcut.indices.end());
+    }, _threads);
+
+    return MeshBatch::build(_polygons.size(), shapes, _materials, _ids, _threads);
+}
+
+struct WallShapes {
+    template<typename Sink>
+    void operator()(size_t _i, Sink& _sink) const {
+        float maxHeight = valueAt(*maxHeights, _i, 0.0f);
+        float minHeight = valueAt(*minHeights, _i, 0.0f);
+        for (size_t j = 0; j < (*polygons)[_i].size(); j++)
+            wall((*polygons)[_i][j].getVertices(), maxHeight, minHeight, _sink);
+    }
+
+    const std::vector<Polygon>* polygons;
+    const std::vector<float>*   maxHeights;
+    const std::vector<float>*   minHeights;
+};
+
+Mesh toWall(const std::vector<Polygon>& _polygons, const std::vector<float>& _maxHeights, const std::vector<float>& _minHeights, const std::vector<MaterialPtr>& _materials, std::vector<uint32_t>* _ids, size_t _threads) {
+    if (!haveValuesFor(_maxHeights.size(), _polygons.size()) || !haveValuesFor(_minHeights.size(), _polygons.size()) ||
+        !haveValuesFor(_materials.size(), _polygons.size())) {
+        std::cout << "ERROR: toWall() heights and materials must be one per polygon, a single one or none" << std::endl;
+        return Mesh();
+    }
+
+    WallShapes shapes;
+    shapes.polygons = &_polygons;
+    shapes.maxHeights = &_maxHeights;
+    shapes.minHeights = &_minHeights;
+    return MeshBatch::build(_polygons.size(), shapes, _materials, _ids, _threads);
+}
+
+struct SplineShapes {
+    template<typename Sink>
+    void operator()(size_t _i, Sink& _sink) const {
+        spline((*polylines)[_i].getVertices(), valueAt(*widths, _i, 1.0f), join, cap, miterLimit, _sink);
+    }
+
+    const std::vector<Polyline>* polylines;
+    const std::vector<float>*   widths;
+    JoinType                    join;
+    CapType                     cap;
+    float                       miterLimit;
+};
+
+Mesh toSpline(const std::vector<Polyline>& _polylines, const std::vector<float>& _widths, JoinType _join, CapType _cap, float _miterLimit, const std::vector<MaterialPtr>& _materials, std::vector<uint32_t>* _ids, size_t _threads) {
+    if (!haveValuesFor(_widths.size(), _polylines.size()) || !haveValuesFor(_materials.size(), _polylines.size())) {
+        std::cout << "ERROR: toSpline() widths and materials must be one per polyline, a single one or none" << std::endl;
+        return Mesh();
+    }
+
+    SplineShapes shapes;
+    shapes.polylines = &_polylines;
+    shapes.widths = &_widths;
+    shapes.join = _join;
+    shapes.cap = _cap;
+    shapes.miterLimit = _miterLimit;
+    return MeshBatch::build(_polylines.size(), shapes, _materials, _ids, _threads);
+}
+
+// Rotation minimizing frames along a polyline, by parallel transport through double reflections
+// (Wang et al. 2008) in one pass. Closed lines spread the twist left at the seam along their length.
+void tubeFrames(const Polyline& _polyline, std::vector<glm::vec3>& _tangents, std::vector<glm::vec3>& _normals) {
+    const std::vector<glm::vec3>& points = _polyline.getVertices();
+    const size_t total = points.size();
+    const bool closed = _polyline.isClosed();
+    const size_t segments = closed ? total : total - 1;
+
+    // directions of the segments, the ones of no length take the one of the next segment
+    _tangents.resize(total);
+    glm::vec3 direction(0.0f);
+    for (size_t i = segments; i-- > 0; ) {
+        glm::vec3 d = points[(i + 1) % total] - points[i];
+        if (glm::dot(d, d) > 0.0f)
+            direction = glm::normalize(d);
+        _tangents[i] = direction;
+    }
+
+    // ...or of the previous one at the end of the line
+    direction = (direction == glm::vec3(0.0f)) ? glm::vec3(1.0f, 0.0f, 0.0f) : direction;
+    for (size_t i = 0; i < segments; i++) {
+        if (_tangents[i] == glm::vec3(0.0f))
+            _tangents[i] = direction;
+        direction = _tangents[i];
+    }
+
+    // tangents bisect the segments around each vertex, repeated vertices share theirs
+    glm::vec3 previous = closed ? _tangents[total - 1] : _tangents[0];
+    for (size_t i = 0; i < total; i++) {
+        glm::vec3 next = (i < segments) ? _tangents[i] : previous;
+        glm::vec3 t = previous + next;
+        if (i > 0 && points[i] == points[i - 1])
+            _tangents[i] = _tangents[i - 1];
+        else
+            _tangents[i] = (glm::dot(t, t) > 1e-12f) ? glm::normalize(t) : next;
+        previous = next;
+    }
+
+    // the first normal points to the right vector side, as the polyline's own normals do
+    _normals.resize(total);
+    glm::vec3 n = glm::cross(_polyline.getRightVector(), _tangents[0]);
+    if (glm::dot(n, n) < 1e-12f)
+        n = glm::cross(_tangents[0], std::fabs(_tangents[0].x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+    _normals[0] = glm::normalize(n);
+
+    for (size_t i = 0; i < segments; i++) {
+        size_t j = (i + 1) % total;
+        glm::vec3 v1 = points[j] - points[i];
+        float c1 = glm::dot(v1, v1);
+        glm::vec3 r = _normals[i];
+        if (c1 > 0.0f) {
+            // reflect the frame on the plane bisecting the segment, then on the one that matches the tangents
+            glm::vec3 rL = r - (2.0f / c1) * glm::dot(v1, r) * v1;
+            glm::vec3 tL = _tangents[i] - (2.0f / c1) * glm::dot(v1, _tangents[i]) * v1;
+            glm::vec3 v2 = _tangents[j] - tL;
+            float c2 = glm::dot(v2, v2);
+            r = (c2 > 0.0f) ? rL - (2.0f / c2) * glm::dot(v2, rL) * v2 : rL;
         }
+
+        r -= _tangents[j] * glm::dot(r, _tangents[j]);
+        if (glm::dot(r, r) > 1e-12f)
+            r = glm::normalize(r);
+        else
+            r = _normals[i];
+
+        if (j == 0) {
+            // back at the start, turn every frame a share of the angle missing to close
+            float angle = atan2f(glm::dot(glm::cross(r, _normals[0]), _tangents[0]), glm::dot(r, _normals[0]));
+            float perimeter = _polyline.getPerimeter();
+            if (perimeter > 0.0f)
+                for (size_t k = 1; k < total; k++)
+                    _normals[k] = glm::rotate(_normals[k], angle * _polyline.getLengthAtIndex(k) / perimeter, _tangents[k]);
+        }
+        else
+            _normals[j] = r;
+    }
+}
+
+// A ring of _resolution vertices per polyline vertex, plus a center for each cap on open lines
+void tubeTotals(const Polyline& _polyline, int _resolution, bool _caps, size_t& _vertices, size_t& _indices) {
+    size_t total = _polyline.size();
+    if (total < 2 || _resolution < 3) {
+        _vertices = _indices = 0;
+        return;
     }
 
-    //--------------------------------------------------------------------------
-    if ( !_polyline.isClosed() && _caps) {
-        for (size_t i = 0; i < _resolution-1; i++)
-            mesh.addTriangleIndices( 0, i + 2, i + 1);
-        mesh.addTriangleIndices( 0, 1, _resolution);
+    bool caps = !_polyline.isClosed() && _caps;
+    size_t sections = _polyline.isClosed() ? total : total - 1;
+    _vertices = total * _resolution + (caps ? 2 : 0);
+    _indices = sections * _resolution * 6 + (caps ? _resolution * 6 : 0);
+}
+
+// Writes the tube straight into the slots of the sink. The rings, with the section that follows
+// each, are independent of each other so long tubes are spread across threads.
+void tube(const Polyline& _polyline, const float* _array1D, int _n, int _resolution, bool _caps, SpanSink& _sink, size_t _threads) {
+    size_t verticesTotal, indicesTotal;
+    tubeTotals(_polyline, _resolution, _caps, verticesTotal, indicesTotal);
+    if (verticesTotal == 0)
+        return;
+
+    static thread_local std::vector<glm::vec3> tangents, normals;
+    static thread_local std::vector<glm::vec2> circle;
+    tubeFrames(_polyline, tangents, normals);
+
+    circle.resize(_resolution);
+    for (int j = 0; j < _resolution; j++) {
+        float a = j / (float)_resolution * TAU;
+        circle[j] = glm::vec2(cosf(a), sinf(a));
     }
-    
-    size_t numOfTubeSections = _polyline.size();
-    for (size_t y = 0; y < numOfTubeSections - 1; y++) {
+
+    const size_t total = _polyline.size();
+    const bool caps = !_polyline.isClosed() && _caps;
+    const size_t sections = _polyline.isClosed() ? total : total - 1;
+    const size_t first = caps ? 1 : 0;                                  // first vertex of the first ring
+    const size_t firstSection = caps ? _resolution * 3 : 0;             // first index of the first section
+    const size_t res = _resolution;
+
+    glm::vec3*  vertices = _sink.vertices;
+    glm::vec3*  normalsOut = _sink.normals;
+    glm::vec2*  texcoords = _sink.texcoords;
+    INDEX_TYPE* indices = _sink.indices;
+    INDEX_TYPE  offset = _sink.offset;
+
+    // other threads have their own (empty) thread_local vectors, they read these through pointers
+    const glm::vec3* t = tangents.data();
+    const glm::vec3* n = normals.data();
+    const glm::vec2* c = circle.data();
+
+    if (total * res < 8192)
+        _threads = 1;
+
+    parallelFor(total, [&](size_t _i, size_t /*_thread*/) {
+        const glm::vec3& p = _polyline.getVertices()[_i];
+        glm::vec3 b = glm::cross(t[_i], n[_i]);
+        float r = _array1D[_i % _n];
+        float v = _i / (total - 1.0f);
 
         // 2 - 3
         // | \ |
         // 0 - 1
+        size_t ring = first + _i * res;
+        for (size_t j = 0; j < res; j++) {
+            glm::vec3 d = n[_i] * c[j].x + b * c[j].y;
+            vertices[ring + j] = p + d * r;
+            normalsOut[ring + j] = d;
+            texcoords[ring + j] = glm::vec2(j / (float)res, v);
+        }
 
-        for(int x = 0; x < _resolution-1; x++) {
-            mesh.addTriangleIndices(y * _resolution + x + offset,
-                                    y * _resolution + x+1 + offset,
-                                    (y+1) * _resolution + x + offset);
-            mesh.addTriangleIndices(y*_resolution + x+1 + offset,
-                                    (y+1) * _resolution + x+1 + offset,
-                                    (y+1)*_resolution + x + offset);
+        if (_i < sections) {
+            INDEX_TYPE a0 = offset + ring;
+            INDEX_TYPE a1 = offset + first + ((_i + 1) % total) * res;
+            INDEX_TYPE* out = indices + firstSection + _i * res * 6;
+            for (size_t x = 0; x < res; x++) {
+                size_t x1 = (x + 1) % res;
+                *out++ = a0 + x;    *out++ = a0 + x1;   *out++ = a1 + x;
+                *out++ = a0 + x1;   *out++ = a1 + x1;   *out++ = a1 + x;
+            }
+        }
+    }, _threads);
+
+    if (caps) {
+        const std::vector<glm::vec3>& points = _polyline.getVertices();
+        size_t end = verticesTotal - 1;
+
+        vertices[0] = points[0];
+        normalsOut[0] = -t[0];
+        texcoords[0] = glm::vec2(0.5f, 0.0f);
+        vertices[end] = points[total - 1];
+        normalsOut[end] = t[total - 1];
+        texcoords[end] = glm::vec2(0.5f, 1.0f);
+
+        INDEX_TYPE* out = indices;
+        INDEX_TYPE* outEnd = indices + firstSection + sections * res * 6;
+        INDEX_TYPE last = offset + end - res;
+        for (size_t x = 0; x < res; x++) {
+            size_t x1 = (x + 1) % res;
+            *out++ = offset;    *out++ = offset + 1 + x1;   *out++ = offset + 1 + x;
+            *outEnd++ = offset + end;   *outEnd++ = last + x;   *outEnd++ = last + x1;
         }
+    }
 
-        mesh.addTriangleIndices(y * _resolution + (_resolution-1) + offset,
-                                y * _resolution + offset,
-                                (y+1) * _resolution + (_resolution-1) + offset);
-        mesh.addTriangleIndices(y * _resolution + offset,
-                                (y+1) * _resolution + offset,
-                                (y+1)*_resolution + (_resolution-1) + offset);
+    _sink.verticesTotal = verticesTotal;
+    _sink.indicesTotal = indicesTotal;
+}
+
+struct TubeShapes {
+    void operator()(size_t _i, CountSink& _sink) const {
+        tubeTotals(polylines[_i], resolution, caps, _sink.verticesTotal, _sink.indicesTotal);
     }
 
-    if ( !_polyline.isClosed() && _caps) {
-        size_t vertsN = mesh.getVerticesTotal();
-        mesh.addVertex(_polyline.getVertices()[_polyline.size()-1]);
-        mesh.addTexCoord( glm::vec2(.5, 1.0) );
-        mesh.addNormal( glm::normalize( _polyline.getVertices()[_polyline.size()-2] - _polyline.getVertices()[_polyline.size()-1] ) );
+    void operator()(size_t _i, SpanSink& _sink) const {
+        if (widths) {
+            float width = valueAt(*widths, _i, 1.0f);
+            tube(polylines[_i], &width, 1, resolution, caps, _sink, threads);
+        }
+        else
+            tube(polylines[_i], radii, radiiTotal, resolution, caps, _sink, threads);
+    }
 
-        for (size_t i = 0; i < _resolution; i++)
-            mesh.addTriangleIndices( vertsN, vertsN - i - 2, vertsN - i - 1);
+    const Polyline*             polylines;
+    const std::vector<float>*   widths = nullptr;   // one per tube, or
+    const float*                radii = nullptr;    // one per vertex, repeating
+    int                         radiiTotal = 0;
+    int                         resolution;
+    bool                        caps;
+    size_t                      threads = 1;        // for the rings of each tube
+};
+
+Mesh toTube(const Polyline& _polyline, const float* _array1D, int _n, int _resolution, bool _caps, size_t _threads) {
+    TubeShapes shapes;
+    shapes.polylines = &_polyline;
+    shapes.radii = _array1D;
+    shapes.radiiTotal = _n;
+    shapes.resolution = _resolution;
+    shapes.caps = _caps;
+    shapes.threads = _threads;
+    return MeshBatch::build(1, shapes, std::vector<MaterialPtr>(), nullptr, 1);
+}
 
-        mesh.addTriangleIndices( vertsN, vertsN - 1 , vertsN - _resolution);
+Mesh toTube(const std::vector<Polyline>& _polylines, const std::vector<float>& _widths, int _resolution, bool _caps, const std::vector<MaterialPtr>& _materials, std::vector<uint32_t>* _ids, size_t _threads) {
+    if (!haveValuesFor(_widths.size(), _polylines.size()) || !haveValuesFor(_materials.size(), _polylines.size())) {
+        std::cout << "ERROR: toTube() widths and materials must be one per polyline, a single one or none" << std::endl;
+        return Mesh();
     }
 
-    return mesh;
+    TubeShapes shapes;
+    shapes.polylines = _polylines.data();
+    shapes.widths = &_widths;
+    shapes.resolution = _resolution;
+    shapes.caps = _caps;
+    return MeshBatch::build(_polylines.size(), shapes, _materials, _ids, _threads);
 }
 
 std::vector<Line>   toLines(const BoundingBox& _bbox) {
@@ -503,31 +895,204 @@ std::vector<Line>   toLines(const BoundingBox& _bbox) {
     return lines;
 }
 
+// EDGES
+//
+
+inline uint64_t edgeKey(uint32_t _a, uint32_t _b) {
+    return (_a < _b) ? (uint64_t(_a) << 32 | _b) : (uint64_t(_b) << 32 | _a);
+}
+
 std::vector<Line>   toLines(const std::vector<Triangle>& _triangles) {
     std::vector<Line> lines;
-    
+    lines.reserve(_triangles.size() * 3 / 2);
+
+    // the triangles don't share vertices, so they are welded by position to find the edges they share
+    std::unordered_map<glm::vec3, uint32_t, PointHash> points;
+    std::unordered_set<uint64_t> edges;
+    points.reserve(_triangles.size() * 3);
+    edges.reserve(_triangles.size() * 3);
+
     for (size_t i = 0; i < _triangles.size(); i++) {
-        Line l1 = Line(_triangles[i][0], _triangles[i][1]);
-        Line l2 = Line(_triangles[i][1], _triangles[i][2]);
-        Line l3 = Line(_triangles[i][2], _triangles[i][0]);
-
-        if (_triangles[i].haveColors()) {
-            l1.setColor(0, _triangles[i].getColor(0));
-            l1.setColor(1, _triangles[i].getColor(1));
-            l2.setColor(0, _triangles[i].getColor(1));
-            l2.setColor(1, _triangles[i].getColor(2));
-            l3.setColor(0, _triangles[i].getColor(2));
-            l3.setColor(1, _triangles[i].getColor(0));
+        uint32_t ids[3];
+        for (int j = 0; j < 3; j++)
+            ids[j] = points.insert( std::make_pair(_triangles[i][j], uint32_t(points.size())) ).first->second;
+
+        for (int j = 0; j < 3; j++) {
+            int k = (j + 1) % 3;
+            if (!edges.insert( edgeKey(ids[j], ids[k]) ).second)
+                continue;
+
+            Line line = Line(_triangles[i][j], _triangles[i][k]);
+            if (_triangles[i].haveColors()) {
+                line.setColor(0, _triangles[i].getColor(j));
+                line.setColor(1, _triangles[i].getColor(k));
+            }
+            lines.push_back(line);
         }
-        lines.push_back(l1);
-        lines.push_back(l2);
-        lines.push_back(l3);
     }
 
-    // TODO:
-    //      - REMOVE DUPLICATES
-    //
     return lines;
 }
 
-}
\ No newline at end of file
+// An edge of the triangles of a mesh and the faces on each side
+struct MeshEdge {
+    uint32_t    a, b;
+    uint32_t    faces[2];
+    uint32_t    facesTotal;
+};
+
+// Unique edges of the triangles, found through a hash of their (sorted) vertex indices
+std::vector<MeshEdge> getMeshEdges(const Mesh& _mesh) {
+    std::vector<MeshEdge> edges;
+    if (_mesh.getFaceType() != TRIANGLES)
+        return edges;
+
+    const std::vector<INDEX_TYPE>& indices = _mesh.getFaceIndices();
+    size_t trianglesTotal = _mesh.haveFaceIndices() ? indices.size() / 3 : _mesh.getVerticesTotal() / 3;
+
+    // vertices at the same position are the same for the edges, whatever their index
+    std::vector<uint32_t> welds = getWelds(_mesh.getVertices());
+
+    edges.reserve(trianglesTotal * 3 / 2 + 1);
+    std::unordered_map<uint64_t, uint32_t> found;
+    found.reserve(trianglesTotal * 3 / 2 + 1);
+
+    for (size_t i = 0; i < trianglesTotal; i++) {
+        uint32_t ids[3];
+        for (int j = 0; j < 3; j++)
+            ids[j] = welds[ _mesh.haveFaceIndices() ? indices[i * 3 + j] : i * 3 + j ];
+
+        for (int j = 0; j < 3; j++) {
+            uint32_t a = ids[j];
+            uint32_t b = ids[(j + 1) % 3];
+            if (a == b)
+                continue;
+
+            std::pair<std::unordered_map<uint64_t, uint32_t>::iterator, bool> it = found.insert( std::make_pair(edgeKey(a, b), uint32_t(edges.size())) );
+            if (it.second) {
+                MeshEdge edge;
+                edge.a = a;
+                edge.b = b;
+                edge.faces[0] = i;
+                edge.facesTotal = 1;
+                edges.push_back(edge);
+            }
+            else {
+                MeshEdge& edge = edges[it.first->second];
+                if (edge.facesTotal < 2)
+                    edge.faces[edge.facesTotal] = i;
+                edge.facesTotal++;
+            }
+        }
+    }
+
+    return edges;
+}
+
+std::vector<glm::vec3> getFacesNormals(const Mesh& _mesh) {
+    if (_mesh.getFaceType() != TRIANGLES)
+        return std::vector<glm::vec3>();
+
+    const std::vector<INDEX_TYPE>& indices = _mesh.getFaceIndices();
+    size_t trianglesTotal = _mesh.haveFaceIndices() ? indices.size() / 3 : _mesh.getVerticesTotal() / 3;
+
+    std::vector<glm::vec3> normals(trianglesTotal);
+    for (size_t i = 0; i < trianglesTotal; i++) {
+        const glm::vec3& a = _mesh.getVertex( _mesh.haveFaceIndices() ? indices[i * 3 + 0] : i * 3 + 0 );
+        const glm::vec3& b = _mesh.getVertex( _mesh.haveFaceIndices() ? indices[i * 3 + 1] : i * 3 + 1 );
+        const glm::vec3& c = _mesh.getVertex( _mesh.haveFaceIndices() ? indices[i * 3 + 2] : i * 3 + 2 );
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float l = glm::length(n);
+        normals[i] = (l > 0.0f) ? n / l : n;
+    }
+    return normals;
+}
+
+// A mesh of LINES with the edges that pass _keep, over the vertices they use
+template<typename Keep>
+Mesh toEdges(const Mesh& _mesh, const std::vector<MeshEdge>& _edges, const Keep& _keep) {
+    Mesh mesh;
+    mesh.setEdgeType(LINES);
+
+    std::vector<uint32_t> ids(_mesh.getVerticesTotal(), uint32_t(-1));
+    for (size_t i = 0; i < _edges.size(); i++) {
+        if (!_keep(_edges[i]))
+            continue;
+
+        uint32_t ends[2] = { _edges[i].a, _edges[i].b };
+        for (int j = 0; j < 2; j++) {
+            uint32_t& id = ids[ends[j]];
+            if (id == uint32_t(-1)) {
+                id = mesh.getVerticesTotal();
+                mesh.addVertex( _mesh.getVertex(ends[j]) );
+                if (_mesh.haveColors())     mesh.addColor( _mesh.getColor(ends[j]) );
+                if (_mesh.haveNormals())    mesh.addNormal( _mesh.getNormal(ends[j]) );
+                if (_mesh.haveTexCoords())  mesh.addTexCoord( _mesh.getTexCoord(ends[j]) );
+            }
+            mesh.addEdgeIndex(id);
+        }
+    }
+
+    return mesh;
+}
+
+struct KeepAll {
+    bool operator()(const MeshEdge&) const { return true; }
+};
+
+struct KeepBoundary {
+    bool operator()(const MeshEdge& _edge) const { return _edge.facesTotal == 1; }
+};
+
+struct KeepFeature {
+    bool operator()(const MeshEdge& _edge) const {
+        if (_edge.facesTotal != 2)
+            return true;
+        return glm::dot(normals[_edge.faces[0]], normals[_edge.faces[1]]) < cosAngle;
+    }
+
+    std::vector<glm::vec3>  normals;
+    float                   cosAngle;
+};
+
+struct KeepSilhouette {
+    bool operator()(const MeshEdge& _edge) const {
+        if (_edge.facesTotal != 2)
+            return true;
+        return facing(_edge.faces[0]) != facing(_edge.faces[1]);
+    }
+
+    bool facing(uint32_t _face) const {
+        const glm::vec3& p = mesh->getVertex( mesh->haveFaceIndices() ? mesh->getFaceIndices()[_face * 3] : _face * 3 );
+        return glm::dot(normals[_face], viewPoint - p) > 0.0f;
+    }
+
+    const Mesh*             mesh;
+    std::vector<glm::vec3>  normals;
+    glm::vec3               viewPoint;
+};
+
+Mesh toEdges(const Mesh& _mesh) {
+    return toEdges(_mesh, getMeshEdges(_mesh), KeepAll());
+}
+
+Mesh toBoundaryEdges(const Mesh& _mesh) {
+    return toEdges(_mesh, getMeshEdges(_mesh), KeepBoundary());
+}
+
+Mesh toFeatureEdges(const Mesh& _mesh, float _angle) {
+    KeepFeature keep;
+    keep.normals = getFacesNormals(_mesh);
+    keep.cosAngle = cosf(_angle);
+    return toEdges(_mesh, getMeshEdges(_mesh), keep);
+}
+
+Mesh toSilhouetteEdges(const Mesh& _mesh, const glm::vec3& _viewPoint) {
+    KeepSilhouette keep;
+    keep.mesh = &_mesh;
+    keep.normals = getFacesNormals(_mesh);
+    keep.viewPoint = _viewPoint;
+    return toEdges(_mesh, getMeshEdges(_mesh), keep);
+}
+
+}
@@ -24,7 +24,7 @@ const float infinity = std::numeric_limits<float>::infinity();
 
 // http://www.geeksforgeeks.org/how-to-check-if-a-given-point-lies-inside-a-polygon/
 //
-bool inside(const std::vector<glm::vec2> _points, const glm::vec2 _v) {
+bool inside(const std::vector<glm::vec2>& _points, const glm::vec2& _v) {
     int counter = 0;
     double xinters;
     glm::vec2 p1,p2;
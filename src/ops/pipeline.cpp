@@ -0,0 +1,228 @@
+#include "hilma/ops/pipeline.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "hilma/parallel.h"
+
+namespace hilma {
+
+// Values go through the operations in chunks small enough to stay in L1, one
+// operation at a time, so each loop is simple enough for the compiler to vectorize
+const size_t CHUNK = 256;
+
+ImagePipeline& ImagePipeline::push(OpType _type, float _a, float _b) {
+    Op op;
+    op.type = _type;
+    op.a = _a;
+    op.b = _b;
+    ops.push_back(op);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::add(float _value) { return push(OP_MULTIPLY_ADD, 1.0f, _value); }
+ImagePipeline& ImagePipeline::multiply(float _value) { return push(OP_MULTIPLY_ADD, _value, 0.0f); }
+ImagePipeline& ImagePipeline::multiplyAdd(float _scale, float _offset) { return push(OP_MULTIPLY_ADD, _scale, _offset); }
+ImagePipeline& ImagePipeline::clamp(float _min, float _max) { return push(OP_CLAMP, _min, _max); }
+ImagePipeline& ImagePipeline::sqrt() { return push(OP_SQRT); }
+ImagePipeline& ImagePipeline::invert() { return push(OP_MULTIPLY_ADD, -1.0f, 1.0f); }
+ImagePipeline& ImagePipeline::gamma(float _gamma) { return push(OP_GAMMA, _gamma); }
+ImagePipeline& ImagePipeline::threshold(float _threshold) { return push(OP_THRESHOLD, _threshold); }
+ImagePipeline& ImagePipeline::autolevel() { return push(OP_AUTOLEVEL); }
+
+ImagePipeline& ImagePipeline::remap(float _in_min, float _in_max, float _out_min, float _out_max, bool _clamp) {
+    // same as hilma::remap(float, ...) folded into a single multiply add
+    if (std::fabs(_in_min - _in_max) < std::numeric_limits<float>::epsilon())
+        push(OP_MULTIPLY_ADD, 0.0f, _out_min);
+    else {
+        float scale = (_out_max - _out_min) / (_in_max - _in_min);
+        push(OP_MULTIPLY_ADD, scale, _out_min - _in_min * scale);
+    }
+
+    if (_clamp)
+        push(OP_CLAMP, std::min(_out_min, _out_max), std::max(_out_min, _out_max));
+
+    return *this;
+}
+
+void ImagePipeline::run(const std::vector<Op>& _ops, float* _values, size_t _n) {
+    for (size_t o = 0; o < _ops.size(); o++) {
+        const float a = _ops[o].a;
+        const float b = _ops[o].b;
+
+        switch (_ops[o].type) {
+            case OP_MULTIPLY_ADD:
+                for (size_t i = 0; i < _n; i++)
+                    _values[i] = _values[i] * a + b;
+                break;
+            case OP_CLAMP:
+                for (size_t i = 0; i < _n; i++)
+                    _values[i] = std::min(std::max(_values[i], a), b);
+                break;
+            case OP_SQRT:
+                for (size_t i = 0; i < _n; i++)
+                    _values[i] = std::sqrt(_values[i]);
+                break;
+            case OP_GAMMA:
+                for (size_t i = 0; i < _n; i++)
+                    _values[i] = std::pow(_values[i], a);
+                break;
+            case OP_THRESHOLD:
+                for (size_t i = 0; i < _n; i++)
+                    _values[i] = (_values[i] >= a) ? 1.0f : 0.0f;
+                break;
+            case OP_AUTOLEVEL:
+                break;
+        }
+    }
+}
+
+void ImagePipeline::bound(const Op& _op, float& _lo, float& _hi) {
+    float a = _lo;
+    float b = _hi;
+
+    switch (_op.type) {
+        case OP_MULTIPLY_ADD:
+            a = _lo * _op.a + _op.b;
+            b = _hi * _op.a + _op.b;
+            break;
+        case OP_CLAMP:
+            a = std::min(std::max(_lo, _op.a), _op.b);
+            b = std::min(std::max(_hi, _op.a), _op.b);
+            break;
+        case OP_SQRT:
+            a = std::sqrt(_lo);
+            b = std::sqrt(_hi);
+            break;
+        case OP_GAMMA:
+            // pow isn't monotonic over negatives, give up on the range (NaN) there
+            a = (_lo < 0.0f) ? std::numeric_limits<float>::quiet_NaN() : std::pow(_lo, _op.a);
+            b = std::pow(_hi, _op.a);
+            break;
+        case OP_THRESHOLD:
+        case OP_AUTOLEVEL:
+            a = 0.0f;
+            b = 1.0f;
+            break;
+    }
+
+    // NaN stays on _lo, where promote() catches it
+    _lo = (std::isnan(a) || std::isnan(b)) ? std::numeric_limits<float>::quiet_NaN() : std::min(a, b);
+    _hi = std::max(a, b);
+}
+
+void ImagePipeline::pass(Image& _image, const std::vector<Op>& _ops, bool _range, float& _lo, float& _hi, size_t _threads) {
+    if (_threads == 0)
+        _threads = getThreadsTotal();
+
+    const int width = _image.getWidth();
+    const int channels = _image.getChannels();
+    const bool raw = _image.getType() == IMAGE_FLOAT32;
+
+    // the range starts as [1, 0] like autolevel(Image&) always did
+    std::vector<float> los(_threads, 1.0f);
+    std::vector<float> his(_threads, 0.0f);
+
+    parallelFor(_image.getHeight(), [&](size_t _y, size_t _thread) {
+        float buffer[CHUNK];
+        float lo = los[_thread];
+        float hi = his[_thread];
+
+        // runs the operations over _n contiguous values
+        auto segment = [&](size_t _index, size_t _n) {
+            for (size_t start = 0; start < _n; start += CHUNK) {
+                size_t n = std::min(CHUNK, _n - start);
+
+                float* values = buffer;
+                if (raw)
+                    values = &_image[_index + start];
+                else
+                    for (size_t i = 0; i < n; i++)
+                        buffer[i] = _image.getValue(_index + start + i);
+
+                run(_ops, values, n);
+
+                if (_range)
+                    for (size_t i = 0; i < n; i++) {
+                        lo = std::min(lo, values[i]);
+                        hi = std::max(hi, values[i]);
+                    }
+
+                if (!raw && _ops.size() > 0)
+                    for (size_t i = 0; i < n; i++)
+                        _image.setValue(_index + start + i, buffer[i]);
+            }
+        };
+
+        // walk only real pixels, tiled layouts have padding
+        if (_image.getLayout() == LAYOUT_LINEAR)
+            segment(_image.getIndex(0, _y), size_t(width) * channels);
+        else if (_image.getLayout() == LAYOUT_TILED)
+            for (int x = 0; x < width; x += Image::TILE_SIZE)
+                segment(_image.getIndex(x, _y), size_t(std::min(int(Image::TILE_SIZE), width - x)) * channels);
+        else
+            for (int x = 0; x < width; x++)
+                segment(_image.getIndex(x, _y), channels);
+
+        los[_thread] = lo;
+        his[_thread] = hi;
+    }, _threads);
+
+    _lo = *std::min_element(los.begin(), los.end());
+    _hi = *std::max_element(his.begin(), his.end());
+}
+
+void ImagePipeline::apply(Image& _image, size_t _threads) const {
+    if (!_image.isAllocated())
+        return;
+
+    // follow the range of the values through the ops, 8/16-bit images start at 0-1 and can't
+    // hold more. Each pass writes back, so check before every autolevel and at the end
+    float lo = 0.0f;
+    float hi = 1.0f;
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (ops[i].type == OP_AUTOLEVEL) {
+            _image.promote(lo, hi);
+            lo = 0.0f;
+            hi = 1.0f;
+        }
+        else
+            bound(ops[i], lo, hi);
+    }
+    _image.promote(lo, hi);
+
+    std::vector<Op> stage;
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (ops[i].type != OP_AUTOLEVEL) {
+            stage.push_back(ops[i]);
+            continue;
+        }
+
+        // run what we have so far while measuring it, the normalization goes on the next pass
+        float lo, hi;
+        pass(_image, stage, true, lo, hi, _threads);
+        stage.clear();
+
+        if (hi != lo) {
+            Op op;
+            op.type = OP_MULTIPLY_ADD;
+            op.a = 1.0f / (hi - lo);
+            op.b = -lo / (hi - lo);
+            stage.push_back(op);
+        }
+    }
+
+    if (stage.size() > 0) {
+        float lo, hi;
+        pass(_image, stage, false, lo, hi, _threads);
+    }
+}
+
+Image ImagePipeline::apply(const Image& _image, size_t _threads) const {
+    Image out = _image;
+    apply(out, _threads);
+    return out;
+}
+
+}
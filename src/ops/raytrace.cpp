@@ -252,29 +252,35 @@ glm::vec3 default_rayColor(const Ray& _ray, const std::vector<Hittable>& _hittab
         float metallic = 0.0f;
         float roughtness = 1.0f;
 
+        float coneWidth = _ray.getConeWidthAt(rec.distance);
+
         if (rec.triangle != nullptr) {
-            normal = rec.triangle->getNormal(rec.barycentric);
-            diffuse = rec.triangle->getColor(rec.barycentric);
+            // pixel footprint over the surface, in UV space, to pick the texture mip levels
+            float cosine = std::max(std::abs(glm::dot(_ray.getDirection(), rec.normal)), 0.1f);
+            float footprint = coneWidth / cosine * rec.triangle->getTexCoordDensity();
+
+            normal = rec.triangle->getNormal(rec.barycentric, footprint);
+            diffuse = rec.triangle->getColor(rec.barycentric, footprint);
 
             if (rec.triangle->material != nullptr) {
-                bool haveUV = rec.triangle->haveTexCoords();
+                MaterialHandleConstPtr material = rec.triangle->material->getHandle();
                 glm::vec2 uv;
 
-                if (haveUV) uv = rec.triangle->getTexCoord(rec.barycentric);
+                if ( rec.triangle->haveTexCoords() ) uv = rec.triangle->getTexCoord(rec.barycentric);
                 // uv.x = 1.0f - uv.x;
 
-                if ( rec.triangle->material->haveProperty("emissive") )
-                    if ( haveUV ) emissive = rec.triangle->material->getColor("emissive", uv);
-                    else emissive = rec.triangle->material->getColor("emissive");
+                if ( material->have(EMISSIVE) )
+                    if ( rec.triangle->haveTexCoords() ) emissive = material->getColor(EMISSIVE, uv, footprint);
+                    else emissive = material->getColor(EMISSIVE);
                 
-                if ( rec.triangle->material->haveProperty("roughness") )
-                    roughtness = rec.triangle->material->getValue("roughness", uv);
+                if ( material->have(ROUGHNESS) )
+                    roughtness = material->getValue(ROUGHNESS, uv, footprint);
 
-                if ( rec.triangle->material->haveProperty("metallic") )
-                    metallic = rec.triangle->material->getValue("metallic", uv);
+                if ( material->have(METALLIC) )
+                    metallic = material->getValue(METALLIC, uv, footprint);
 
-                if ( rec.triangle->material->haveProperty("opacity") )
-                    opacity = rec.triangle->material->getValue("opacity", uv);
+                if ( material->have(OPACITY) )
+                    opacity = material->getValue(OPACITY, uv, footprint);
             }
         }
 
@@ -284,6 +290,7 @@ glm::vec3 default_rayColor(const Ray& _ray, const std::vector<Hittable>& _hittab
         target += random_unit_vector() * roughtness;
 
         Ray scattered(rec.position, target);
+        scattered.setCone(coneWidth, _ray.getConeSpread());
         return emissive + diffuse * default_rayColor( scattered, _hittables, _depth-1 );
     }
 
@@ -323,6 +330,7 @@ void raytrace(  Image& _image, const Camera& _cam, const std::vector<Hittable>&
     const float over_samples = 1.0f/_samplesPerPixel;
 
     const int totalPixels = image_width * image_height;
+    const float spread = _cam.getPixelSpread(image_height);
 
     std::cout << std::endl;
 
@@ -336,6 +344,7 @@ void raytrace(  Image& _image, const Camera& _cam, const std::vector<Hittable>&
                 float v = (y + randomf()) / (image_height-1);
 
                 Ray ray = _cam.getRay(u, v);
+                ray.setCone(0.0f, spread);
                 pixel_color += _rayColor(ray, _scene, _maxDepth);
             }
 
@@ -363,7 +372,8 @@ void raytrace_thread(BlockJob _job, std::vector<BlockJob>& imageBlocks, int _ny,
                     const Camera& _cam, const std::vector<Hittable>& _scene, int _maxDepth,
                     std::mutex& mutex, std::condition_variable& cv, std::atomic<int>& _completedThreads,
                     std::function<glm::vec3(const Ray&, const std::vector<Hittable>&, int)> _rayColor) {
-    
+
+    const float spread = _cam.getPixelSpread(_ny);
     for (int j = _job.rowStart; j < _job.rowEnd; ++j) {
         for (int i = 0; i < _job.colSize; ++i) {
 
@@ -373,6 +383,7 @@ void raytrace_thread(BlockJob _job, std::vector<BlockJob>& imageBlocks, int _ny,
                 float v = float(j + randomf()) / float(_ny);
 
                 Ray ray = _cam.getRay(u, v);
+                ray.setCone(0.0f, spread);
                 pixel_color += _rayColor(ray, _scene, _maxDepth);
             }
 
@@ -157,22 +157,27 @@ void rotate(Mesh& _mesh, float _rad, float _x, float _y, float _z ) {
 
 void rotateX(Polyline& _polyline, float _rad) {
     rotateX(_polyline.points, _rad);
+    _polyline.flagHasChanged();
 }
 
 void rotateY(Polyline& _polyline, float _rad) {
     rotateY(_polyline.points, _rad);
+    _polyline.flagHasChanged();
 }
 
 void rotateZ(Polyline& _polyline, float _rad) {
     rotateZ(_polyline.points, _rad);
+    _polyline.flagHasChanged();
 }
 
 void rotate(Polyline& _polyline, float _rad, const glm::vec3& _axis ) {
     rotate(_polyline.points, _rad, _axis);
+    _polyline.flagHasChanged();
 }
 
 void rotate(Polyline& _polyline, float _rad, float _x, float _y, float _z ) {
     rotate(_polyline.points, _rad, _x, _y, _z);
+    _polyline.flagHasChanged();
 }
 
 void scale(Polygon& _polygon, float _v) {
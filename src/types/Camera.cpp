@@ -41,4 +41,12 @@ Ray Camera::getRay(float s, float t) const {
     );
 }
 
-}
\ No newline at end of file
+float Camera::getPixelSpread(int _height) const {
+    glm::vec3 center = lower_left_corner + 0.5f * horizontal + 0.5f * vertical;
+    float focus_dist = glm::length(center - origin);
+    if (_height <= 0 || focus_dist <= 0.0f)
+        return 0.0f;
+    return glm::length(vertical) / (focus_dist * _height);
+}
+
+}
@@ -1,31 +1,104 @@
 #include <iostream>
 #include <stdio.h>
 #include <cstring>
+#include <mutex>
+#include <algorithm>
 
 #include "hilma/types/Image.h"
 #include "hilma/math.h"
+#include "hilma/parallel.h"
 
 namespace hilma {
 
-Image::Image(): name("undefined"), width(0), height(0), channels(0) {
+const size_t TILE_BITS = 6;  // 1 << TILE_BITS == Image::TILE_SIZE
+const size_t ELEMENTS_CHUNK = 1 << 16;
+
+struct Image::Mips {
+    std::mutex                  mutex;
+    std::vector<ImageConstPtr>  levels;
+};
+
+// IEEE 754 half float conversions (no denormals on the way in, they flush to zero)
+static uint16_t toHalf(float _value) {
+    uint32_t f;
+    std::memcpy(&f, &_value, sizeof(float));
+
+    uint32_t sign = (f >> 16) & 0x8000;
+    int32_t exponent = int32_t((f >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = f & 0x7fffff;
+
+    if (((f >> 23) & 0xff) == 0xff)
+        return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if (exponent <= 0)
+        return uint16_t(sign);
+    if (exponent >= 31)
+        return uint16_t(sign | 0x7c00);
+
+    // round to nearest
+    uint32_t h = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+        h++;
+    return uint16_t(h);
+}
+
+static float fromHalf(uint16_t _value) {
+    uint32_t sign = uint32_t(_value & 0x8000) << 16;
+    uint32_t exponent = (_value >> 10) & 0x1f;
+    uint32_t mantissa = _value & 0x3ff;
+
+    uint32_t f;
+    if (exponent == 0) {
+        if (mantissa == 0)
+            f = sign;
+        else {
+            // denormal, normalize it
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400) == 0) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            f = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    }
+    else if (exponent == 0x1f)
+        f = sign | 0x7f800000 | (mantissa << 13);
+    else
+        f = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+    float rta;
+    std::memcpy(&rta, &f, sizeof(float));
+    return rta;
+}
+
+// spreads the lower 8 bits of _v over the even bits
+static size_t part1by1(size_t _v) {
+    _v &= 0xff;
+    _v = (_v | (_v << 4)) & 0x0f0f;
+    _v = (_v | (_v << 2)) & 0x3333;
+    _v = (_v | (_v << 1)) & 0x5555;
+    return _v;
+}
+
+Image::Image(): name("undefined"), width(0), height(0), channels(0), tilesX(0), type(IMAGE_FLOAT32), layout(LAYOUT_LINEAR) {
 }
 
 Image::Image(const Image& _mother): name("undefined") {
-    width = _mother.width;
-    height = _mother.height;
-    channels = _mother.channels;
+    *this = _mother;
+    name = "undefined";
+}
 
-    int total = width * height * channels;
-    if (_mother.isAllocated()) {
-        data.resize(total);
-        std::memcpy(&data[0], &_mother.data[0], total * sizeof(float));
-    }
+Image::Image(Image&& _mother): name("undefined") {
+    *this = std::move(_mother);
 }
 
 Image::Image(int _width, int _height, int _channels): name("undefined") {
     allocate(_width, _height, _channels);
 }
 
+Image::Image(int _width, int _height, int _channels, ImageType _type, ImageLayout _layout): name("undefined") {
+    allocate(_width, _height, _channels, _type, _layout);
+}
+
 // bool Image::loadData(const uint8_t* _array3D, int _height, int _width, int _channels) {
 Image::Image(const uint8_t* _array3D, int _height, int _width, int _channels): name("undefined") {
     set(_array3D, _height, _width, _channels);
@@ -34,54 +107,203 @@ Image::Image(const uint8_t* _array3D, int _height, int _width, int _channels): n
 Image::~Image() {
 }
 
+Image& Image::operator= (const Image& _mother) {
+    if (this == &_mother)
+        return *this;
+
+    width = _mother.width;
+    height = _mother.height;
+    channels = _mother.channels;
+    tilesX = _mother.tilesX;
+    type = _mother.type;
+    layout = _mother.layout;
+    data = _mother.data;
+    bytes = _mother.bytes;
+    name = _mother.name;
+
+    // the mips belong to the other image pixels
+    mips = nullptr;
+
+    return *this;
+}
+
+Image& Image::operator= (Image&& _mother) {
+    if (this == &_mother)
+        return *this;
+
+    width = _mother.width;
+    height = _mother.height;
+    channels = _mother.channels;
+    tilesX = _mother.tilesX;
+    type = _mother.type;
+    layout = _mother.layout;
+    data = std::move(_mother.data);
+    bytes = std::move(_mother.bytes);
+    name = std::move(_mother.name);
+
+    // pixels move, so the mips can go along with them
+    mips = std::atomic_exchange(&_mother.mips, std::shared_ptr<Mips>());
+
+    _mother.width = _mother.height = _mother.channels = _mother.tilesX = 0;
+
+    return *this;
+}
+
+size_t Image::getTypeSize(ImageType _type) {
+    if (_type == IMAGE_UINT8)
+        return 1;
+    else if (_type == IMAGE_UINT16 || _type == IMAGE_FLOAT16)
+        return 2;
+    return 4;
+}
+
 bool Image::allocate(size_t _width, size_t _height, size_t _channels) {
+    return allocate(_width, _height, _channels, IMAGE_FLOAT32, LAYOUT_LINEAR);
+}
+
+bool Image::allocate(size_t _width, size_t _height, size_t _channels, ImageType _type, ImageLayout _layout) {
     width = _width;
     height = _height;
     channels = _channels;
-    // data = new float[_width * _height * _channels];
-    int total = _width * _height * _channels;
+    type = _type;
+    layout = _layout;
+    mips = nullptr;
+
+    size_t pixels = _width * _height;
+    tilesX = 0;
+    if (layout != LAYOUT_LINEAR) {
+        tilesX = (_width + TILE_SIZE - 1) / TILE_SIZE;
+        size_t tilesY = (_height + TILE_SIZE - 1) / TILE_SIZE;
+        pixels = tilesX * tilesY * TILE_SIZE * TILE_SIZE;
+    }
+    size_t total = pixels * _channels;
 
-    if (total != data.size())
-        data.resize(total);
+    if (type == IMAGE_FLOAT32) {
+        std::vector<uint8_t>().swap(bytes);
+        if (total != data.size())
+            data.resize(total);
+    }
+    else {
+        std::vector<float>().swap(data);
+        if (total * getTypeSize(type) != bytes.size())
+            bytes.resize(total * getTypeSize(type));
+    }
 
     return true;
 }
 
+void Image::convert(ImageType _type, ImageLayout _layout) {
+    if (_type == type && _layout == layout)
+        return;
+
+    Image out(width, height, channels, _type, _layout);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++) {
+            size_t src = getIndex(x, y);
+            size_t dst = out.getIndex(x, y);
+            for (int c = 0; c < channels; c++)
+                out.setElement(dst + c, getElement(src + c));
+        }
+
+    out.name = name;
+    *this = out;
+}
+
+void Image::promote(float _min, float _max) {
+    // written this way so NaN bounds also promote
+    if ((type == IMAGE_UINT8 || type == IMAGE_UINT16) && !(_min >= 0.0f && _max <= 1.0f))
+        convert(IMAGE_FLOAT32, layout);
+}
+
+size_t Image::getTiledIndex(size_t _x, size_t _y) const {
+    size_t tile = (_y >> TILE_BITS) * tilesX + (_x >> TILE_BITS);
+    size_t x = _x & (TILE_SIZE - 1);
+    size_t y = _y & (TILE_SIZE - 1);
+
+    size_t offset = (layout == LAYOUT_MORTON) ? (part1by1(x) | (part1by1(y) << 1)) : (y * TILE_SIZE + x);
+    return ((tile << (TILE_BITS * 2)) + offset) * channels;
+}
+
+float Image::getElement(size_t _index) const {
+    if (type == IMAGE_FLOAT32)
+        return data[_index];
+    else if (type == IMAGE_UINT8)
+        return bytes[_index] / 255.0f;
+
+    uint16_t v;
+    std::memcpy(&v, &bytes[_index * 2], 2);
+    if (type == IMAGE_UINT16)
+        return v / 65535.0f;
+    return fromHalf(v);
+}
+
+void Image::setElement(size_t _index, float _value) {
+    if (type == IMAGE_FLOAT32)
+        data[_index] = _value;
+    else if (type == IMAGE_UINT8)
+        bytes[_index] = static_cast<uint8_t>(clamp(_value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    else {
+        uint16_t v;
+        if (type == IMAGE_UINT16)
+            v = static_cast<uint16_t>(clamp(_value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+        else
+            v = toHalf(_value);
+        std::memcpy(&bytes[_index * 2], &v, 2);
+    }
+}
+
 void Image::set(const uint8_t* _array3D, int _height, int _width, int _channels) {
-    allocate(_width, _height, _channels);
-    int total = width * height * channels;
-    data.resize(total);
-    for (int i = 0; i < total; i++)
-        data[i] = _array3D[i]/255.0f;
+    allocate(_width, _height, _channels, IMAGE_UINT8, LAYOUT_LINEAR);
+    std::memcpy(&bytes[0], _array3D, size_t(width) * height * channels);
 }
 
 void Image::setValue(size_t _index, float _data) {
-    if (data.size() == 0) {
+    if (!isAllocated()) {
         std::cout << "Data have been not pre allocated" << std::endl;
         return;
     }
-    data[_index] = _data; 
+    setElement(_index, _data);
 }
 
 void Image::setValue(size_t _index, const float* _array1D, int _n) {
-    if (data.size() == 0) {
+    if (!isAllocated()) {
         std::cout << "Data have been not pre allocated" << std::endl;
         return;
     }
 
-    std::memcpy(&data[_index], _array1D, _n * sizeof(float));
+    if (type == IMAGE_FLOAT32)
+        std::memcpy(&data[_index], _array1D, _n * sizeof(float));
+    else
+        for (int i = 0; i < _n; i++)
+            setElement(_index + i, _array1D[i]);
 }
 
 void Image::setColors(const float* _array2D, int _m, int _n) {
-    std::memcpy(&data[0], _array2D, _m * _n * sizeof(float));
+    if (type == IMAGE_FLOAT32 && layout == LAYOUT_LINEAR) {
+        std::memcpy(&data[0], _array2D, _m * _n * sizeof(float));
+        return;
+    }
+
+    // _m pixels of _n channels each, in rows
+    for (int i = 0; i < _m; i++)
+        setValue(getIndex(i % width, i / width), &_array2D[i * _n], std::min(_n, channels));
 }
 
 // To numpy https://numpy.org/devdocs/reference/swig.interface-file.html
 void Image::get(uint8_t **_array3D, int *_height, int *_width, int *_channels) {
     int total = width * height * channels;
     uint8_t * pixels = new uint8_t[total];
-    for (int i = 0; i < total; i++)
-        pixels[i] = static_cast<uint8_t>(256 * clamp(data[i], 0.0, 0.999));
+    if (type == IMAGE_UINT8 && layout == LAYOUT_LINEAR)
+        std::memcpy(pixels, &bytes[0], total);
+    else {
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++) {
+                size_t src = getIndex(x, y);
+                size_t dst = (y * width + x) * channels;
+                for (int c = 0; c < channels; c++)
+                    pixels[dst + c] = static_cast<uint8_t>(256 * clamp(getElement(src + c), 0.0, 0.999));
+            }
+    }
 
     *_array3D = pixels;
     *_height = height;
@@ -90,74 +312,148 @@ void Image::get(uint8_t **_array3D, int *_height, int *_width, int *_channels) {
 }
 
 float Image::getValue(size_t _index) const {
-    if (data.size() == 0)
+    if (!isAllocated())
         return 0.0f;
 
-    return data[_index];
+    return getElement(_index);
 }
 
 glm::vec4 Image::getColor(size_t _index) const {
     glm::vec4 rta = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
-    if (data.size() == 0)
+    if (!isAllocated())
         return rta;
 
     for (size_t i = 0; i < channels; i++)
-        rta[i] = data[_index + i];
+        rta[i] = getElement(_index + i);
 
     return rta;
 }
 
+size_t Image::getMipsTotal() const {
+    size_t total = 0;
+    for (int w = width, h = height; w > 1 || h > 1; w = std::max(1, w / 2), h = std::max(1, h / 2))
+        total++;
+    return total;
+}
+
+ImageConstPtr Image::getMip(size_t _level) const {
+    if (_level == 0 || _level > getMipsTotal() || !isAllocated())
+        return nullptr;
+
+    std::shared_ptr<Mips> chain = std::atomic_load(&mips);
+    if (chain == nullptr) {
+        std::shared_ptr<Mips> fresh = std::make_shared<Mips>();
+        if (std::atomic_compare_exchange_strong(&mips, &chain, fresh))
+            chain = fresh;
+    }
+
+    std::lock_guard<std::mutex> lock(chain->mutex);
+
+    // each level halves the previous one averaging 2x2 blocks, clamping on odd edges
+    while (chain->levels.size() < _level) {
+        const Image& src = chain->levels.size() == 0 ? *this : *chain->levels.back();
+        int dstW = std::max(1, src.width / 2);
+        int dstH = std::max(1, src.height / 2);
+
+        ImagePtr level = std::make_shared<Image>(dstW, dstH, channels, type, layout);
+        for (int y = 0; y < dstH; y++) {
+            int y0 = std::min(y * 2, src.height - 1);
+            int y1 = std::min(y * 2 + 1, src.height - 1);
+
+            for (int x = 0; x < dstW; x++) {
+                int x0 = std::min(x * 2, src.width - 1);
+                int x1 = std::min(x * 2 + 1, src.width - 1);
+
+                size_t i00 = src.getIndex(x0, y0);
+                size_t i10 = src.getIndex(x1, y0);
+                size_t i01 = src.getIndex(x0, y1);
+                size_t i11 = src.getIndex(x1, y1);
+                size_t index = level->getIndex(x, y);
+
+                for (int c = 0; c < channels; c++)
+                    level->setElement(index + c, ( src.getElement(i00 + c) + src.getElement(i10 + c) +
+                                                   src.getElement(i01 + c) + src.getElement(i11 + c) ) * 0.25f);
+            }
+        }
+
+        level->name = name;
+        chain->levels.push_back(level);
+    }
+
+    return chain->levels[_level - 1];
+}
+
+void Image::clearMips() {
+    std::atomic_store(&mips, std::shared_ptr<Mips>());
+}
+
 Image Image::operator+ (float _value) const {
     Image out = Image(*this);
-    for (size_t i = 0; i < out.data.size(); i++)
-        out.data[i] = data[i] + _value;
+    out += _value;
     return out;
 }
 
 Image Image::operator- (float _value) const {
     Image out = Image(*this);
-    for (size_t i = 0; i < out.data.size(); i++)
-        out.data[i] = data[i] - _value;
+    out -= _value;
     return out;
 }
 
 Image Image::operator* (float _value) const {
     Image out = Image(*this);
-    for (size_t i = 0; i < out.data.size(); i++)
-        out.data[i] = data[i] * _value;
+    out *= _value;
     return out;
 }
 
 Image Image::operator/ (float _value) const {
     Image out = Image(*this);
-    for (size_t i = 0; i < out.data.size(); i++)
-        out.data[i] = data[i] / _value;
+    out /= _value;
     return out;
 }
 
+template<typename F>
+void Image::forEachElement(F _op) {
+    const size_t total = size();
+    const size_t chunks = (total + ELEMENTS_CHUNK - 1) / ELEMENTS_CHUNK;
+
+    parallelFor(chunks, [&](size_t _chunk, size_t /*_thread*/) {
+        size_t start = _chunk * ELEMENTS_CHUNK;
+        size_t end = std::min(start + ELEMENTS_CHUNK, total);
+
+        if (type == IMAGE_FLOAT32) {
+            float* values = &data[0];
+            for (size_t i = start; i < end; i++)
+                values[i] = _op(values[i]);
+        }
+        else
+            for (size_t i = start; i < end; i++)
+                setElement(i, _op(getElement(i)));
+    });
+}
+
 Image& Image::operator+= (float _value) {
-    for (size_t i = 0; i < data.size(); i++)
-        data[i] = data[i] + _value;
+    promote(_value, 1.0f + _value);
+    forEachElement([_value](float _v) { return _v + _value; });
     return *this;
 }
 
 Image& Image::operator-= (float _value) {
-    for (size_t i = 0; i < data.size(); i++)
-        data[i] = data[i] - _value;
+    promote(-_value, 1.0f - _value);
+    forEachElement([_value](float _v) { return _v - _value; });
     return *this;
 }
 
 Image& Image::operator*= (float _value) {
-    for (size_t i = 0; i < data.size(); i++)
-        data[i] = data[i] * _value;
+    promote(std::min(0.0f, _value), std::max(0.0f, _value));
+    forEachElement([_value](float _v) { return _v * _value; });
     return *this;
 }
 
 Image& Image::operator/= (float _value) {
-    for (size_t i = 0; i < data.size(); i++)
-        data[i] = data[i] / _value;
+    promote(std::min(0.0f, 1.0f / _value), std::max(0.0f, 1.0f / _value));
+    forEachElement([_value](float _v) { return _v / _value; });
     return *this;
 }
 
-}
\ No newline at end of file
+}
@@ -1,10 +1,31 @@
 #include "hilma/types/Material.h"
+#include "hilma/types/TextureCache.h"
 
 #include "hilma/io/auto.h"
 #include "hilma/fs.h"
 
+#include <atomic>
+
 namespace hilma {
 
+static const char* slotNames[MATERIAL_SLOTS_TOTAL] = {
+    "diffuse", "specular", "emissive", "roughness", "metallic",
+    "opacity", "occlusion", "normalmap", "bumpmap", "displacementmap"
+};
+
+std::string toString(MaterialSlot _slot) {
+    if (_slot < MATERIAL_SLOTS_TOTAL)
+        return slotNames[_slot];
+    return "";
+}
+
+MaterialSlot toMaterialSlot(const std::string& _property) {
+    for (int i = 0; i < MATERIAL_SLOTS_TOTAL; i++)
+        if (_property == slotNames[i])
+            return MaterialSlot(i);
+    return MATERIAL_SLOTS_TOTAL;
+}
+
 Material::Material(const std::string& _name): illuminationModel(0), name(_name) {
 }
 
@@ -13,18 +34,18 @@ void Material::set(const std::string& _property, const Image& _image) {
     ImagePtr image = std::make_shared<Image>( _image );
     textures[_property] = image;
     properties[_property] = TEXTURE;
+    handle = nullptr;
 }
 
 void Material::set(const std::string& _property, const std::string& _filename) {
     texturesPaths[_property] = _filename;
 
+    // decoded on the background, shared with any other material using the same file
     if ( urlExists(_filename) ) {
-        ImagePtr image = std::make_shared<Image>( Image() );
-
-        if (load(_filename, *image)) {
-            textures[_property] = image;
-            properties[_property] = TEXTURE;
-        }
+        TextureCache::instance().prefetch(_filename);
+        textures.erase(_property);
+        properties[_property] = TEXTURE;
+        handle = nullptr;
     }
 }
 
@@ -35,21 +56,25 @@ void Material::set(const std::string& _property, const float* _array1D, int _n)
     
     colors[_property] = color;
     properties[_property] = COLOR;
+    handle = nullptr;
 }
 
 void Material::set(const std::string& _property, const glm::vec3& _color) {
     colors[_property] = glm::vec4(_color, 1.0f);
     properties[_property] = COLOR;
+    handle = nullptr;
 }
 
 void Material::set(const std::string& _property, const glm::vec4& _color){
     colors[_property] = _color;
     properties[_property] = COLOR;
+    handle = nullptr;
 }
 
 void Material::set(const std::string& _property, const float _value) {
     values[_property] = _value;
     properties[_property] = VALUE;
+    handle = nullptr;
 }
 
 std::string Material::getImagePath(const std::string& _property) const {
@@ -60,29 +85,41 @@ std::string Material::getImagePath(const std::string& _property) const {
     return "";
 }
 
-// ImagePtr Material::getImage(const std::string& _property) {
-//     const std::map<const std::string, ImagePtr>::const_iterator it = textures.find(_property);
-//     if (it != textures.end() )
-//         return it->second;
+ImagePtr Material::getImagePtr(const std::string& _property) const {
+    const std::map<const std::string, ImagePtr>::const_iterator it = textures.find(_property);
+    if (it != textures.end() )
+        return it->second;
 
-//     return nullptr;
-// }
+    const std::map<const std::string, MaterialPropertyType>::const_iterator prop = properties.find(_property);
+    if (prop != properties.end() && prop->second == TEXTURE) {
+        std::string path = getImagePath(_property);
+        if (path.size() > 0)
+            return TextureCache::instance().get(path);
+    }
+
+    return nullptr;
+}
 
 Image Material::getImage(const std::string& _property) const {
-    const std::map<const std::string, ImagePtr>::const_iterator it = textures.find(_property);
-    if (it != textures.end() )
-        return *it->second;
+    ImagePtr image = getImagePtr(_property);
+    if (image)
+        return *image;
 
     Image none;
     return none;
 }
 
 glm::vec4 Material::getColor(const std::string& _property, const glm::vec2& _uv) const {
+    MaterialSlot slot = toMaterialSlot(_property);
+    if (slot != MATERIAL_SLOTS_TOTAL)
+        return getHandle()->getColor(slot, _uv);
+
     if (haveProperty(_property)) {
         MaterialPropertyType type = properties.find(_property)->second;
         if (type == TEXTURE) {
-            const ImagePtr tex = textures.find(_property)->second;
-            return tex->getColor( tex->getIndexUV(_uv.x, _uv.y) );
+            const ImagePtr tex = getImagePtr(_property);
+            if (tex)
+                return Texture(tex, WRAP_REPEAT, FILTER_NEAREST).sample(_uv);
         }
         else if (type == COLOR)
             return colors.find(_property)->second;
@@ -106,11 +143,16 @@ glm::vec4 Material::getColor(const std::string& _property) const {
 }
 
 float Material::getValue(const std::string& _property, const glm::vec2& _uv) const {
+    MaterialSlot slot = toMaterialSlot(_property);
+    if (slot != MATERIAL_SLOTS_TOTAL)
+        return getHandle()->getValue(slot, _uv);
+
     if (haveProperty(_property)) {
         MaterialPropertyType type = properties.find(_property)->second;
         if (type == TEXTURE) {
-            const ImagePtr tex = textures.find(_property)->second;
-            return tex->getColor( tex->getIndexUV( _uv.x, _uv.y ) )[0];
+            const ImagePtr tex = getImagePtr(_property);
+            if (tex)
+                return Texture(tex, WRAP_REPEAT, FILTER_NEAREST).sample(_uv)[0];
         }
         else if (type == COLOR)
             return colors.find(_property)->second.x;
@@ -137,4 +179,58 @@ bool Material::haveProperty(const std::string& _property) const {
     return properties.find(_property) != properties.end();
 }
 
-}
\ No newline at end of file
+MaterialHandleConstPtr Material::getHandle() const {
+    MaterialHandleConstPtr rta = std::atomic_load(&handle);
+    if (rta == nullptr) {
+        // two threads could race to build it, both results are the same
+        rta = std::make_shared<MaterialHandle>(*this);
+        std::atomic_store(&handle, rta);
+    }
+    return rta;
+}
+
+MaterialHandle::MaterialHandle(const Material& _material, TextureWrap _wrap, TextureFilter _filter) {
+    for (int i = 0; i < MATERIAL_SLOTS_TOTAL; i++) {
+        std::string property = slotNames[i];
+        std::map<std::string, MaterialPropertyType>::const_iterator it = _material.properties.find(property);
+        if (it == _material.properties.end())
+            continue;
+
+        Slot& slot = slots[i];
+        slot.type = it->second;
+        if (slot.type == TEXTURE) {
+            ImagePtr image = _material.getImagePtr(property);
+            if (image == nullptr)
+                continue;
+            slot.texture = Texture(image, _wrap, _filter);
+        }
+        else
+            slot.color = _material.getColor(property);
+
+        slot.defined = true;
+    }
+}
+
+glm::vec4 MaterialHandle::getColor(MaterialSlot _slot, const glm::vec2& _uv, float _footprint) const {
+    const Slot& slot = slots[_slot];
+    if (slot.defined && slot.type == TEXTURE)
+        return slot.texture.sample(_uv, _footprint);
+    return slot.color;
+}
+
+float MaterialHandle::getValue(MaterialSlot _slot, const glm::vec2& _uv, float _footprint) const {
+    return getColor(_slot, _uv, _footprint)[0];
+}
+
+glm::vec4 MaterialHandle::getColor(MaterialSlot _slot) const {
+    const Slot& slot = slots[_slot];
+    if (slot.defined && slot.type != TEXTURE)
+        return slot.color;
+    return glm::vec4(-1.0f);
+}
+
+float MaterialHandle::getValue(MaterialSlot _slot) const {
+    return getColor(_slot)[0];
+}
+
+}
@@ -1,9 +1,12 @@
 #include <iostream>
 #include <map>
+#include <unordered_set>
 
 #include "hilma/types/Mesh.h"
 #include "hilma/text.h"
 
+#include "weld.h"
+
 using namespace hilma;
 
 Mesh::Mesh() : name("undefined"), faceMode(TRIANGLES), edgeMode(LINES) {
@@ -38,6 +41,15 @@ void Mesh::clear() {
     if (!edgeIndices.empty()) edgeIndices.clear();
 }
 
+void Mesh::reserve(size_t _vertices, size_t _faceIndices, bool _normals, bool _texcoords) {
+    vertices.reserve(_vertices);
+    if (_normals)
+        normals.reserve(_vertices);
+    if (_texcoords)
+        texcoords.reserve(_vertices);
+    faceIndices.reserve(_faceIndices);
+}
+
 void Mesh::append(const Mesh& _mesh) {
     int vertexIndexOffset = (int)vertices.size();
 
@@ -117,6 +129,13 @@ void Mesh::addVertex(const float* _data, int _n) {
 }
 
 void Mesh::addVertices(const float* _data, int _m, int _n) {
+    if (_n == 3) {
+        const glm::vec3* data = reinterpret_cast<const glm::vec3*>(_data);
+        vertices.insert(vertices.end(), data, data + _m);
+        return;
+    }
+
+    vertices.reserve(vertices.size() + _m);
     for (int i = 0; i < _m; i++)
         addVertex(&_data[i*_n], _n);
 }
@@ -157,6 +176,13 @@ void Mesh::addColor(float _r, float _g, float _b, float _a) {
 }
 
 void Mesh::addColors(const float* _data, int _m, int _n) {
+    if (_n == 4) {
+        const glm::vec4* data = reinterpret_cast<const glm::vec4*>(_data);
+        colors.insert(colors.end(), data, data + _m);
+        return;
+    }
+
+    colors.reserve(colors.size() + _m);
     for (int i = 0; i < _m; i++)
         addColor(&_data[i*_n], _n);
 }
@@ -178,6 +204,13 @@ void Mesh::addNormal(float _nX, float _nY, float _nZ) {
 }
 
 void Mesh::addNormals(const float* _data, int _m, int _n) {
+    if (_n == 3) {
+        const glm::vec3* data = reinterpret_cast<const glm::vec3*>(_data);
+        normals.insert(normals.end(), data, data + _m);
+        return;
+    }
+
+    normals.reserve(normals.size() + _m);
     for (int i = 0; i < _m; i++)
         addNormal(&_data[i*_n], _n);
 }
@@ -199,6 +232,13 @@ void Mesh::addTexCoord(float _tX, float _tY) {
 
 
 void Mesh::addTexCoords(const float* _data, int _m, int _n) {
+    if (_n == 2) {
+        const glm::vec2* data = reinterpret_cast<const glm::vec2*>(_data);
+        texcoords.insert(texcoords.end(), data, data + _m);
+        return;
+    }
+
+    texcoords.reserve(texcoords.size() + _m);
     for (int i = 0; i < _m; i++)
         addTexCoord(&_data[i*_n], _n);
 }
@@ -699,8 +739,29 @@ void Mesh::setEdgeType(EdgeType _mode, bool _compute) {
         edgeIndices.clear();
 
         if (_mode == LINES) {
-            for (size_t j = 0; j < vertices.size(); j += 2)
-                addEdgeIndices(j, j + 1);
+            if (haveFaceIndices() && getFaceType() == TRIANGLES) {
+                // every edge of the triangles once, the shared ones are found by the sorted indices
+                // of their welded vertices, so seams and triangle soups share them too
+                std::vector<uint32_t> welds = getWelds(vertices);
+                std::unordered_set<uint64_t> found;
+                found.reserve(faceIndices.size());
+                edgeIndices.reserve(faceIndices.size());
+                for (size_t i = 0; i + 2 < faceIndices.size(); i += 3) {
+                    for (int k = 0; k < 3; k++) {
+                        INDEX_TYPE a = faceIndices[i + k];
+                        INDEX_TYPE b = faceIndices[i + (k + 1) % 3];
+                        uint64_t wa = welds[a];
+                        uint64_t wb = welds[b];
+                        uint64_t key = (wa < wb) ? (wa << 32 | wb) : (wb << 32 | wa);
+                        if (wa != wb && found.insert(key).second)
+                            addEdgeIndices(a, b);
+                    }
+                }
+            }
+            else {
+                for (size_t j = 0; j + 1 < vertices.size(); j += 2)
+                    addEdgeIndices(j, j + 1);
+            }
         }
     }
 }
@@ -709,7 +770,7 @@ std::vector<glm::ivec2> Mesh::getLinesIndices() const {
     std::vector<glm::ivec2> lines;
 
     if (getEdgeType() == LINES) {
-        if (haveFaceIndices()) {
+        if (haveEdgeIndices()) {
             for (size_t j = 0; j < edgeIndices.size(); j += 2) {
                 glm::ivec2 line;
                 for (int k = 0; k < 2; k++)
@@ -718,7 +779,7 @@ std::vector<glm::ivec2> Mesh::getLinesIndices() const {
             }
         }
         else {
-            for (size_t j = 0; j < vertices.size(); j += 2) {
+            for (size_t j = 0; j + 1 < vertices.size(); j += 2) {
                 glm::ivec2 line;
                 for (int k = 0; k < 2; k++)
                     line[k] = j+k;
@@ -731,10 +792,11 @@ std::vector<glm::ivec2> Mesh::getLinesIndices() const {
 }
 
 std::vector<Line> Mesh::getLinesEdges() const {
-    std::vector<glm::ivec2> linesIndices;
+    std::vector<glm::ivec2> linesIndices = getLinesIndices();
     std::vector<Line> lines;
+    lines.reserve(linesIndices.size());
 
-    for (std::vector<glm::ivec2>::iterator it = linesIndices.begin(); it != linesIndices.end(); ++it)
+    for (std::vector<glm::ivec2>::const_iterator it = linesIndices.begin(); it != linesIndices.end(); ++it)
         lines.push_back( Line(vertices[it->x], vertices[it->y]) );
 
     return lines;
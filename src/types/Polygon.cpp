@@ -1,5 +1,7 @@
 #include "hilma/types/Polygon.h"
 
+#include "hilma/accel/PolygonGrid.h"
+
 namespace hilma {
 
 Polygon::Polygon() {
@@ -18,10 +20,12 @@ Polygon::Polygon( const std::vector< std::vector<glm::vec3> >& _polygon ) {
 }
 
 void Polygon::append( const Polyline& _poly ) {
+    grid.reset();
     data.push_back(_poly);
 }
 
 void Polygon::append( const Polygon& _poly ) {
+    grid.reset();
     for (size_t i = 0; i < _poly.size(); i++)
         data.push_back(_poly[i]);
 }
@@ -36,4 +40,22 @@ void Polygon::append( const std::vector< std::vector<glm::vec3> >& _polygon ) {
         append( Polyline(_polygon[i]) );
 }
 
+const PolygonGrid& Polygon::getGrid() const {
+    if (grid == nullptr)
+        grid = std::make_shared<PolygonGrid>(*this);
+    return *grid;
+}
+
+bool Polygon::inside(const glm::vec2& _point) const {
+    return getGrid().inside(_point);
+}
+
+glm::vec2 Polygon::getClosestPoint(const glm::vec2& _point) const {
+    return getGrid().getClosestPoint(_point);
+}
+
+float Polygon::getDistance(const glm::vec2& _point, bool _signed) const {
+    return getGrid().getDistance(_point, _signed);
+}
+
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 
+#include <algorithm>
+
 using namespace hilma;
 
 //----------------------------------------------------------
@@ -174,6 +176,7 @@ bool Polyline::hasChanged(){
 void Polyline::flagHasChanged() {
     bHasChanged = true;
     bCacheIsDirty = true;
+    bLengthsAreDirty = true;
 }
 
 //----------------------------------------------------------
@@ -433,7 +436,7 @@ float Polyline::getPerimeter() const {
         return 0;
     }
     else {
-        updateCache();
+        updateLengths();
         return lengths.back();
     }
 }
@@ -486,16 +489,20 @@ Polyline Polyline::getSmoothed(int smoothingSize, float smoothingShape) const {
 
 //----------------------------------------------------------
 Polyline Polyline::getResampledBySpacing(float spacing) const {
-    if (spacing==0 || size() == 0) return *this;
-    Polyline poly;
+    if (spacing <= 0 || size() == 0) return *this;
     float totalLength = getPerimeter();
-    float f=0;
-    for (f=0; f<=totalLength; f += spacing) {
-        poly.lineTo(getPointAtLength(f));
-    }
+
+    std::vector<float> samples;
+    samples.reserve(size_t(totalLength / spacing) + 1);
+    for (float f = 0; f <= totalLength; f += spacing)
+        samples.push_back(f);
+
+    // the samples go forward, so they are all found in one walk over the segments
+    Polyline poly;
+    poly.addVertices(getPointsAtLengths(samples));
     
     if (!isClosed()) {
-        if ( f != totalLength ){
+        if ( samples.back() != totalLength ){
             poly.lineTo(points.back());
         }
         poly.setClosed(false);
@@ -822,35 +829,23 @@ glm::vec3 Polyline::getRightVector() const {
 //--------------------------------------------------
 float Polyline::getIndexAtLength(float length) const {
     if (points.size() < 2) return 0;
-    updateCache();
-    
-    float totalLength = getPerimeter();
-    length = clamp(length, 0, totalLength);
-    
-    int lastPointIndex = isClosed() ? points.size() : points.size()-1;
-    
-    int i1 = clamp(floor(length / totalLength * lastPointIndex), 0, lengths.size()-2);   // start approximation here
-    int leftLimit = 0;
-    int rightLimit = lastPointIndex;
-    
-    float distAt1, distAt2;
-    for (int iterations = 0; iterations < 32; iterations ++) {   // limit iterations
-        i1 = clamp(i1, 0, lengths.size()-1);
-        distAt1 = lengths[i1];
-        if (distAt1 <= length) {         // if Length at i1 is less than desired Length (this is good)
-            distAt2 = lengths[i1+1];
-            if (distAt2 >= length) {
-                float t = remap(length, distAt1, distAt2, 0.0f, 1.0f, false);
-                return i1 + t;
-            } 
-            else
-                leftLimit = i1;
-        } 
-        else
-            rightLimit = i1;
-        i1 = (leftLimit + rightLimit)/2;
-    }
-    return 0;
+    float t;
+    int i1 = getSegmentAtLength(length, t);
+    return i1 + t;
+}
+
+//--------------------------------------------------
+int Polyline::getSegmentAtLength(float length, float &t) const {
+    updateLengths();
+    length = clamp(length, 0, lengths.back());
+
+    // the last point not further than length starts the segment
+    int i1 = int(std::upper_bound(lengths.begin(), lengths.end(), length) - lengths.begin()) - 1;
+    i1 = std::max(0, std::min(i1, int(lengths.size()) - 2));
+
+    float segmentLength = lengths[i1+1] - lengths[i1];
+    t = (segmentLength > 0.0f) ? (length - lengths[i1]) / segmentLength : 0.0f;
+    return i1;
 }
 
 
@@ -862,14 +857,14 @@ float Polyline::getIndexAtPercent(float f) const {
 //--------------------------------------------------
 float Polyline::getLengthAtIndex(int index) const {
     if (points.size() < 2) return 0;
-    updateCache();
+    updateLengths();
     return lengths[getWrappedIndex(index)];
 }
 
 //--------------------------------------------------
 float Polyline::getLengthAtIndexInterpolated(float findex) const {
     if (points.size() < 2) return 0;
-    updateCache();
+    updateLengths();
     int i1, i2;
     float t;
     getInterpolationParams(findex, i1, i2, t);
@@ -880,8 +875,9 @@ float Polyline::getLengthAtIndexInterpolated(float findex) const {
 //--------------------------------------------------
 glm::vec3 Polyline::getPointAtLength(float f) const {
     if (points.size() < 2) return glm::vec3();
-    updateCache();
-    return getPointAtIndexInterpolated(getIndexAtLength(f));
+    float t;
+    int i1 = getSegmentAtLength(f, t);
+    return glm::mix(points[i1], points[getWrappedIndex(i1 + 1)], t);
 }
 
 //--------------------------------------------------
@@ -890,6 +886,35 @@ glm::vec3 Polyline::getPointAtPercent(float f) const {
     return getPointAtLength(f * length);
 }
 
+//--------------------------------------------------
+std::vector<glm::vec3> Polyline::getPointsAtLengths(const std::vector<float>& _lengths) const {
+    std::vector<glm::vec3> result(_lengths.size());
+    if (points.size() < 2) return result;
+    updateLengths();
+
+    int lastSegment = lengths.size() - 2;
+    int i1 = 0;
+    float t;
+    float previous = 0.0f;
+    for (size_t i = 0; i < _lengths.size(); i++) {
+        float length = clamp(_lengths[i], 0, lengths.back());
+
+        if (length < previous)
+            i1 = getSegmentAtLength(length, t);
+        else {
+            while (i1 < lastSegment && lengths[i1+1] <= length)
+                i1++;
+            float segmentLength = lengths[i1+1] - lengths[i1];
+            t = (segmentLength > 0.0f) ? (length - lengths[i1]) / segmentLength : 0.0f;
+        }
+        previous = length;
+
+        result[i] = glm::mix(points[i1], points[getWrappedIndex(i1 + 1)], t);
+    }
+
+    return result;
+}
+
 
 //--------------------------------------------------
 glm::vec3 Polyline::getPointAtIndexInterpolated(float findex) const {
@@ -1050,7 +1075,6 @@ void Polyline::getInterpolationParams(float findex, int &i1, int &i2, float &t)
 //--------------------------------------------------
 void Polyline::updateCache(bool bForceUpdate) const {
     if (bCacheIsDirty || bForceUpdate) {
-        lengths.clear();
         angles.clear();
         rotations.clear();
         normals.clear();
@@ -1060,7 +1084,6 @@ void Polyline::updateCache(bool bForceUpdate) const {
         if (points.size() < 2) return;
         
         // per vertex cache
-        lengths.resize(points.size());
         tangents.resize(points.size());
         angles.resize(points.size());
         normals.resize(points.size());
@@ -1071,23 +1094,36 @@ void Polyline::updateCache(bool bForceUpdate) const {
         glm::vec3 normal;
         glm::vec3 tangent;
 
-        float length = 0;
         for (size_t i = 0; i < points.size(); i++) {
-            lengths[i] = length;
-
             calcData(i, tangent, angle, rotation, normal);
             tangents[i] = tangent;
             angles[i] = angle;
             rotations[i] = rotation;
             normals[i] = normal;
-            
-            length += glm::distance( points[i],  points[getWrappedIndex(i + 1)]);
         }
-        
-        if (isClosed()) lengths.push_back(length);
     }
 }
 
+//--------------------------------------------------
+void Polyline::updateLengths() const {
+    if (!bLengthsAreDirty)
+        return;
+
+    lengths.clear();
+    bLengthsAreDirty = false;
+
+    if (points.size() < 2) return;
+
+    lengths.resize(points.size());
+    float length = 0;
+    for (size_t i = 0; i < points.size(); i++) {
+        lengths[i] = length;
+        length += glm::distance( points[i],  points[getWrappedIndex(i + 1)]);
+    }
+    
+    if (isClosed()) lengths.push_back(length);
+}
+
 
 //--------------------------------------------------
 typename std::vector<glm::vec3>::iterator Polyline::begin(){
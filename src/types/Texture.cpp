@@ -0,0 +1,90 @@
+#include "hilma/types/Texture.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace hilma {
+
+Texture::Texture(): image(nullptr), wrap(WRAP_REPEAT), filter(FILTER_NEAREST) {
+}
+
+Texture::Texture(const ImageConstPtr& _image, TextureWrap _wrap, TextureFilter _filter): image(_image), wrap(_wrap), filter(_filter) {
+    if (image == nullptr || !image->isAllocated() || filter != FILTER_TRILINEAR)
+        return;
+
+    // the pyramid lives on the image, so every texture made from it shares it
+    size_t total = image->getMipsTotal();
+    for (size_t l = 1; l <= total; l++)
+        levels.push_back( image->getMip(l) );
+}
+
+float Texture::getLod(float _footprint) const {
+    if (image == nullptr || _footprint <= 0.0f)
+        return 0.0f;
+
+    float texels = _footprint * std::max(image->getWidth(), image->getHeight());
+    if (texels <= 1.0f)
+        return 0.0f;
+
+    return std::min( std::log2(texels), float(levels.size()) );
+}
+
+int Texture::wrapCoord(int _x, int _size) const {
+    if (wrap == WRAP_CLAMP)
+        return std::min(std::max(_x, 0), _size - 1);
+
+    else if (wrap == WRAP_MIRROR) {
+        int period = _size * 2;
+        int x = ((_x % period) + period) % period;
+        return x < _size ? x : period - 1 - x;
+    }
+
+    return ((_x % _size) + _size) % _size;
+}
+
+glm::vec4 Texture::fetch(const Image& _level, int _x, int _y) const {
+    return _level.getColor( _level.getIndex( wrapCoord(_x, _level.getWidth()), wrapCoord(_y, _level.getHeight()) ) );
+}
+
+glm::vec4 Texture::nearest(const Image& _level, const glm::vec2& _uv) const {
+    return fetch(_level, int(std::floor(_uv.x * _level.getWidth())), int(std::floor(_uv.y * _level.getHeight())));
+}
+
+glm::vec4 Texture::bilinear(const Image& _level, const glm::vec2& _uv) const {
+    float x = _uv.x * _level.getWidth() - 0.5f;
+    float y = _uv.y * _level.getHeight() - 0.5f;
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    int x0 = int(fx);
+    int y0 = int(fy);
+    float tx = x - fx;
+    float ty = y - fy;
+
+    glm::vec4 top = glm::mix( fetch(_level, x0, y0), fetch(_level, x0 + 1, y0), tx);
+    glm::vec4 bottom = glm::mix( fetch(_level, x0, y0 + 1), fetch(_level, x0 + 1, y0 + 1), tx);
+    return glm::mix(top, bottom, ty);
+}
+
+glm::vec4 Texture::sample(const glm::vec2& _uv, float _footprint) const {
+    if (image == nullptr || !image->isAllocated())
+        return glm::vec4(-1.0f);
+
+    if (filter == FILTER_NEAREST)
+        return nearest(*image, _uv);
+
+    else if (filter == FILTER_BILINEAR || levels.size() == 0)
+        return bilinear(*image, _uv);
+
+    float lod = getLod(_footprint);
+    size_t level = size_t(lod);
+    if (level >= levels.size())
+        return bilinear(*levels.back(), _uv);
+
+    float t = lod - float(level);
+    if (t <= 0.0f)
+        return bilinear(getLevel(level), _uv);
+
+    return glm::mix( bilinear(getLevel(level), _uv), bilinear(getLevel(level + 1), _uv), t);
+}
+
+}
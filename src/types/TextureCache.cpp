@@ -0,0 +1,200 @@
+#include <iostream>
+
+#include "hilma/types/TextureCache.h"
+
+#include "hilma/io/auto.h"
+#include "hilma/parallel.h"
+
+namespace hilma {
+
+TextureCache& TextureCache::instance() {
+    static TextureCache cache;
+    return cache;
+}
+
+TextureCache::TextureCache(): budget(0), usage(0), running(true) {
+}
+
+TextureCache::~TextureCache() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+    }
+    condition.notify_all();
+
+    for (std::thread& t : workers)
+        t.join();
+}
+
+ImagePtr TextureCache::get(const std::string& _filename) {
+    std::shared_future<ImagePtr> future;
+    ImagePromise promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        std::unordered_map<std::string, Entry>::iterator it = entries.find(_filename);
+        if (it == entries.end()) {
+            Entry entry;
+            entry.promise = std::make_shared< std::promise<ImagePtr> >();
+            entry.future = entry.promise->get_future().share();
+            entry.lru = lru.insert(lru.begin(), _filename);
+            it = entries.insert( std::make_pair(_filename, entry) ).first;
+        }
+        else
+            lru.splice(lru.begin(), lru, it->second.lru);
+
+        // nobody is decoding it yet, do it on this thread
+        promise = it->second.promise;
+        it->second.promise = nullptr;
+        future = it->second.future;
+    }
+
+    if (promise)
+        decode(_filename, promise);
+
+    return future.get();
+}
+
+void TextureCache::prefetch(const std::string& _filename) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (entries.find(_filename) != entries.end())
+        return;
+
+    Entry entry;
+    entry.promise = std::make_shared< std::promise<ImagePtr> >();
+    entry.future = entry.promise->get_future().share();
+    entry.lru = lru.insert(lru.begin(), _filename);
+    entries[_filename] = entry;
+
+    queue.push_back(_filename);
+
+    if (workers.size() == 0)
+        for (size_t i = 0; i < getThreadsTotal(); i++)
+            workers.push_back( std::thread(&TextureCache::worker, this) );
+
+    condition.notify_one();
+}
+
+void TextureCache::worker() {
+    while (true) {
+        std::string filename;
+        ImagePromise promise;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]{ return !running || !queue.empty(); });
+
+            if (!running)
+                return;
+
+            filename = queue.front();
+            queue.pop_front();
+
+            // it could have been released or already taken by get()
+            std::unordered_map<std::string, Entry>::iterator it = entries.find(filename);
+            if (it == entries.end() || !it->second.promise)
+                continue;
+
+            promise = it->second.promise;
+            it->second.promise = nullptr;
+        }
+
+        decode(filename, promise);
+    }
+}
+
+void TextureCache::decode(const std::string& _filename, ImagePromise _promise) {
+    ImagePtr image = std::make_shared<Image>();
+    if (!load(_filename, *image)) {
+        std::cout << "Failed to load texture : " << _filename << std::endl;
+        image = nullptr;
+    }
+    else
+        image->name = _filename;
+
+    _promise->set_value(image);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    std::unordered_map<std::string, Entry>::iterator it = entries.find(_filename);
+    if (it != entries.end() && image) {
+        it->second.bytes = image->getBytes();
+        usage += it->second.bytes;
+    }
+    evict();
+}
+
+// Drops the least recently used images only held by the cache until it fits the budget
+void TextureCache::evict() {
+    if (budget == 0)
+        return;
+
+    std::list<std::string>::iterator it = lru.end();
+    while (usage > budget && it != lru.begin()) {
+        --it;
+
+        std::unordered_map<std::string, Entry>::iterator entry = entries.find(*it);
+        const std::shared_future<ImagePtr>& future = entry->second.future;
+        if (entry->second.promise ||
+            future.wait_for(std::chrono::seconds(0)) != std::future_status::ready ||
+            future.get().use_count() > 1)
+            continue;
+
+        usage -= entry->second.bytes;
+        entries.erase(entry);
+        it = lru.erase(it);
+    }
+}
+
+bool TextureCache::have(const std::string& _filename) const {
+    std::unique_lock<std::mutex> lock(mutex);
+    return entries.find(_filename) != entries.end();
+}
+
+void TextureCache::release(const std::string& _filename) {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::unordered_map<std::string, Entry>::iterator it = entries.find(_filename);
+    if (it == entries.end())
+        return;
+
+    // still decoding, keep it until it's done
+    if (!it->second.promise &&
+        it->second.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+
+    if (it->second.promise)
+        it->second.promise->set_value(nullptr);
+
+    usage -= it->second.bytes;
+    lru.erase(it->second.lru);
+    entries.erase(it);
+}
+
+void TextureCache::clear() {
+    std::vector<std::string> names;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (std::unordered_map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+            names.push_back(it->first);
+    }
+
+    for (size_t i = 0; i < names.size(); i++)
+        release(names[i]);
+}
+
+void TextureCache::setBudget(size_t _bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    budget = _bytes;
+    evict();
+}
+
+size_t TextureCache::getMemoryUsage() const {
+    std::unique_lock<std::mutex> lock(mutex);
+    return usage;
+}
+
+size_t TextureCache::getTotal() const {
+    std::unique_lock<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+}
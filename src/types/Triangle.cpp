@@ -1,5 +1,7 @@
 #include "hilma/types/Triangle.h"
 
+#include <cmath>
+
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include "glm/gtx/norm.hpp"
@@ -146,16 +148,15 @@ glm::vec3 Triangle::getVertex(const glm::vec3& _barycenter) const {
             getVertex(2) * _barycenter.z;
 }
 
-glm::vec4 Triangle::getColor(const glm::vec3& _barycenter) const {
+glm::vec4 Triangle::getColor(const glm::vec3& _barycenter, float _footprint) const {
 
     if (material != nullptr) {
-        if ( material->haveProperty("diffuse") ) {
-            if (haveTexCoords()) {
-                glm::vec2 uv = getTexCoord(_barycenter);
-                return material->getColor("diffuse", uv);
-            }
+        MaterialHandleConstPtr handle = material->getHandle();
+        if ( handle->have(DIFFUSE) ) {
+            if (haveTexCoords())
+                return handle->getColor(DIFFUSE, getTexCoord(_barycenter), _footprint);
             else
-                return material->getColor("diffuse");
+                return handle->getColor(DIFFUSE);
         }
     }
 
@@ -167,7 +168,7 @@ glm::vec4 Triangle::getColor(const glm::vec3& _barycenter) const {
         return glm::vec4(1.0f);
 }
 
-glm::vec3 Triangle::getNormal(const glm::vec3& _barycenter) const {
+glm::vec3 Triangle::getNormal(const glm::vec3& _barycenter, float _footprint) const {
     glm::vec3 n;
     if (haveNormals())
         n = getNormal(0) * _barycenter.x +
@@ -177,13 +178,14 @@ glm::vec3 Triangle::getNormal(const glm::vec3& _barycenter) const {
         n = getNormal();
 
     if (material != nullptr && haveTexCoords() && haveTangents()) {
-        if ( material->haveProperty("normalmap") ) {
+        MaterialHandleConstPtr handle = material->getHandle();
+        if ( handle->have(NORMALMAP) ) {
             glm::vec2 uv = getTexCoord(_barycenter);
             glm::vec4 t = getTangent(_barycenter);
             glm::vec3 b = glm::cross( n, glm::vec3(t.x, t.y, t.z) ) * t.w;
             glm::mat3 tbn = glm::mat3( t, b, n );
 
-            return tbn * ( material->getColor("normalmap", uv) * 2.0f - 1.0f);
+            return tbn * ( handle->getColor(NORMALMAP, uv, _footprint) * 2.0f - 1.0f);
         }
     }
 
@@ -200,6 +202,17 @@ glm::vec2 Triangle::getTexCoord(const glm::vec3& _barycenter) const {
     return uv;
 }
 
+float Triangle::getTexCoordDensity() const {
+    if (!haveTexCoords() || area <= 0.0f)
+        return 0.0f;
+
+    // both areas are doubled, the ratio stays the same
+    glm::vec2 e1 = getTexCoord(1) - getTexCoord(0);
+    glm::vec2 e2 = getTexCoord(2) - getTexCoord(0);
+    float uvArea = std::abs(e1.x * e2.y - e1.y * e2.x);
+    return std::sqrt(uvArea / area);
+}
+
 glm::vec4 Triangle::getTangent(const glm::vec3& _barycenter ) const {
     return  getTangent(0) * _barycenter.x +
             getTangent(1) * _barycenter.y +
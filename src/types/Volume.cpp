@@ -0,0 +1,131 @@
+#include "hilma/types/Volume.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace hilma {
+
+const int BRICK_VOXELS = Volume::BRICK_SIZE * Volume::BRICK_SIZE * Volume::BRICK_SIZE;
+const int BRICK_MASK = Volume::BRICK_SIZE - 1;
+
+Volume::Volume(): origin(0.0f), voxelSize(1.0f), width(0), height(0), depth(0), bricksWidth(0), bricksHeight(0), bricksDepth(0) {
+}
+
+Volume::Volume(int _width, int _height, int _depth, float _background): origin(0.0f), voxelSize(1.0f) {
+    allocate(_width, _height, _depth, _background);
+}
+
+void Volume::allocate(int _width, int _height, int _depth, float _background) {
+    width = _width;
+    height = _height;
+    depth = _depth;
+    bricksWidth = (width + BRICK_MASK) >> BRICK_BITS;
+    bricksHeight = (height + BRICK_MASK) >> BRICK_BITS;
+    bricksDepth = (depth + BRICK_MASK) >> BRICK_BITS;
+
+    size_t total = size_t(bricksWidth) * bricksHeight * bricksDepth;
+    table.assign(total, -1);
+    tiles.assign(total, _background);
+    data.clear();
+}
+
+void Volume::clear() {
+    allocate(0, 0, 0);
+}
+
+void Volume::allocateBrick(int _bx, int _by, int _bz) {
+    size_t index = getBrickIndex(_bx, _by, _bz);
+    if (table[index] >= 0)
+        return;
+
+    table[index] = int32_t(data.size() / BRICK_VOXELS);
+    data.resize(data.size() + BRICK_VOXELS, tiles[index]);
+}
+
+void Volume::setTile(int _bx, int _by, int _bz, float _value) {
+    size_t index = getBrickIndex(_bx, _by, _bz);
+    tiles[index] = _value;
+
+    // a brick already allocated becomes constant
+    if (table[index] >= 0)
+        std::fill(data.begin() + size_t(table[index]) * BRICK_VOXELS, data.begin() + size_t(table[index] + 1) * BRICK_VOXELS, _value);
+}
+
+size_t Volume::getBytes() const {
+    return data.size() * sizeof(float) + tiles.size() * sizeof(float) + table.size() * sizeof(int32_t);
+}
+
+void Volume::setValue(int _x, int _y, int _z, float _value) {
+    if (_x < 0 || _y < 0 || _z < 0 || _x >= width || _y >= height || _z >= depth)
+        return;
+
+    int bx = _x >> BRICK_BITS;
+    int by = _y >> BRICK_BITS;
+    int bz = _z >> BRICK_BITS;
+    allocateBrick(bx, by, bz);
+
+    size_t brick = size_t(table[getBrickIndex(bx, by, bz)]);
+    data[brick * BRICK_VOXELS + (((_z & BRICK_MASK) << BRICK_BITS | (_y & BRICK_MASK)) << BRICK_BITS | (_x & BRICK_MASK))] = _value;
+}
+
+float Volume::getValue(int _x, int _y, int _z) const {
+    if (table.size() == 0)
+        return 0.0f;
+
+    _x = std::min(std::max(_x, 0), width - 1);
+    _y = std::min(std::max(_y, 0), height - 1);
+    _z = std::min(std::max(_z, 0), depth - 1);
+
+    size_t index = getBrickIndex(_x >> BRICK_BITS, _y >> BRICK_BITS, _z >> BRICK_BITS);
+    if (table[index] < 0)
+        return tiles[index];
+
+    return data[size_t(table[index]) * BRICK_VOXELS + (((_z & BRICK_MASK) << BRICK_BITS | (_y & BRICK_MASK)) << BRICK_BITS | (_x & BRICK_MASK))];
+}
+
+float Volume::sample(const glm::vec3& _voxel) const {
+    glm::vec3 f = glm::floor(_voxel);
+    glm::vec3 t = _voxel - f;
+    int x = int(f.x);
+    int y = int(f.y);
+    int z = int(f.z);
+
+    float c00 = glm::mix(getValue(x, y, z),         getValue(x + 1, y, z),          t.x);
+    float c10 = glm::mix(getValue(x, y + 1, z),     getValue(x + 1, y + 1, z),      t.x);
+    float c01 = glm::mix(getValue(x, y, z + 1),     getValue(x + 1, y, z + 1),      t.x);
+    float c11 = glm::mix(getValue(x, y + 1, z + 1), getValue(x + 1, y + 1, z + 1),  t.x);
+
+    return glm::mix( glm::mix(c00, c10, t.y), glm::mix(c01, c11, t.y), t.z);
+}
+
+glm::vec3 Volume::getGradient(const glm::vec3& _voxel) const {
+    // central differences, in value units per voxel
+    return glm::vec3(   sample(_voxel + glm::vec3(0.5f, 0.0f, 0.0f)) - sample(_voxel - glm::vec3(0.5f, 0.0f, 0.0f)),
+                        sample(_voxel + glm::vec3(0.0f, 0.5f, 0.0f)) - sample(_voxel - glm::vec3(0.0f, 0.5f, 0.0f)),
+                        sample(_voxel + glm::vec3(0.0f, 0.0f, 0.5f)) - sample(_voxel - glm::vec3(0.0f, 0.0f, 0.5f)) );
+}
+
+glm::vec3 Volume::getNormal(const glm::vec3& _voxel) const {
+    glm::vec3 g = getGradient(_voxel);
+    float l = glm::length(g);
+    if (l > 0.0f)
+        return g / l;
+    return glm::vec3(0.0f);
+}
+
+Image Volume::getSlice(int _z) const {
+    Image out = Image(width, height, 1);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            out.setValue(out.getIndex(x, y), getValue(x, y, _z));
+    return out;
+}
+
+std::vector<Image> Volume::getSlices() const {
+    std::vector<Image> out;
+    for (int z = 0; z < depth; z++)
+        out.push_back( getSlice(z) );
+    return out;
+}
+
+}
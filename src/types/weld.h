@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+
+namespace hilma {
+
+// Hash of exact positions
+struct PointHash {
+    size_t operator()(const glm::vec3& _p) const {
+        std::hash<float> hash;
+        return hash(_p.x) ^ (hash(_p.y) * 0x9E3779B1u) ^ (hash(_p.z) * 0x85EBCA77u);
+    }
+};
+
+// For each vertex, the index of the first vertex at the same position. Meshes split at
+// normal or uv seams (or triangle soups like STL) share positions but not indices.
+inline std::vector<uint32_t> getWelds(const std::vector<glm::vec3>& _vertices) {
+    std::vector<uint32_t> welds(_vertices.size());
+    std::unordered_map<glm::vec3, uint32_t, PointHash> points;
+    points.reserve(_vertices.size());
+    for (size_t i = 0; i < _vertices.size(); i++)
+        welds[i] = points.insert( std::make_pair(_vertices[i], uint32_t(i)) ).first->second;
+    return welds;
+}
+
+}